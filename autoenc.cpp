@@ -2,12 +2,21 @@
 #include <meta/logic.h>
 #include <meta/params.h>
 #include <ml/ann.h>
+#include <ml/ann/binarization.h>
+#include <ml/ann/embedding.h>
+#include <ml/ann/quantization.h>
 #include <ml/ann/stop_criterion.h>
+#include <ml/ann/telemetry.h>
 #include <ml/exception.h>
+#include <ml/hnsw.h>
+#include <ml/parallel.h>
+#include <ml/random.h>
 
+#include <algorithm>
+#include <chrono>
+#include <fstream>
 #include <iomanip>
 #include <iostream>
-#include <random>
 #include <vector>
 
 #include <boost/program_options.hpp>
@@ -15,13 +24,14 @@
 #include <QtGui/QImage>
 #include <QtGui/QPainter>
 
+ML_DEFINE_ALLOCATION_COUNTER
+
 static const unsigned IMG_SIZE = 28;
 static const unsigned IMG_AREA = IMG_SIZE * IMG_SIZE;
 
 std::vector<QImage> generateImages(size_t numImages) {
-    std::random_device gen;
-    //std::mt19937 gen;
-    std::uniform_int_distribution<> dis(1, IMG_SIZE - 1);
+    ml::Philox gen = ml::randomStream();
+    auto dis = [&gen] { return 1 + static_cast<int>(gen.below(IMG_SIZE - 1)); };
     std::vector<QImage> result;
     result.reserve(numImages);
     for (size_t i = 0; i < numImages; ++i) {
@@ -35,7 +45,7 @@ std::vector<QImage> generateImages(size_t numImages) {
         pen.setWidth(2);
         pen.setColor(Qt::black);
         p.setPen(pen);
-        p.drawLine(dis(gen), dis(gen), dis(gen), dis(gen));
+        p.drawLine(dis(), dis(), dis(), dis());
         p.end();
     }
     return result;
@@ -151,16 +161,90 @@ readMINSTDataset(const std::string& imgs, const std::string& lbls) {
 }
 
 void addNoise(ANNDataset& ds, double level = 0.25) {
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_real_distribution<> dis(0.0, 1.0);
-    for (unsigned r = 0; r < ds.examples.rows(); ++r) {
-        for (unsigned c = 0; c < ds.examples.cols(); ++c) {
-            if (dis(gen) < level) {
-                ds.examples(r, c) = 0.0;
-            }
-        }
+    Eigen::MatrixXd noise(ds.examples.rows(), ds.examples.cols());
+    ml::randomStream().fillUniform(noise, 0.0, 1.0);
+    ds.examples.array() =
+        (noise.array() < level).select(0.0, ds.examples.array());
+}
+
+//! Bytes of double weights and biases of network connections
+template <typename Classifier>
+uint64_t floatBytes(const Classifier& classifier) {
+    uint64_t result = 0;
+    meta::tup_each(
+            [&result](const auto& conn) {
+                result += sizeof(double) *
+                    (conn.weights().size() + conn.bias().size());
+            },
+            classifier.connections());
+    return result;
+}
+
+//! Runs classifier on dataset examples, returns examples classified per
+//! second and stores outputs in out
+template <typename Classifier>
+double examplesPerSec(const Classifier& classifier, const ANNDataset& dataset,
+        Eigen::MatrixXd& out) {
+    typedef std::chrono::steady_clock Clock;
+    const auto t0 = Clock::now();
+    out = classifier(dataset.examples);
+    const std::chrono::duration<double> elapsed = Clock::now() - t0;
+    return static_cast<double>(out.cols()) / elapsed.count();
+}
+
+void writeTelemetry(
+        const boost::program_options::variables_map& vars,
+        const ml::ann::TelemetryRecorder& telemetry) {
+    if (vars.count("telemetry-csv")) {
+        const auto prefix = vars["telemetry-csv"].as<std::string>();
+        std::ofstream epochs(prefix + "epochs.csv");
+        ml::ann::writeCsv(epochs, telemetry.epochs());
+        std::ofstream batches(prefix + "batches.csv");
+        ml::ann::writeCsv(batches, telemetry.batches());
     }
+    if (vars.count("telemetry-json")) {
+        std::ofstream json(vars["telemetry-json"].as<std::string>());
+        ml::ann::writeJson(json, telemetry);
+    }
+}
+
+//! Trains autoencoder of BinaryFullyConnected layers and compares its
+//! XNOR inference with the float forward pass
+void trainBinarized(
+        const ANNDataset& trainingSet,
+        const ANNDataset& testSet,
+        unsigned maxEpochs,
+        ml::ann::TelemetryRecorder& telemetry) {
+    typedef ml::ann::NetworkConf<
+        ml::ann::Input<28 * 28>,
+        ml::ann::BinaryFullyConnected<200>,
+        ml::ann::BinaryFullyConnected<28 * 28>> NetworkConf;
+
+    ml::ann::EarlyStopping<ANNDataset, NetworkConf>
+        earlyStopping(testSet, 1, 1024, ml::defaultNumThreads());
+    ml::ann::EpochsNumber epochsNumber(maxEpochs);
+    auto optimizationParams = std::make_tuple(
+            meta::param<ml::batchSizeP>(32),
+            meta::param<ml::regularizationP>(ml::ann::L2Regularization(0.0)),
+            meta::param<ml::stopCriterionP>(
+                meta::any(earlyStopping.ref(), epochsNumber)),
+            meta::param<ml::optimizationMonitorP>(
+                ml::ann::withTelemetry(earlyStopping.ref(), telemetry)));
+    time_t start = clock();
+    std::cout << "training binarized...\n";
+    auto clsfr = ml::ann::train(trainingSet, optimizationParams, NetworkConf{});
+    std::cout << " time: " << (clock() - start) / CLOCKS_PER_SEC << "\n";
+
+    const auto xnor = ml::ann::binarize(clsfr);
+    Eigen::MatrixXd out;
+    const double floatSpeed = examplesPerSec(clsfr, testSet, out);
+    const double floatLoss = NetworkConf::lossFn(out, testSet.labels);
+    const double xnorSpeed = examplesPerSec(xnor, testSet, out);
+    const double xnorLoss = NetworkConf::lossFn(out, testSet.labels);
+    std::cout << " float: loss " << floatLoss << ", " << floatSpeed
+              << " examples/s, " << floatBytes(clsfr) << " bytes\n";
+    std::cout << " xnor: loss " << xnorLoss << ", " << xnorSpeed
+              << " examples/s, " << xnor.bytes() << " bytes\n";
 }
 
 int main(int argc, char** argv) {
@@ -177,6 +261,26 @@ int main(int argc, char** argv) {
                 "File with test images.")
             ("test-labels,l", po::value<std::string>(),
                 "File with test labels.")
+            ("telemetry-csv", po::value<std::string>(),
+                "Prefix of CSV files to store per-epoch and per-batch "
+                "training telemetry to.")
+            ("telemetry-json", po::value<std::string>(),
+                "JSON file to store training telemetry to.")
+            ("binarized-epochs", po::value<unsigned>()->default_value(0),
+                "Train autoencoder of binarized layers for at most this "
+                "many epochs instead, 0 trains float layers. XNOR inference "
+                "is reported instead of int8 one.")
+            ("hnsw-index", po::value<std::string>(),
+                "File to store HNSW index of training set codes to.")
+            ("hnsw-m", po::value<unsigned>()->default_value(16),
+                "Links per node of HNSW index.")
+            ("hnsw-ef", po::value<unsigned>()->default_value(50),
+                "Candidate list size of HNSW searches.")
+            ("hnsw-queries", po::value<unsigned>()->default_value(0),
+                "Number of test images to look up similar training images "
+                "for, 0 doesn't build HNSW index.")
+            ("seed", po::value<uint64_t>()->default_value(0),
+                "Seed of weights initialization and other random draws.")
         ;
 
         po::variables_map vars;
@@ -193,6 +297,18 @@ int main(int argc, char** argv) {
             std::cout << "Specify all training/test set files\n";
             return 1;
         }
+        // Codes of binarized layers aren't indexed
+        if (vars["binarized-epochs"].as<unsigned>() > 0 &&
+                (vars.count("hnsw-index") ||
+                 vars["hnsw-queries"].as<unsigned>() > 0 ||
+                 !vars["hnsw-m"].defaulted() ||
+                 !vars["hnsw-ef"].defaulted())) {
+            std::cout << "--binarized-epochs can't be combined with "
+                         "--hnsw-index, --hnsw-queries, --hnsw-m or "
+                         "--hnsw-ef\n";
+            return 1;
+        }
+        ml::seedRandom(vars["seed"].as<uint64_t>());
 
         auto minstTrainingSet = readMINSTDataset(
                 vars["training-images"].as<std::string>(),
@@ -202,13 +318,21 @@ int main(int argc, char** argv) {
                 vars["test-images"].as<std::string>(),
                 vars["test-labels"].as<std::string>());
 
+        ml::ann::TelemetryRecorder telemetry;
+        if (vars["binarized-epochs"].as<unsigned>() > 0) {
+            trainBinarized(minstTrainingSet, minstTestSet,
+                           vars["binarized-epochs"].as<unsigned>(), telemetry);
+            writeTelemetry(vars, telemetry);
+            return 0;
+        }
+
         typedef ml::ann::NetworkConf<
             ml::ann::Input<28 * 28>,
             ml::ann::FullyConnected<200>,
             ml::ann::FullyConnected<28 * 28>> NetworkConf;
 
         ml::ann::EarlyStopping<ANNDataset, NetworkConf>
-            earlyStopping(minstTestSet, 1);
+            earlyStopping(minstTestSet, 1, 1024, ml::defaultNumThreads());
         ml::ann::EpochsNumber epochsNumber(100);
 
         auto optimizationParams = std::make_tuple(
@@ -216,12 +340,87 @@ int main(int argc, char** argv) {
                 meta::param<ml::regularizationP>(ml::ann::L2Regularization(1.0)),
                 meta::param<ml::stopCriterionP>(
                     meta::any(earlyStopping.ref(), epochsNumber)),
-                meta::param<ml::optimizationMonitorP>(earlyStopping.ref()));
+                meta::param<ml::optimizationMonitorP>(
+                    ml::ann::withTelemetry(earlyStopping.ref(), telemetry)));
         time_t start = clock();
         std::cout << "training...\n";
         auto clsfr = ml::ann::train(minstTrainingSet,
                 optimizationParams, NetworkConf{});
         std::cout << " time: " << (clock() - start) / CLOCKS_PER_SEC << "\n";
+
+        writeTelemetry(vars, telemetry);
+
+        std::cout << "quantizing...\n";
+        // Scales are calibrated on training examples, so the error reported
+        // on the test set includes examples outside the calibrated ranges
+        const uint64_t numCalibration =
+            std::min<uint64_t>(4096, size(minstTrainingSet));
+        ANNDataset calibrationSet(numCalibration);
+        calibrationSet.examples =
+            minstTrainingSet.examples.leftCols(numCalibration);
+        calibrationSet.labels =
+            minstTrainingSet.labels.leftCols(numCalibration);
+        auto quantized = ml::ann::quantize(clsfr, calibrationSet);
+        auto report = ml::ann::compare(clsfr, quantized, minstTestSet);
+        std::cout << " float loss: " << report.floatLoss
+                  << " int8 loss: " << report.quantizedLoss
+                  << " max abs error: " << report.maxAbsError
+                  << " mean abs error: " << report.meanAbsError << "\n";
+
+        Eigen::MatrixXd out;
+        std::cout << " float: " << examplesPerSec(clsfr, minstTestSet, out)
+                  << " examples/s, " << floatBytes(clsfr) << " bytes\n";
+        std::cout << " int8: " << examplesPerSec(quantized, minstTestSet, out)
+                  << " examples/s, " << quantized.bytes() << " bytes\n";
+
+        const unsigned numQueries = std::min<uint64_t>(
+                vars["hnsw-queries"].as<unsigned>(), size(minstTestSet));
+        if (numQueries > 0 || vars.count("hnsw-index")) {
+            typedef std::chrono::steady_clock Clock;
+            std::cout << "indexing codes...\n";
+            ml::hnsw::Params hnswParams;
+            hnswParams.M = vars["hnsw-m"].as<unsigned>();
+            hnswParams.ef = vars["hnsw-ef"].as<unsigned>();
+            const auto t0 = Clock::now();
+            const auto index = ml::ann::indexEmbeddings(
+                    clsfr, minstTrainingSet, hnswParams);
+            const std::chrono::duration<double> buildTime = Clock::now() - t0;
+            std::cout << " " << index.size() << " codes in "
+                      << buildTime.count() << " s\n";
+
+            const unsigned k = 10;
+            const Eigen::MatrixXf queries = ml::ann::encode(
+                    clsfr, minstTestSet.examples.leftCols(numQueries));
+            double searchTime = 0.0;
+            uint64_t found = 0;
+            for (unsigned q = 0; q < numQueries; ++q) {
+                const auto t1 = Clock::now();
+                const auto neighbours = index.search(queries.col(q), k);
+                const std::chrono::duration<double> elapsed = Clock::now() - t1;
+                searchTime += elapsed.count();
+                // Exact neighbours for recall
+                Eigen::VectorXf distances = (index.points().colwise() -
+                        queries.col(q)).colwise().squaredNorm();
+                std::vector<float> sorted(
+                        distances.data(), distances.data() + distances.size());
+                std::nth_element(
+                        sorted.begin(), sorted.begin() + k - 1, sorted.end());
+                for (const auto& neighbour: neighbours) {
+                    found += neighbour.first <= sorted[k - 1];
+                }
+            }
+            if (numQueries > 0) {
+                std::cout << " " << searchTime / numQueries * 1e6
+                          << " us/query, recall@" << k << ": "
+                          << static_cast<double>(found) / (numQueries * k)
+                          << "\n";
+            }
+            if (vars.count("hnsw-index")) {
+                std::ofstream out(vars["hnsw-index"].as<std::string>(),
+                                  std::ios::binary);
+                index.save(out);
+            }
+        }
     } catch (ml::RuntimeException& e) {
         std::cout << e.what() << "\n";
         return -1;
@@ -0,0 +1,290 @@
+#include "read_minst.h"
+#include <meta/logic.h>
+#include <meta/params.h>
+#include <ml/ann.h>
+#include <ml/ann/stop_criterion.h>
+#include <ml/ann/telemetry.h>
+#include <ml/dag_muticlass.h>
+#include <ml/dataset/dataset.h>
+#include <ml/exception.h>
+#include <ml/kernels.h>
+#include <ml/svm/svc.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <sys/resource.h>
+
+#include <boost/program_options.hpp>
+#include <Eigen/Dense>
+
+namespace {
+
+const unsigned IMG_SIZE = 28;
+const unsigned IMG_AREA = IMG_SIZE * IMG_SIZE;
+const unsigned NUM_CLASSES = 10;
+
+typedef ml::VecDataset<MINSTImage, int> MINSTDataset;
+
+struct ANNDataset {
+    ANNDataset() = default;
+    ANNDataset(ANNDataset&&) = default;
+    explicit ANNDataset(uint64_t size)
+        : examples(IMG_AREA, size), labels(IMG_AREA, size) {}
+
+    Eigen::Matrix<double, IMG_AREA, Eigen::Dynamic> examples;
+    Eigen::Matrix<double, IMG_AREA, Eigen::Dynamic> labels;
+};
+
+uint64_t size(const ANNDataset& ds) {
+    return ds.examples.cols();
+}
+
+class Timer {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    Timer() : start_(Clock::now()) {}
+
+    double seconds() const {
+        const std::chrono::duration<double> elapsed = Clock::now() - start_;
+        return elapsed.count();
+    }
+
+private:
+    Clock::time_point start_;
+};
+
+//! Peak resident set size in megabytes
+double peakRSS() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return usage.ru_maxrss / (1024.0 * 1024.0);
+#else
+    return usage.ru_maxrss / 1024.0;
+#endif
+}
+
+void report(const std::string& stage, double seconds, uint64_t examples) {
+    std::cout << stage << ": " << seconds << " s, "
+              << examples / seconds << " examples/s, peak RSS "
+              << peakRSS() << " MB\n";
+}
+
+template <typename OStream>
+void writeBigEndian(OStream& o, uint32_t u) {
+    const char bytes[] = {
+        static_cast<char>(u >> 24), static_cast<char>(u >> 16),
+        static_cast<char>(u >> 8), static_cast<char>(u)};
+    o.write(bytes, sizeof(bytes));
+}
+
+//! Writes IDX images and labels files of numExamples synthetic digits. Each
+//! class is a random prototype image with noise flipping some of the pixels.
+//! The first NUM_CLASSES examples are one of every class, so any prefix of
+//! at least NUM_CLASSES examples has all labels. Files written with the same
+//! prototypeSeed and different exampleSeed hold different examples of the
+//! same classes, e.g. training and held-out sets.
+void writeSyntheticIDX(
+        const std::string& imagesFile,
+        const std::string& labelsFile,
+        uint64_t numExamples,
+        double noise,
+        unsigned prototypeSeed,
+        unsigned exampleSeed) {
+    REQUIRE(numExamples <= UINT32_MAX,
+            "IDX files hold up to 2^32 - 1 examples: " << numExamples);
+    std::mt19937 prototypeGen(prototypeSeed);
+    std::bernoulli_distribution on(0.2);
+    std::vector<std::vector<uint8_t>> prototypes(
+            NUM_CLASSES, std::vector<uint8_t>(IMG_AREA));
+    for (auto& prototype: prototypes) {
+        std::generate(prototype.begin(), prototype.end(),
+                [&] { return on(prototypeGen) ? 255 : 0; });
+    }
+
+    std::ofstream images(imagesFile, std::ios_base::binary);
+    std::ofstream labels(labelsFile, std::ios_base::binary);
+    REQUIRE(images && labels, "Can't create IDX files");
+    const char imagesHeader[] = {0, 0, 0x08, 3};
+    images.write(imagesHeader, sizeof(imagesHeader));
+    writeBigEndian(images, numExamples);
+    writeBigEndian(images, IMG_SIZE);
+    writeBigEndian(images, IMG_SIZE);
+    const char labelsHeader[] = {0, 0, 0x08, 1};
+    labels.write(labelsHeader, sizeof(labelsHeader));
+    writeBigEndian(labels, numExamples);
+
+    std::mt19937 gen(exampleSeed);
+    std::bernoulli_distribution flip(noise);
+    std::uniform_int_distribution<unsigned> cls(0, NUM_CLASSES - 1);
+    std::vector<uint8_t> image(IMG_AREA);
+    for (uint64_t i = 0; i < numExamples; ++i) {
+        const uint8_t label = i < NUM_CLASSES ? i : cls(gen);
+        const auto& prototype = prototypes[label];
+        for (unsigned pixel = 0; pixel < IMG_AREA; ++pixel) {
+            image[pixel] = flip(gen) ? 255 - prototype[pixel] : prototype[pixel];
+        }
+        images.write(reinterpret_cast<const char*>(image.data()), IMG_AREA);
+        labels.write(reinterpret_cast<const char*>(&label), 1);
+    }
+}
+
+MINSTDataset toMINSTDataset(
+        const std::pair<std::vector<MINSTImage>, std::vector<unsigned>>& data,
+        uint64_t numExamples) {
+    numExamples = std::min<uint64_t>(numExamples, data.first.size());
+    MINSTDataset result(numExamples);
+    for (uint64_t i = 0; i < numExamples; ++i) {
+        set(i, data.first[i], static_cast<int>(data.second[i]), result);
+    }
+    return result;
+}
+
+ANNDataset toANNDataset(const std::vector<MINSTImage>& images) {
+    ANNDataset result(images.size());
+    for (uint64_t pos = 0; pos < images.size(); ++pos) {
+        for (unsigned i = 0; i < IMG_AREA; ++i) {
+            result.examples(i, pos) = images[pos](i) ? 1.0 : -1.0;
+        }
+    }
+    result.labels = result.examples;
+    return result;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    try {
+        namespace po = boost::program_options;
+        po::options_description desc("Allowed options");
+        desc.add_options()
+            ("help", "produce help message")
+            ("examples,n", po::value<uint64_t>()->default_value(10000),
+                "Number of synthetic training examples.")
+            ("svm-examples", po::value<uint64_t>()->default_value(5000),
+                "Number of training examples used for SVM training.")
+            ("test-examples", po::value<uint64_t>()->default_value(2000),
+                "Number of held-out examples for error rates, validation "
+                "and inference.")
+            ("epochs,e", po::value<unsigned>()->default_value(1),
+                "Number of ANN training epochs.")
+            ("noise", po::value<double>()->default_value(0.1),
+                "Probability of flipping a pixel of class prototype.")
+            ("dir,d", po::value<std::string>()->default_value("."),
+                "Directory for generated IDX files.")
+        ;
+
+        po::variables_map vars;
+        po::store(po::parse_command_line(argc, argv, desc), vars);
+        po::notify(vars);
+
+        if (vars.count("help")) {
+            std::cout << desc << "\n";
+            return 0;
+        }
+
+        if (vars["epochs"].as<unsigned>() == 0) {
+            std::cout << "Number of epochs must be at least 1\n";
+            return 1;
+        }
+
+        const uint64_t numExamples = vars["examples"].as<uint64_t>();
+        const uint64_t numSVMExamples = vars["svm-examples"].as<uint64_t>();
+        const uint64_t numTestExamples = vars["test-examples"].as<uint64_t>();
+        if (numExamples < NUM_CLASSES || numSVMExamples < NUM_CLASSES ||
+                numTestExamples < NUM_CLASSES) {
+            std::cout << "Numbers of examples must be at least "
+                      << NUM_CLASSES << ", one per class\n";
+            return 1;
+        }
+
+        const std::string dir = vars["dir"].as<std::string>();
+        const std::string imagesFile = dir + "/synthetic-images.idx";
+        const std::string labelsFile = dir + "/synthetic-labels.idx";
+        const std::string testImagesFile = dir + "/synthetic-test-images.idx";
+        const std::string testLabelsFile = dir + "/synthetic-test-labels.idx";
+
+        Timer generateTimer;
+        writeSyntheticIDX(imagesFile, labelsFile, numExamples,
+                vars["noise"].as<double>(), 0, 1);
+        writeSyntheticIDX(testImagesFile, testLabelsFile, numTestExamples,
+                vars["noise"].as<double>(), 0, 2);
+        report("generate", generateTimer.seconds(),
+                numExamples + numTestExamples);
+
+        Timer loadTimer;
+        auto data = readMINSTData(imagesFile, labelsFile);
+        auto testData = readMINSTData(testImagesFile, testLabelsFile);
+        report("load", loadTimer.seconds(), numExamples + numTestExamples);
+
+        auto svmSet = toMINSTDataset(data, numSVMExamples);
+        Timer svmTimer;
+        auto svm = ml::dag::train(svmSet,
+            [] (const MINSTDataset& ds) {
+                return ml::svc::train(ds, 0.5, ml::RBFKernel(15.0));
+            });
+        report("svm train", svmTimer.seconds(), size(svmSet));
+
+        Timer svmInferenceTimer;
+        uint64_t errors = 0;
+        for (uint64_t i = 0; i < testData.first.size(); ++i) {
+            errors += svm(testData.first[i]) !=
+                static_cast<int>(testData.second[i]);
+        }
+        report("svm inference", svmInferenceTimer.seconds(), numTestExamples);
+        std::cout << " svm held-out error rate: "
+                  << static_cast<double>(errors) / numTestExamples << "\n";
+
+        auto annSet = toANNDataset(data.first);
+        auto testAnnSet = toANNDataset(testData.first);
+        typedef ml::ann::NetworkConf<
+            ml::ann::Input<IMG_AREA>,
+            ml::ann::FullyConnected<200>,
+            ml::ann::FullyConnected<IMG_AREA>> NetworkConf;
+        ml::ann::EarlyStopping<ANNDataset, NetworkConf>
+            earlyStopping(testAnnSet, 1);
+        earlyStopping.subsample(1000);
+        ml::ann::EpochsNumber epochsNumber(vars["epochs"].as<unsigned>() - 1);
+        ml::ann::TelemetryRecorder telemetry;
+        auto optimizationParams = std::make_tuple(
+                meta::param<ml::batchSizeP>(32),
+                meta::param<ml::regularizationP>(
+                    ml::ann::L2Regularization(1.0)),
+                meta::param<ml::stopCriterionP>(
+                    meta::any(earlyStopping.ref(), epochsNumber)),
+                meta::param<ml::optimizationMonitorP>(
+                    ml::ann::withTelemetry(earlyStopping.ref(), telemetry)));
+        Timer annTimer;
+        auto ann = ml::ann::train(annSet, optimizationParams, NetworkConf{});
+        report("ann train", annTimer.seconds(),
+                numExamples * telemetry.epochs().size());
+        for (size_t i = 0; i < telemetry.epochs().size(); ++i) {
+            const auto& epoch = telemetry.epochs()[i];
+            std::cout << " epoch " << epoch.epoch << ": "
+                      << epoch.examplesPerSec << " examples/s, validation "
+                      << epoch.validationTime << " s\n";
+        }
+
+        const unsigned inferenceBatch = 256;
+        Timer annInferenceTimer;
+        for (uint64_t start = 0; start < numTestExamples;
+                start += inferenceBatch) {
+            const uint64_t cols =
+                std::min<uint64_t>(inferenceBatch, numTestExamples - start);
+            Eigen::MatrixXd out =
+                ann(testAnnSet.examples.middleCols(start, cols));
+        }
+        report("ann inference", annInferenceTimer.seconds(), numTestExamples);
+    } catch (ml::RuntimeException& e) {
+        std::cout << e.what() << "\n";
+        return -1;
+    }
+}
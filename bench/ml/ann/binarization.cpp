@@ -0,0 +1,23 @@
+#include <bench/synthetic.h>
+#include <ml/ann/activations.h>
+#include <ml/ann/binarization.h>
+#include <ml/ann/connection.h>
+#include <ml/bit_vec.h>
+
+#include <benchmark/benchmark.h>
+#include <Eigen/Dense>
+
+static void XNORConnectionTransform(benchmark::State& state) {
+    ml::ann::detail::BinaryFullConnection<784, 200> conn;
+    conn.init();
+    ml::ann::detail::XNORConnection<784, 200> xconn;
+    xconn.init(conn);
+    const auto input = ml::ann::detail::binarizeInput<784>(
+            bench::randomMatrix(784, 1).col(0));
+    for (auto _: state) {
+        auto output = xconn.binaryTransform(input, ml::ann::Linear());
+        benchmark::DoNotOptimize(output);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(XNORConnectionTransform);
@@ -0,0 +1,43 @@
+#include <bench/synthetic.h>
+#include <ml/ann/connection.h>
+
+#include <benchmark/benchmark.h>
+#include <Eigen/Dense>
+
+typedef ml::ann::detail::FullConnection<784, 200> Connection;
+
+static void FullConnectionTransform(benchmark::State& state) {
+    Connection conn;
+    conn.init();
+    Eigen::MatrixXd input = bench::randomMatrix(784, state.range(0));
+    for (auto _: state) {
+        benchmark::DoNotOptimize(conn.transform(input).data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(FullConnectionTransform)->Arg(1)->Arg(32)->Arg(256);
+
+static void FullConnectionBackTransform(benchmark::State& state) {
+    Connection conn;
+    conn.init();
+    Eigen::MatrixXd delta = bench::randomMatrix(200, state.range(0));
+    for (auto _: state) {
+        Eigen::MatrixXd result = conn.backTransform(delta);
+        benchmark::DoNotOptimize(result.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(FullConnectionBackTransform)->Arg(1)->Arg(32)->Arg(256);
+
+static void FullConnectionPropagate(benchmark::State& state) {
+    Connection acc;
+    acc.zero();
+    Eigen::MatrixXd delta = bench::randomMatrix(200, state.range(0));
+    Eigen::MatrixXd activations = bench::randomMatrix(784, state.range(0));
+    for (auto _: state) {
+        acc.propagate(delta, activations);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(FullConnectionPropagate)->Arg(1)->Arg(32)->Arg(256);
@@ -0,0 +1,46 @@
+#include <bench/synthetic.h>
+#include <meta/tuple.h>
+#include <ml/ann.h>
+#include <ml/ann/feed_forward.h>
+#include <ml/ann/optimization.h>
+
+#include <benchmark/benchmark.h>
+#include <Eigen/Dense>
+
+typedef ml::ann::NetworkConf<
+    ml::ann::Input<784>,
+    ml::ann::FullyConnected<200>,
+    ml::ann::FullyConnected<784>> NetConf;
+
+static void FeedForward(benchmark::State& state) {
+    NetConf::Connections connections;
+    meta::tup_each([](auto& conn) { conn.init(); }, connections);
+    NetConf::Activations activations;
+    Eigen::MatrixXd input = bench::randomMatrix(784, state.range(0));
+    for (auto _: state) {
+        ml::ann::detail::feedForward(
+                input, connections, activations, NetConf::Layers{});
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(FeedForward)->Arg(1)->Arg(32)->Arg(256);
+
+static void BackProp(benchmark::State& state) {
+    NetConf::Connections connections;
+    meta::tup_each([](auto& conn) { conn.init(); }, connections);
+    NetConf::Connections accumulator;
+    meta::tup_each([](auto& conn) { conn.zero(); }, accumulator);
+    NetConf::Activations activations;
+    NetConf::Delta delta;
+    Eigen::MatrixXd input = bench::randomMatrix(784, state.range(0));
+    ml::ann::detail::feedForward(
+            input, connections, activations, NetConf::Layers{});
+    for (auto _: state) {
+        ml::ann::detail::backProp(
+                input, activations, connections, delta, accumulator);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BackProp)->Arg(1)->Arg(32)->Arg(256);
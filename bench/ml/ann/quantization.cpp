@@ -0,0 +1,41 @@
+#include <ml/ann/quantization.h>
+
+#include <cstdint>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+namespace {
+
+std::vector<int8_t> int8Values(unsigned n, unsigned seed) {
+    std::vector<int8_t> result(n);
+    for (unsigned i = 0; i < n; ++i) {
+        result[i] = static_cast<int8_t>((i * 97 + seed) % 255 - 127);
+    }
+    return result;
+}
+
+} // namespace
+
+static void DotInt8Scalar(benchmark::State& state) {
+    const auto a = int8Values(state.range(0), 13);
+    const auto b = int8Values(state.range(0), 200);
+    for (auto _: state) {
+        benchmark::DoNotOptimize(ml::ann::detail::dotInt8Scalar(
+                    a.data(), b.data(), a.size()));
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(DotInt8Scalar)->Arg(200)->Arg(784);
+
+//! Dispatched kernel, AVX2 where the CPU supports it
+static void DotInt8(benchmark::State& state) {
+    const auto a = int8Values(state.range(0), 13);
+    const auto b = int8Values(state.range(0), 200);
+    for (auto _: state) {
+        benchmark::DoNotOptimize(ml::ann::detail::dotInt8(
+                    a.data(), b.data(), a.size()));
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(DotInt8)->Arg(200)->Arg(784);
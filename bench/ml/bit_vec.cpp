@@ -0,0 +1,67 @@
+#include <bench/synthetic.h>
+#include <ml/bit_vec.h>
+#include <ml/dataset/bit_matrix.h>
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+static void BitVecDot(benchmark::State& state) {
+    std::mt19937 gen(0);
+    auto a = bench::randomBitVec<784>(gen);
+    auto b = bench::randomBitVec<784>(gen);
+    for (auto _: state) {
+        benchmark::DoNotOptimize(a * b);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BitVecDot);
+
+static void BitVecDistance(benchmark::State& state) {
+    std::mt19937 gen(0);
+    auto a = bench::randomBitVec<784>(gen);
+    auto b = bench::randomBitVec<784>(gen);
+    for (auto _: state) {
+        benchmark::DoNotOptimize(distance(a, b));
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BitVecDistance);
+
+//! Hamming distances from an example to range(0) examples
+static void DistancesVecDataset(benchmark::State& state) {
+    std::mt19937 gen(0);
+    auto x = bench::randomBitVec<784>(gen);
+    std::vector<ml::BitVec<784>> rows(state.range(0));
+    for (auto& row: rows) {
+        row = bench::randomBitVec<784>(gen);
+    }
+    std::vector<unsigned> result(rows.size());
+    for (auto _: state) {
+        for (uint64_t i = 0; i < rows.size(); ++i) {
+            result[i] = distance(x, rows[i]);
+        }
+        benchmark::DoNotOptimize(result.data());
+    }
+    state.SetItemsProcessed(state.iterations() * rows.size());
+}
+BENCHMARK(DistancesVecDataset)->Arg(10000);
+
+static void DistancesBitMatrix(benchmark::State& state) {
+    std::mt19937 gen(0);
+    auto x = bench::randomBitVec<784>(gen);
+    ml::BitMatrix<784> rows(state.range(0));
+    for (uint64_t i = 0; i < rows.size(); ++i) {
+        set(i, bench::randomBitVec<784>(gen), 0, rows);
+    }
+    for (auto _: state) {
+        auto result = distances(x, rows);
+        benchmark::DoNotOptimize(result.data());
+    }
+    state.SetItemsProcessed(state.iterations() * rows.size());
+}
+BENCHMARK(DistancesBitMatrix)->Arg(10000);
@@ -0,0 +1,48 @@
+#include <bench/synthetic.h>
+#include <ml/kernels.h>
+
+#include <random>
+
+#include <benchmark/benchmark.h>
+#include <Eigen/Dense>
+
+template <typename Kernel>
+static void KernelBitVec(benchmark::State& state) {
+    std::mt19937 gen(0);
+    auto a = bench::randomBitVec<784>(gen);
+    auto b = bench::randomBitVec<784>(gen);
+    Kernel kernel;
+    for (auto _: state) {
+        benchmark::DoNotOptimize(kernel(a, b));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK_TEMPLATE(KernelBitVec, ml::RBFKernel);
+BENCHMARK_TEMPLATE(KernelBitVec, ml::PolynomialKernel<2>);
+
+template <typename Kernel>
+static void KernelEigenRow(benchmark::State& state) {
+    Eigen::RowVectorXd a = Eigen::RowVectorXd::Random(state.range(0));
+    Eigen::RowVectorXd b = Eigen::RowVectorXd::Random(state.range(0));
+    Kernel kernel;
+    for (auto _: state) {
+        benchmark::DoNotOptimize(kernel(a, b));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK_TEMPLATE(KernelEigenRow, ml::RBFKernel)->Arg(64)->Arg(784);
+BENCHMARK_TEMPLATE(KernelEigenRow, ml::PolynomialKernel<2>)->Arg(64)->Arg(784);
+
+//! Kernel values of all pairs of range(0) dense 784-dim examples
+template <typename Kernel>
+static void KernelBlock(benchmark::State& state) {
+    Eigen::MatrixXd x = Eigen::MatrixXd::Random(state.range(0), 784);
+    Kernel kernel;
+    for (auto _: state) {
+        Eigen::MatrixXd block = ml::kernelBlock(kernel, x, x);
+        benchmark::DoNotOptimize(block.data());
+    }
+    state.SetItemsProcessed(state.iterations() * x.rows() * x.rows());
+}
+BENCHMARK_TEMPLATE(KernelBlock, ml::RBFKernel)->Arg(64)->Arg(512);
+BENCHMARK_TEMPLATE(KernelBlock, ml::PolynomialKernel<2>)->Arg(64)->Arg(512);
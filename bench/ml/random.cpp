@@ -0,0 +1,55 @@
+#include <ml/random.h>
+
+#include <random>
+
+#include <benchmark/benchmark.h>
+#include <Eigen/Dense>
+
+//! Weights initialization as done before ml::Philox: a random_device and a
+//! Mersenne twister per matrix, one distribution call per coefficient
+static void FillMT19937(benchmark::State& state) {
+    Eigen::MatrixXd m(state.range(0), 784);
+    for (auto _: state) {
+        std::random_device rd;
+        std::mt19937 gen(rd());
+        std::uniform_real_distribution<> dis(-1.0, 1.0);
+        for (unsigned row = 0; row < m.rows(); ++row) {
+            for (unsigned col = 0; col < m.cols(); ++col) {
+                m(row, col) = dis(gen);
+            }
+        }
+        benchmark::DoNotOptimize(m.data());
+    }
+    state.SetItemsProcessed(state.iterations() * m.size());
+}
+BENCHMARK(FillMT19937)->Arg(1)->Arg(200);
+
+static void FillPhilox(benchmark::State& state) {
+    Eigen::MatrixXd m(state.range(0), 784);
+    for (auto _: state) {
+        ml::randomStream().fillUniform(m, -1.0, 1.0);
+        benchmark::DoNotOptimize(m.data());
+    }
+    state.SetItemsProcessed(state.iterations() * m.size());
+}
+BENCHMARK(FillPhilox)->Arg(1)->Arg(200);
+
+//! Random start positions of SMO scans
+static void BelowRandomDevice(benchmark::State& state) {
+    std::random_device rd;
+    std::uniform_int_distribution<uint64_t> dist(0, 59999);
+    for (auto _: state) {
+        benchmark::DoNotOptimize(dist(rd));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BelowRandomDevice);
+
+static void BelowPhilox(benchmark::State& state) {
+    ml::Philox gen(0);
+    for (auto _: state) {
+        benchmark::DoNotOptimize(gen.below(60000));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BelowPhilox);
@@ -0,0 +1,50 @@
+#include <bench/synthetic.h>
+#include <ml/kernels.h>
+#include <ml/svm/smo.h>
+#include <ml/svm/svc.h>
+
+#include <benchmark/benchmark.h>
+
+//! Gaussian kernel of the width used by minst. With noise 0.1 examples
+//! of a class are about 140 bits apart, so the kernel matrix is far from
+//! the identity and the solver has real work to do.
+static const double SIGMA = 15.0;
+
+template <typename Kernel>
+static void SMOSolve(benchmark::State& state, Kernel kernelFn) {
+    auto dataset = bench::binaryDataset<784>(state.range(0), 0.1);
+    auto kernel = ml::svc::detail::wrapKernel(kernelFn, dataset);
+    for (auto _: state) {
+        auto solution = ml::svm::smo::solve(dataset, 0.5, kernel);
+        benchmark::DoNotOptimize(solution.second);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK_CAPTURE(SMOSolve, rbf, ml::RBFKernel(SIGMA))
+    ->Arg(250)->Arg(500)->Arg(1000)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(SMOSolve, poly, ml::PolynomialKernel<2>())
+    ->Arg(250)->Arg(500)->Arg(1000)->Unit(benchmark::kMillisecond);
+
+//! range(1): sparse error cache, range(2): kernel cache budget in megabytes,
+//! range(3): number of threads
+static void SMOSolveParams(benchmark::State& state) {
+    auto dataset = bench::binaryDataset<784>(state.range(0), 0.1);
+    auto kernel =
+        ml::svc::detail::wrapKernel(ml::RBFKernel(SIGMA), dataset);
+    ml::svm::smo::Params params;
+    params.sparseErrorCache = state.range(1);
+    params.kernelCacheBytes = static_cast<uint64_t>(state.range(2)) << 20;
+    params.numThreads = state.range(3);
+    params.parallelThreshold = 0;
+    for (auto _: state) {
+        ml::svm::smo::Stats stats;
+        auto solution = ml::svm::smo::solve(dataset, 0.5, kernel, params, stats);
+        benchmark::DoNotOptimize(solution.second);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(SMOSolveParams)
+    ->Args({1000, 0, 0, 1})->Args({1000, 1, 0, 1})
+    ->Args({1000, 0, 64, 1})->Args({1000, 1, 64, 1})
+    ->Args({4000, 0, 0, 1})->Args({4000, 0, 0, 2})->Args({4000, 0, 0, 4})
+    ->Unit(benchmark::kMillisecond);
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <ml/bit_vec.h>
+#include <ml/dataset/dataset.h>
+
+#include <cstdint>
+#include <random>
+
+#include <Eigen/Dense>
+
+namespace bench {
+
+//! Random bit vector with roughly density * SIZE bits set
+template <unsigned SIZE, typename Generator>
+ml::BitVec<SIZE> randomBitVec(Generator& gen, double density = 0.2) {
+    std::bernoulli_distribution dis(density);
+    ml::BitVec<SIZE> result;
+    for (unsigned i = 0; i < SIZE; ++i) {
+        if (dis(gen)) {
+            result.set(i);
+        }
+    }
+    return result;
+}
+
+//! Binary classification dataset of two noisy bit patterns
+template <unsigned SIZE>
+ml::VecDataset<ml::BitVec<SIZE>, int> binaryDataset(
+        uint64_t numExamples, double noise = 0.1, unsigned seed = 0) {
+    std::mt19937 gen(seed);
+    std::bernoulli_distribution flip(noise);
+    ml::VecDataset<ml::BitVec<SIZE>, int> result(numExamples);
+    for (uint64_t i = 0; i < numExamples; ++i) {
+        const int cls = i % 2 ? 1 : -1;
+        ml::BitVec<SIZE> example;
+        for (unsigned bit = 0; bit < SIZE; ++bit) {
+            const bool inPattern = (bit < SIZE / 2) == (cls == 1);
+            if (inPattern != flip(gen)) {
+                example.set(bit);
+            }
+        }
+        set(i, example, cls, result);
+    }
+    return result;
+}
+
+inline Eigen::MatrixXd randomMatrix(unsigned rows, unsigned cols) {
+    return Eigen::MatrixXd::Random(rows, cols);
+}
+
+} // namespace bench
@@ -1,28 +1,35 @@
 #include "read_minst.h"
 #include <ml/bit_vec.h>
 #include <ml/dag_muticlass.h>
-#include <ml/dataset/dataset.h>
+#include <ml/dataset/bit_matrix.h>
 #include <ml/exception.h>
 #include <ml/kernels.h>
+#include <ml/knn.h>
+#include <ml/pair_classifier_cache.h>
+#include <ml/svm/cascade.h>
+#include <ml/svm/feature_maps.h>
+#include <ml/svm/lasvm.h>
 #include <ml/svm/svc.h>
+#include <ml/validation.h>
 
+#include <chrono>
 #include <cstdint>
+#include <functional>
 #include <iostream>
+#include <memory>
+#include <sstream>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include <boost/program_options.hpp>
 
-typedef ml::VecDataset<MINSTImage, int> MINSTDataset;
+typedef ml::BitMatrix<28 * 28> MINSTDataset;
 
 MINSTDataset
 readMINSTDataset(const std::string& imagesFile, const std::string& labelsFile) {
     auto data = readMINSTData(imagesFile, labelsFile);
-    MINSTDataset result;
-    result.examples = std::move(data.first);
-    result.labels.resize(result.examples.size());
-    std::copy(data.second.begin(), data.second.end(), result.labels.begin());
-    return result;
+    return MINSTDataset(data.first, data.second);
 }
 
 template <typename Classifier>
@@ -36,6 +43,77 @@ float test(Classifier&& classifier, const MINSTDataset& dataset) {
     return errorsCount / static_cast<float>(size(dataset));
 }
 
+struct GridConfig {
+    std::string kernel;
+    double C;
+    double sigma;
+};
+
+std::ostream& operator<< (std::ostream& o, const GridConfig& config) {
+    o << "kernel = " << config.kernel << ", C = " << config.C;
+    if (config.kernel == "gaussian") {
+        o << ", sigma = " << config.sigma;
+    }
+    return o;
+}
+
+//! k-fold cross-validation of DAG SVM classifiers for every combination of
+//! kernel, C and (gaussian kernel only) sigma
+void gridSearch(
+        const MINSTDataset& dataset,
+        const std::vector<std::string>& kernels,
+        const std::vector<double>& Cs,
+        const std::vector<double>& sigmas,
+        const ml::svm::smo::Params& smoParams,
+        const ml::validation::Params& params) {
+    std::vector<GridConfig> configs;
+    for (const auto& kernel: kernels) {
+        for (double C: Cs) {
+            if (kernel == "gaussian") {
+                for (double sigma: sigmas) {
+                    configs.push_back({kernel, C, sigma});
+                }
+            } else {
+                configs.push_back({kernel, C, 0.0});
+            }
+        }
+    }
+    typedef std::function<int(const MINSTImage&)> Classifier;
+    auto wrap = [] (auto&& classifier) {
+        auto shared = std::make_shared<std::decay_t<decltype(classifier)>>(
+                std::move(classifier));
+        return Classifier([shared] (const MINSTImage& x) {
+            return (*shared)(x);
+        });
+    };
+    auto train = [&] (const auto& fold, const GridConfig& config) {
+        auto model = [&] (auto kernelFn) {
+            return [&config, &smoParams, kernelFn] (const MINSTDataset& ds) {
+                return ml::svc::train(ds, config.C, kernelFn, smoParams);
+            };
+        };
+        if (config.kernel == "linear") {
+            return wrap(ml::dag::train(fold,
+                [&config] (const MINSTDataset& ds) {
+                    return ml::svc::train(ds, config.C, ml::LinearKernel());
+                }));
+        } else if (config.kernel == "gaussian") {
+            return wrap(ml::dag::train(fold,
+                        model(ml::RBFKernel(config.sigma))));
+        }
+        return wrap(ml::dag::train(fold, model(ml::PolynomialKernel<2>())));
+    };
+
+    const auto results =
+        ml::validation::gridSearch(dataset, configs, train, params);
+    for (const auto& result: results) {
+        std::cout << result.config << ": accuracy " << result.accuracy
+                  << ", train " << result.trainSeconds << " s, test "
+                  << result.testSeconds << " s\n";
+    }
+    std::cout << "Best: " << ml::validation::best(results).config << "\n";
+}
+
 int main(int argc, char** argv) {
     namespace po = boost::program_options;
     po::options_description desc("Allowed options");
@@ -50,7 +128,57 @@ int main(int argc, char** argv) {
         ("test-labels,l", po::value<std::string>(),
             "File with test labels.")
         ("kernel,k", po::value<std::string>()->default_value("poly"),
-            "Kernel type: 'gaussian' for gaussian RBF or 'poly' for polynomial.")
+            "Kernel type: 'gaussian' for gaussian RBF, 'poly' for polynomial or "
+            "'linear'.")
+        ("approximation,a", po::value<std::string>()->default_value("none"),
+            "Kernel approximation: 'none' for exact kernel SVM, 'rff' for "
+            "random Fourier features (gaussian kernel only) or 'nystrom'.")
+        ("features,f", po::value<unsigned>()->default_value(1000),
+            "Number of features (landmarks) of kernel approximation.")
+        ("kernel-cache", po::value<unsigned>()->default_value(0),
+            "Memory budget of SMO kernel rows cache, in megabytes.")
+        ("shared-kernel-cache", po::value<unsigned>()->default_value(0),
+            "Memory budget of kernel values cache shared by all pair "
+            "classifiers, in megabytes (SMO without cascade only).")
+        ("sparse-error-cache",
+            "Update SMO errors of non-bound examples only.")
+        ("smo-threads", po::value<unsigned>()->default_value(1),
+            "Number of threads used by SMO for large binary problems.")
+        ("max-support-vectors", po::value<uint64_t>()->default_value(0),
+            "Budget of support vectors of every pair classifier, larger "
+            "sets are compressed after training (0 keeps all of them). "
+            "Unreduced classifiers are trained and tested as well to report "
+            "accuracy loss and speedup.")
+        ("pair-cache", po::value<std::string>(),
+            "Existing directory caching pair classifiers between runs, only "
+            "pairs of classes whose examples changed are retrained (kernel "
+            "SVM trained by SMO or cascade with a single C only).")
+        ("online",
+            "Train pair classifiers with online LASVM solver in a single "
+            "pass instead of SMO.")
+        ("cascade", po::value<unsigned>()->default_value(1),
+            "Number of partitions of cascade SVM training (1 disables it).")
+        ("C,C", po::value<std::vector<double>>()->multitoken()
+                ->default_value(std::vector<double>{0.5}, "0.5"),
+            "Regularization parameter. Several increasing values are swept "
+            "with warm started SMO (kernel SVM without cascade only).")
+        ("sigma", po::value<std::vector<double>>()->multitoken()
+                ->default_value(std::vector<double>{15.0}, "15"),
+            "Gaussian kernel width. Several values are only used by grid "
+            "search.")
+        ("knn", po::value<unsigned>()->default_value(0),
+            "Number of neighbours of k-NN classifier used instead of SVM "
+            "(0 disables it).")
+        ("cv-folds", po::value<unsigned>()->default_value(0),
+            "Number of cross-validation folds. If set, every combination of "
+            "--cv-kernels, C and sigma is evaluated on the training set.")
+        ("cv-kernels", po::value<std::vector<std::string>>()->multitoken()
+                ->default_value(std::vector<std::string>{"poly", "gaussian"},
+                    "poly gaussian"),
+            "Kernel types compared by grid search.")
+        ("cv-threads", po::value<unsigned>()->default_value(
+                ml::defaultNumThreads()),
+            "Number of threads running grid search jobs.")
     ;
 
     po::variables_map vars;
@@ -68,6 +196,65 @@ int main(int argc, char** argv) {
         return 1;
     }
 
+    // Only exact kernel SVM pair classifiers trained one C at a time by SMO
+    // or cascade are cached
+    if (vars.count("pair-cache") && (vars.count("online") ||
+            vars["shared-kernel-cache"].as<unsigned>() > 0 ||
+            vars["C"].as<std::vector<double>>().size() > 1 ||
+            vars["kernel"].as<std::string>() == "linear" ||
+            vars["approximation"].as<std::string>() != "none" ||
+            vars["knn"].as<unsigned>() > 0 ||
+            vars["cv-folds"].as<unsigned>() > 1)) {
+        std::cout << "--pair-cache can't be combined with --online, "
+                     "--shared-kernel-cache, several values of C, linear "
+                     "kernel, kernel approximation, k-NN or "
+                     "cross-validation\n";
+        return 1;
+    }
+
+    // Several values of C are swept by the exact kernel SVM trained by SMO
+    // without cascade, or compared by cross-validation
+    if (vars["C"].as<std::vector<double>>().size() > 1 &&
+            vars["cv-folds"].as<unsigned>() <= 1 && (vars.count("online") ||
+            vars["cascade"].as<unsigned>() > 1 ||
+            vars["shared-kernel-cache"].as<unsigned>() > 0 ||
+            vars["kernel"].as<std::string>() == "linear" ||
+            vars["approximation"].as<std::string>() != "none" ||
+            vars["knn"].as<unsigned>() > 0)) {
+        std::cout << "Several values of C can't be combined with --online, "
+                     "--cascade, --shared-kernel-cache, linear kernel, "
+                     "kernel approximation or k-NN\n";
+        return 1;
+    }
+
+    // Online solver has no SMO options and trains pair classifiers on their
+    // own
+    if (vars.count("online") && (vars["cascade"].as<unsigned>() > 1 ||
+            vars["kernel-cache"].as<unsigned>() > 0 ||
+            vars["shared-kernel-cache"].as<unsigned>() > 0 ||
+            vars.count("sparse-error-cache") ||
+            vars["smo-threads"].as<unsigned>() > 1)) {
+        std::cout << "--online can't be combined with --cascade, "
+                     "--kernel-cache, --shared-kernel-cache, "
+                     "--sparse-error-cache or --smo-threads\n";
+        return 1;
+    }
+
+    // Cascade trainer has no access to the shared kernel cache
+    if (vars["shared-kernel-cache"].as<unsigned>() > 0 &&
+            vars["cascade"].as<unsigned>() > 1) {
+        std::cout << "--shared-kernel-cache can't be combined with "
+                     "--cascade\n";
+        return 1;
+    }
+
+    if (vars["sigma"].as<std::vector<double>>().size() > 1 &&
+            vars["cv-folds"].as<unsigned>() <= 1) {
+        std::cout << "Several values of sigma are only compared by "
+                     "cross-validation, set --cv-folds\n";
+        return 1;
+    }
+
     auto minstTrainingSet = readMINSTDataset(
             vars["training-images"].as<std::string>(),
             vars["training-labels"].as<std::string>());
@@ -76,27 +263,205 @@ int main(int argc, char** argv) {
             vars["test-images"].as<std::string>(),
             vars["test-labels"].as<std::string>());
 
-    const double REGULARIZATION_PARAM = 0.5;
-    if (vars["kernel"].as<std::string>() == "poly") {
+    const auto Cs = vars["C"].as<std::vector<double>>();
+    const double REGULARIZATION_PARAM = Cs.front();
+    const auto sigmas = vars["sigma"].as<std::vector<double>>();
+    const double SIGMA = sigmas.front();
+    const std::string kernel = vars["kernel"].as<std::string>();
+    const std::string approximation = vars["approximation"].as<std::string>();
+    const unsigned numFeatures = vars["features"].as<unsigned>();
+    ml::svm::smo::Params smoParams;
+    smoParams.kernelCacheBytes =
+        static_cast<uint64_t>(vars["kernel-cache"].as<unsigned>()) << 20;
+    smoParams.sparseErrorCache = vars.count("sparse-error-cache");
+    const uint64_t sharedCacheBytes =
+        static_cast<uint64_t>(vars["shared-kernel-cache"].as<unsigned>()) << 20;
+    smoParams.numThreads = vars["smo-threads"].as<unsigned>();
+    smoParams.maxSupportVectors = vars["max-support-vectors"].as<uint64_t>();
+    const auto cvKernels = vars["cv-kernels"].as<std::vector<std::string>>();
+    for (const auto& k: cvKernels) {
+        if (k != "poly" && k != "gaussian" && k != "linear") {
+            std::cout << "Unknown kernel type: " << k << "\n";
+            return 1;
+        }
+    }
+    if (kernel != "poly" && kernel != "gaussian" && kernel != "linear") {
+        std::cout << "Unknown kernel type: " << kernel << "\n";
+        return 1;
+    }
+    if (vars["knn"].as<unsigned>() > 0) {
+        auto classifier =
+            ml::knn::train(minstTrainingSet, vars["knn"].as<unsigned>());
+        std::cout << "Error rate: "
+                  << test(classifier, minstTestSet) << "\n";
+        return 0;
+    }
+    if (vars["cv-folds"].as<unsigned>() > 1) {
+        ml::validation::Params cvParams;
+        cvParams.numFolds = vars["cv-folds"].as<unsigned>();
+        cvParams.numThreads = vars["cv-threads"].as<unsigned>();
+        gridSearch(minstTrainingSet, cvKernels, Cs, sigmas,
+                smoParams, cvParams);
+        return 0;
+    }
+    if (kernel == "linear") {
         auto classifier = ml::dag::train(minstTrainingSet,
             [REGULARIZATION_PARAM] (const MINSTDataset& ds) {
                 return ml::svc::train(
-                    ds, REGULARIZATION_PARAM, ml::PolynomialKernel<2>());
+                    ds, REGULARIZATION_PARAM, ml::LinearKernel());
             });
         std::cout << "Error rate: "
                   << test(classifier, minstTestSet) << "\n";
-    } else if (vars["kernel"].as<std::string>() == "gaussian") {
+    } else if (approximation == "rff" && kernel == "gaussian") {
+        ml::svm::RandomFourierFeatures featureMap(
+                ml::RBFKernel(SIGMA), MINSTImage::size(), numFeatures);
         auto classifier = ml::dag::train(minstTrainingSet,
-            [REGULARIZATION_PARAM] (const MINSTDataset& ds) {
-                return ml::svc::train(
-                    ds, REGULARIZATION_PARAM, ml::RBFKernel(15.0));
+            [REGULARIZATION_PARAM, &featureMap] (const MINSTDataset& ds) {
+                return ml::svc::trainWithFeatureMap(
+                    ds, REGULARIZATION_PARAM, featureMap);
             });
         std::cout << "Error rate: "
                   << test(classifier, minstTestSet) << "\n";
-    } else {
-        std::cout << "Unknown kernel type: "
-                  << vars["kernel"].as<std::string>() << "\n";
+    } else if (approximation == "nystrom") {
+        auto trainNystrom = [&] (auto kernelFn) {
+            auto classifier = ml::dag::train(minstTrainingSet,
+                [REGULARIZATION_PARAM, numFeatures, kernelFn]
+                (const MINSTDataset& ds) {
+                    return ml::svc::trainWithFeatureMap(
+                        ds, REGULARIZATION_PARAM,
+                        ml::svm::nystrom(kernelFn, ds, numFeatures));
+                });
+            std::cout << "Error rate: "
+                      << test(classifier, minstTestSet) << "\n";
+        };
+        if (kernel == "poly") {
+            trainNystrom(ml::PolynomialKernel<2>());
+        } else {
+            trainNystrom(ml::RBFKernel(SIGMA));
+        }
+    } else if (approximation != "none") {
+        std::cout << "Unsupported kernel approximation: " << approximation
+                  << " (" << kernel << " kernel)\n";
         return 1;
+    } else {
+        ml::svm::cascade::Params cascadeParams;
+        cascadeParams.numPartitions = vars["cascade"].as<unsigned>();
+        cascadeParams.smo = smoParams;
+        auto trainSVM = [&] (auto kernelFn) {
+            if (Cs.size() > 1) {
+                auto classifiers = ml::dag::trainPath(minstTrainingSet,
+                    [&Cs, &smoParams, kernelFn] (const MINSTDataset& ds) {
+                        return ml::svc::trainPath(ds, Cs, kernelFn, smoParams);
+                    });
+                for (unsigned i = 0; i < Cs.size(); ++i) {
+                    std::cout << "C = " << Cs[i] << ", error rate: "
+                              << test(classifiers[i], minstTestSet) << "\n";
+                    std::cout << "Solver stats: "
+                              << classifiers[i].stats() << "\n";
+                }
+                return;
+            }
+            if (vars.count("online")) {
+                ml::svm::lasvm::Params onlineParams;
+                onlineParams.maxSupportVectors = smoParams.maxSupportVectors;
+                auto classifier = ml::dag::train(minstTrainingSet,
+                    [&] (const MINSTDataset& ds) {
+                        return ml::svc::trainOnline(ds, REGULARIZATION_PARAM,
+                            kernelFn, onlineParams);
+                    });
+                std::cout << "Error rate: "
+                          << test(classifier, minstTestSet) << "\n";
+                return;
+            }
+            if (sharedCacheBytes > 0) {
+                ml::svm::smo::SharedKernelCache cache(sharedCacheBytes);
+                auto classifier = ml::dag::train(minstTrainingSet,
+                    [&] (const MINSTDataset& ds,
+                         const std::vector<unsigned>& indices) {
+                        return ml::svc::train(ds, REGULARIZATION_PARAM,
+                            kernelFn, smoParams, cache, indices);
+                    });
+                std::cout << "Error rate: "
+                          << test(classifier, minstTestSet) << "\n";
+                std::cout << "Shared kernel cache: " << cache.hits()
+                          << " hits, " << cache.misses() << " misses\n";
+                return;
+            }
+            // Trains and tests DAG of pair classifiers compressed to
+            // maxSupportVectors, returns error rate and test time
+            auto trainAndTest = [&] (uint64_t maxSupportVectors) {
+                auto params = cascadeParams;
+                params.smo.maxSupportVectors = maxSupportVectors;
+                auto model = [REGULARIZATION_PARAM, params, kernelFn]
+                    (const MINSTDataset& ds) {
+                        return params.numPartitions > 1 ?
+                            ml::svc::trainCascade(ds, REGULARIZATION_PARAM,
+                                kernelFn, params) :
+                            ml::svc::train(ds, REGULARIZATION_PARAM,
+                                kernelFn, params.smo);
+                    };
+                typedef ml::c12n::composite::PairClassifierCache Cache;
+                std::unique_ptr<Cache> cache;
+                if (vars.count("pair-cache")) {
+                    // Solver options which don't change the solution are
+                    // left out. SMO tolerance is a constant of the solver,
+                    // cached classifiers have to be removed when it changes.
+                    std::ostringstream modelKey;
+                    modelKey << "kernel " << kernel << " sigma " << SIGMA
+                             << " C " << REGULARIZATION_PARAM
+                             << " cascade " << cascadeParams.numPartitions
+                             << " max-support-vectors "
+                             << maxSupportVectors
+                             << " sparse-error-cache "
+                             << smoParams.sparseErrorCache
+                             << " seed " << smoParams.seed;
+                    cache.reset(new Cache(
+                                vars["pair-cache"].as<std::string>(),
+                                modelKey.str()));
+                }
+                const auto trainStart = std::chrono::steady_clock::now();
+                auto classifier = cache ?
+                    ml::dag::train(minstTrainingSet, model, *cache) :
+                    ml::dag::train(minstTrainingSet, model);
+                const std::chrono::duration<double> trainTime =
+                    std::chrono::steady_clock::now() - trainStart;
+                std::cout << "Train time: " << trainTime.count()
+                          << " s\n";
+                if (cache) {
+                    std::cout << "Pair classifier cache: " << cache->hits()
+                              << " loaded, " << cache->misses()
+                              << " trained\n";
+                }
+                const auto testStart = std::chrono::steady_clock::now();
+                const float errorRate = test(classifier, minstTestSet);
+                const std::chrono::duration<double> testTime =
+                    std::chrono::steady_clock::now() - testStart;
+                std::cout << "Error rate: " << errorRate << "\n";
+                std::cout << "Test time: " << testTime.count() << " s\n";
+                std::cout << "Solver stats: " << classifier.stats() << "\n";
+                return std::make_pair(errorRate, testTime.count());
+            };
+            const uint64_t budget = smoParams.maxSupportVectors;
+            if (budget == 0) {
+                trainAndTest(0);
+                return;
+            }
+            // Unreduced classifiers are the baseline of accuracy loss and
+            // speedup of the support vector budget
+            std::cout << "Unreduced:\n";
+            const auto unreduced = trainAndTest(0);
+            std::cout << "Reduced to " << budget
+                      << " support vectors per pair:\n";
+            const auto reduced = trainAndTest(budget);
+            std::cout << "Error rate change: "
+                      << reduced.first - unreduced.first
+                      << ", test speedup: "
+                      << unreduced.second / reduced.second << "x\n";
+        };
+        if (kernel == "poly") {
+            trainSVM(ml::PolynomialKernel<2>());
+        } else {
+            trainSVM(ml::RBFKernel(SIGMA));
+        }
     }
 }
-
@@ -11,6 +11,7 @@
 
 #include <cmath>
 #include <tuple>
+#include <type_traits>
 
 namespace ml {
 namespace ann {
@@ -60,12 +61,32 @@ public:
         : connections_(std::move(connections)) {
     }
 
+    //! Small networks applied to inputs of static width are evaluated with
+    //! fixed-size matrices, everything else goes through dynamic ones.
     template <typename Input>
     auto operator() (const Input& input) const {
+        typedef typename NetConf::Layers Layers;
+        return predict(input, detail::FitsFixedSize<
+                    Layers, Input::ColsAtCompileTime>{});
+    }
+
+    const typename NetConf::Connections& connections() const {
+        return connections_;
+    }
+
+private:
+    template <typename Input>
+    auto predict(const Input& input, std::true_type) const {
+        return detail::feedForwardFixed(
+                input, connections_, typename NetConf::Layers{});
+    }
+
+    template <typename Input>
+    auto predict(const Input& input, std::false_type) const {
         return detail::feedForward(
                 input, connections_, typename NetConf::Layers{});
     }
-private:
+
     typename NetConf::Connections connections_;
 };
 
@@ -0,0 +1,199 @@
+#pragma once
+
+#include <meta/meta.h>
+#include <meta/tuple.h>
+#include <ml/ann.h>
+#include <ml/ann/connection.h>
+#include <ml/bit_vec.h>
+#include <ml/exception.h>
+
+#include <cstdint>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+#include <Eigen/Dense>
+
+namespace ml {
+namespace ann {
+namespace detail {
+
+//! BinaryFullConnection with sign bits of weights packed into a BitVec per
+//! output node. Dot product of +-1 vectors of length n is n minus twice
+//! the number of differing bits, so evaluation is XNOR and popcount.
+template <unsigned inSize, unsigned outSize>
+class XNORConnection {
+public:
+    XNORConnection() : rows_(outSize) {
+        scales_.fill(1.0);
+        bias_.fill(0.0);
+    }
+
+    void init(const BinaryFullConnection<inSize, outSize>& conn) {
+        const auto& weights = conn.weights();
+        for (unsigned row = 0; row < outSize; ++row) {
+            rows_[row] = BitVec<inSize>();
+            for (unsigned col = 0; col < inSize; ++col) {
+                if (weights(row, col) >= 0.0) {
+                    rows_[row].set(col);
+                }
+            }
+        }
+        scales_ = conn.scales();
+        bias_ = conn.bias();
+    }
+
+    //! Preactivation of output node row for binarized input
+    double transform(const BitVec<inSize>& input, unsigned row) const {
+        const int dot = static_cast<int>(inSize) -
+            2 * static_cast<int>(distance(input, rows_[row]));
+        return scales_(row) * dot + bias_(row);
+    }
+
+    template <typename Output>
+    void transform(const BitVec<inSize>& input, Output& output) const {
+        for (unsigned row = 0; row < outSize; ++row) {
+            output(row) = transform(input, row);
+        }
+    }
+
+    //! Activations binarized for the next connection, bit row is set if
+    //! activation of output node row is non-negative
+    template <typename Activation>
+    BitVec<outSize> binaryTransform(
+            const BitVec<inSize>& input, Activation act) const {
+        BitVec<outSize> result;
+        for (unsigned row = 0; row < outSize; ++row) {
+            if (act(transform(input, row)) >= 0.0) {
+                result.set(row);
+            }
+        }
+        return result;
+    }
+
+    static uint64_t bytes() {
+        return outSize * (sizeof(BitVec<inSize>) + 2 * sizeof(double));
+    }
+
+private:
+    std::vector<BitVec<inSize>> rows_;
+    Eigen::Matrix<double, outSize, 1> scales_;
+    Eigen::Matrix<double, outSize, 1> bias_;
+};
+
+template <typename Connection>
+struct XNORSelector {};
+
+template <unsigned inSize, unsigned outSize>
+struct XNORSelector<BinaryFullConnection<inSize, outSize>> {
+    typedef XNORConnection<inSize, outSize> type;
+    static const unsigned numInputs = inSize;
+    static const unsigned numOutputs = outSize;
+};
+
+template <typename Connections>
+struct XNORConnections {};
+
+template <typename... Cs>
+struct XNORConnections<std::tuple<Cs...>> {
+    typedef std::tuple<typename XNORSelector<Cs>::type...> type;
+};
+
+//! Input binarized by BinarySign
+template <unsigned SIZE, typename Input>
+BitVec<SIZE> binarizeInput(const Input& input) {
+    BitVec<SIZE> result;
+    for (unsigned pos = 0; pos < SIZE; ++pos) {
+        if (input(pos) >= 0.0) {
+            result.set(pos);
+        }
+    }
+    return result;
+}
+
+} // namespace detail
+
+//! Inference of a network of BinaryFullyConnected layers with packed sign
+//! bits instead of double weights. Outputs match the training forward pass
+//! of the float network up to rounding.
+template <typename NetConf>
+class XNORClassifier {
+    typedef meta::apply<std::tuple, meta::tail<typename NetConf::Layers>>
+        LayersTuple;
+    static const size_t NUM_LAYERS = std::tuple_size<LayersTuple>::value;
+    typedef std::tuple_element_t<0, typename NetConf::Connections> First;
+    typedef std::tuple_element_t<
+            NUM_LAYERS - 1, typename NetConf::Connections> Last;
+    static const unsigned NUM_INPUTS = detail::XNORSelector<First>::numInputs;
+    static const unsigned NUM_OUTPUTS = detail::XNORSelector<Last>::numOutputs;
+
+public:
+    typedef typename detail::XNORConnections<
+                typename NetConf::Connections>::type Connections;
+
+    explicit XNORClassifier(const ANNClassifier<NetConf>& classifier) {
+        meta::tup_each(
+                [](auto& xconn, const auto& conn) { xconn.init(conn); },
+                connections_,
+                classifier.connections());
+    }
+
+    //! Output for input bits, set bits standing for +1
+    Eigen::VectorXd operator() (const BitVec<NUM_INPUTS>& input) const {
+        return evaluate<0>(input, IsLast<0>());
+    }
+
+    //! Outputs for columns of inputs binarized by BinarySign
+    template <typename Inputs>
+    Eigen::MatrixXd operator() (const Eigen::MatrixBase<Inputs>& inputs) const {
+        REQUIRE(inputs.rows() == NUM_INPUTS, "Invalid input size "
+            << inputs.rows() << " != " << static_cast<unsigned>(NUM_INPUTS));
+        Eigen::MatrixXd result(
+                static_cast<Eigen::Index>(NUM_OUTPUTS), inputs.cols());
+        for (unsigned col = 0; col < inputs.cols(); ++col) {
+            result.col(col) = (*this)(
+                    detail::binarizeInput<NUM_INPUTS>(inputs.col(col)));
+        }
+        return result;
+    }
+
+    uint64_t bytes() const {
+        uint64_t result = 0;
+        meta::tup_each(
+                [&result](const auto& xconn) { result += xconn.bytes(); },
+                connections_);
+        return result;
+    }
+
+private:
+    template <size_t pos>
+    using IsLast = std::integral_constant<bool, pos + 1 == NUM_LAYERS>;
+
+    template <size_t pos, typename Input>
+    Eigen::VectorXd evaluate(const Input& input, std::false_type) const {
+        typename std::tuple_element_t<pos, LayersTuple>::Activation act;
+        return evaluate<pos + 1>(
+                std::get<pos>(connections_).binaryTransform(input, act),
+                IsLast<pos + 1>());
+    }
+
+    template <size_t pos, typename Input>
+    Eigen::VectorXd evaluate(const Input& input, std::true_type) const {
+        typename std::tuple_element_t<pos, LayersTuple>::Activation act;
+        Eigen::VectorXd output(static_cast<Eigen::Index>(NUM_OUTPUTS));
+        std::get<pos>(connections_).transform(input, output);
+        return act(output);
+    }
+
+    Connections connections_;
+};
+
+//! XNOR and popcount inference of a trained network of
+//! BinaryFullyConnected layers
+template <typename NetConf>
+XNORClassifier<NetConf> binarize(const ANNClassifier<NetConf>& classifier) {
+    return XNORClassifier<NetConf>(classifier);
+}
+
+} // namespace ann
+} // namespace ml
@@ -1,7 +1,14 @@
 #pragma once
 
 #include <ml/exception.h>
-#include <random>
+#include <ml/random.h>
+
+//! Upper bound on the number of coefficients in a matrix for which
+//! fixed-size (stack allocated) Eigen types are used.
+#ifndef ML_ANN_FIXED_SIZE_LIMIT
+#define ML_ANN_FIXED_SIZE_LIMIT 1024
+#endif
+
 #include <Eigen/Dense>
 
 namespace ml {
@@ -10,23 +17,26 @@ namespace detail {
 
 namespace {
 
+//! Uniform values in [-1, 1) from a new stream of the global seed, see
+//! seedRandom
 template <typename Matrix>
 void fillRandom(Matrix& m) {
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_real_distribution<> dis(-1.0, 1.0);
-    for (unsigned row = 0; row < m.rows(); ++row) {
-        for (unsigned col = 0; col < m.cols(); ++col) {
-            m(row, col) = dis(gen);
-        }
-    }
+    randomStream().fillUniform(m, -1.0, 1.0);
 }
 
 } // namespace
 
+//! Weights of small connections have static size, the rest is allocated
+//! on the heap to keep stack usage under control.
+template <unsigned inSize, unsigned outSize>
+using Weights = Eigen::Matrix<
+        double, outSize,
+        inSize * outSize <= ML_ANN_FIXED_SIZE_LIMIT ?
+            static_cast<int>(inSize) : Eigen::Dynamic>;
+
 template <unsigned inSize, unsigned outSize>
 class FullConnection {
-    Eigen::Matrix<double, outSize, Eigen::Dynamic> weights_;
+    Weights<inSize, outSize> weights_;
     Eigen::Matrix<double, outSize, 1> bias_;
 
 public:
@@ -70,7 +80,6 @@ public:
     }
 
     // TODO: use a better name
-    // TODO: investigate problem with clang
     template <typename Input>
     Eigen::Matrix<double, outSize, Input::ColsAtCompileTime>
     transform(const Input& input) const {
@@ -101,11 +110,122 @@ public:
         bias_ -= learningRate * delta.bias_;
     }
 
-    template <typename OStream
-             ,unsigned inSize_
-             ,unsigned outSize_>
-    friend OStream& operator<< (
-            OStream& o, const FullConnection<inSize_, outSize_>& fc) {
+    template <typename OStream>
+    friend OStream& operator<< (OStream& o, const FullConnection& fc) {
+        return (o << fc.weights_);
+    }
+};
+
+//! Sign function of binarized networks, zero is mapped to +1
+struct BinarySign {
+    double operator()(double x) const {
+        return x >= 0.0 ? 1.0 : -1.0;
+    }
+};
+
+//! FullConnection whose weights and inputs are binarized by BinarySign in
+//! the forward pass, weights of every output node scaled by their mean
+//! absolute value (XNOR-Net, Rastegari et al., 2016). Real valued latent
+//! weights are trained and clipped to [-1, 1]; gradients pass through the
+//! sign functions unchanged (straight-through estimator).
+template <unsigned inSize, unsigned outSize>
+class BinaryFullConnection {
+    Weights<inSize, outSize> weights_;
+    //! Scaled binarized weights used by the forward and backward passes
+    Weights<inSize, outSize> binary_;
+    Eigen::Matrix<double, outSize, 1> scales_;
+    Eigen::Matrix<double, outSize, 1> bias_;
+
+    void binarize() {
+        scales_ = weights_.cwiseAbs().rowwise().mean();
+        binary_ = scales_.asDiagonal() * weights_.unaryExpr(BinarySign());
+    }
+
+public:
+    BinaryFullConnection()
+        : weights_(outSize, inSize), binary_(outSize, inSize) {}
+
+    //! Latent weights start within +-1/sqrt(inSize), so that scaled sums
+    //! of inSize binary terms don't saturate activations
+    void init() {
+        fillRandom(weights_);
+        weights_ /= std::sqrt(static_cast<double>(inSize));
+        fillRandom(bias_);
+        binarize();
+    }
+
+    template <typename Weights, typename Bias>
+    void initWith(const Weights& weights, const Bias& bias) {
+        REQUIRE(weights.rows() == outSize && weights.cols() == inSize,
+            "Invalid weights size ("
+            << weights.rows() << "x" << weights.cols() << ")"
+            " != (" << outSize << "x" << inSize << ")");
+        REQUIRE(bias.rows() == outSize && bias.cols() == 1,
+            "Invalid bias size ("
+            << bias.rows() << "x" << bias.cols() << ")"
+            " != (" << outSize << "x" << 1 << ")");
+        weights_ = weights.cwiseMax(-1.0).cwiseMin(1.0);
+        bias_ = bias;
+        binarize();
+    }
+
+    void zero() {
+        weights_.fill(0.0);
+        bias_.fill(0.0);
+    }
+
+    double squaredNorm() const {
+        return weights_.squaredNorm();
+    }
+
+    //! Latent real valued weights
+    const auto& weights() const {
+        return weights_;
+    }
+
+    //! Mean absolute latent weight of every output node
+    const auto& scales() const {
+        return scales_;
+    }
+
+    const auto& bias() const {
+        return bias_;
+    }
+
+    template <typename Input>
+    Eigen::Matrix<double, outSize, Input::ColsAtCompileTime>
+    transform(const Input& input) const {
+        return (binary_ * input.unaryExpr(BinarySign())).colwise() + bias_;
+    }
+
+    template <typename Input>
+    auto backTransform(const Input& delta) const {
+        return binary_.transpose() * delta;
+    }
+
+    template <typename Delta, typename Activations>
+    void propagate(Delta&& delta, Activations&& activations) {
+        weights_ += delta * activations.unaryExpr(BinarySign()).transpose();
+        bias_ += delta.rowwise().sum();
+    }
+
+    template <typename Regularizer>
+    void applyRegularizer(const Regularizer& rglrz, double learningRate) {
+        rglrz.apply(weights_, learningRate);
+        binarize();
+    }
+
+    void update(
+            const BinaryFullConnection& delta,
+            double learningRate) {
+        weights_ = (weights_ - learningRate * delta.weights_)
+            .cwiseMax(-1.0).cwiseMin(1.0);
+        bias_ -= learningRate * delta.bias_;
+        binarize();
+    }
+
+    template <typename OStream>
+    friend OStream& operator<< (OStream& o, const BinaryFullConnection& fc) {
         return (o << fc.weights_);
     }
 };
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <ml/ann.h>
+#include <ml/exception.h>
+#include <ml/hnsw.h>
+#include <ml/parallel.h>
+
+#include <meta/meta.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <tuple>
+
+#include <Eigen/Dense>
+
+namespace ml {
+namespace ann {
+
+//! Activations of the first hidden layer of a trained network (e.g. codes of
+//! an autoencoder) for columns of inputs. Inputs are fed through the first
+//! connection in batches of batchSize columns on numThreads threads.
+template <typename NetConf, typename Inputs>
+Eigen::MatrixXf encode(
+        const ANNClassifier<NetConf>& classifier,
+        const Inputs& inputs,
+        const unsigned batchSize = 1024,
+        const unsigned numThreads = defaultNumThreads()) {
+    typedef std::tuple_element_t<0,
+            meta::apply<std::tuple, meta::tail<typename NetConf::Layers>>>
+        Hidden;
+    REQUIRE(batchSize > 0, "Batch size must be positive");
+    const auto& connection = std::get<0>(classifier.connections());
+    const uint64_t N = inputs.cols();
+    const uint64_t numBatches = (N + batchSize - 1) / batchSize;
+    const unsigned numNodes = Hidden::numNodes;
+    Eigen::MatrixXf result(numNodes, N);
+    parallelRanges(0, numBatches, numThreads,
+        [&](unsigned, uint64_t begin, uint64_t end) {
+            typename Hidden::Activation act;
+            for (uint64_t batch = begin; batch < end; ++batch) {
+                const uint64_t start = batch * batchSize;
+                const uint64_t cols = std::min<uint64_t>(batchSize, N - start);
+                result.middleCols(start, cols) = act(connection.transform(
+                            inputs.middleCols(start, cols))).template cast<float>();
+            }
+        });
+    return result;
+}
+
+//! HNSW index of first hidden layer codes of dataset examples, for
+//! similarity search of examples encoded with encode()
+template <typename NetConf, typename Dataset>
+hnsw::Index indexEmbeddings(
+        const ANNClassifier<NetConf>& classifier,
+        const Dataset& dataset,
+        const hnsw::Params& params = hnsw::Params(),
+        const unsigned batchSize = 1024) {
+    return hnsw::Index(
+            encode(classifier, dataset.examples, batchSize, params.numThreads),
+            params);
+}
+
+} // namespace ann
+} // namespace ml
@@ -11,6 +11,8 @@ namespace ml {
 namespace ann {
 namespace detail {
 
+//! Input is read in place by the first connection, so it can be a block
+//! of a larger matrix, e.g. a chunk of a dataset, without copying it
 template <typename Input
          ,typename Connections
          ,typename Layers>
@@ -18,17 +20,68 @@ Eigen::MatrixXd feedForward(
         const Input& input,
         const Connections& connections,
         Layers) {
-    Eigen::MatrixXd result = input;
+    Eigen::MatrixXd result;
+    bool first = true;
     meta::tup_each(
-            [&result](const auto& conn, auto layer) {
+            [&result, &first, &input](const auto& conn, auto layer) {
                 typename decltype(layer)::Activation act;
-                result = act(conn.transform(result));
+                if (first) {
+                    result = act(conn.transform(input));
+                    first = false;
+                } else {
+                    result = act(conn.transform(result));
+                }
             },
             connections,
             meta::apply<std::tuple, meta::tail<Layers>>());
+    if (first) {
+        result = input;
+    }
     return result;
 }
 
+namespace {
+
+template <size_t pos, size_t end>
+struct FixedFeedForward {
+    template <typename Input, typename Connections, typename LayersTuple>
+    static auto apply(
+            const Input& input,
+            const Connections& connections,
+            LayersTuple layers) {
+        typename std::tuple_element_t<pos, LayersTuple>::Activation act;
+        return FixedFeedForward<pos + 1, end>::apply(
+                act(std::get<pos>(connections).transform(input)),
+                connections,
+                layers);
+    }
+};
+
+template <size_t end>
+struct FixedFeedForward<end, end> {
+    template <typename Input, typename Connections, typename LayersTuple>
+    static Input apply(const Input& input, const Connections&, LayersTuple) {
+        return input;
+    }
+};
+
+} // namespace
+
+//! Feed forward pass which keeps every intermediate result in a fixed-size
+//! matrix. Should be used only with inputs of static width and networks
+//! satisfying FitsFixedSize, so the whole pass stays on the stack.
+template <typename Input
+         ,typename Connections
+         ,typename Layers>
+auto feedForwardFixed(
+        const Input& input,
+        const Connections& connections,
+        Layers) {
+    typedef meta::apply<std::tuple, meta::tail<Layers>> LayersTuple;
+    return FixedFeedForward<0, std::tuple_size<LayersTuple>::value>::apply(
+            input, connections, LayersTuple());
+}
+
 template <typename Input
          ,typename Connections
          ,typename Activations
@@ -4,6 +4,8 @@
 #include <ml/ann/connection.h>
 #include <ml/ann/layer_types.h>
 
+#include <type_traits>
+
 #include <Eigen/Dense>
 
 namespace ml {
@@ -34,6 +36,14 @@ struct Layer<PrevLayer, FullyConnected<N, ActivationFn>> {
     typedef ActivationFn Activation;
 };
 
+template <typename PrevLayer
+         ,unsigned N
+         ,typename ActivationFn>
+struct Layer<PrevLayer, BinaryFullyConnected<N, ActivationFn>> {
+    static const unsigned numNodes = N;
+    typedef ActivationFn Activation;
+};
+
 template <typename PrevLayer
          ,unsigned N
          ,typename ActivationFn>
@@ -77,6 +87,17 @@ struct ConnectionSelector<
     typedef FullConnection<InputLayer::numNodes, OutputLayer::numNodes> type;
 };
 
+template <typename InputLayer
+         ,unsigned N
+         ,typename ActivationFn>
+struct ConnectionSelector<
+                InputLayer,
+                Layer<InputLayer, BinaryFullyConnected<N, ActivationFn>>> {
+    typedef Layer<InputLayer, BinaryFullyConnected<N, ActivationFn>> OutputLayer;
+    typedef BinaryFullConnection<
+                InputLayer::numNodes, OutputLayer::numNodes> type;
+};
+
 template <typename InputLayer
          ,typename OutputLayer>
 using Connection = typename ConnectionSelector<InputLayer, OutputLayer>::type;
@@ -84,6 +105,35 @@ using Connection = typename ConnectionSelector<InputLayer, OutputLayer>::type;
 template <typename Layer>
 using Nodes = Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>;
 
+//! True if every layer of the network evaluated on a batch of the given
+//! size fits into ML_ANN_FIXED_SIZE_LIMIT coefficients, and so do weights
+//! of every connection (see Weights), so that the whole pass uses
+//! fixed-size matrices.
+template <typename Layers, int batchSize>
+struct FitsFixedSize {};
+
+template <int batchSize>
+struct FitsFixedSize<meta::list<>, batchSize> : std::true_type {};
+
+template <typename Layer, int batchSize>
+struct FitsFixedSize<meta::list<Layer>, batchSize>
+    : std::integral_constant<bool,
+            batchSize != Eigen::Dynamic &&
+            static_cast<int>(Layer::numNodes) * batchSize <=
+                ML_ANN_FIXED_SIZE_LIMIT> {};
+
+template <typename InputLayer
+         ,typename OutputLayer
+         ,typename... Ls
+         ,int batchSize>
+struct FitsFixedSize<meta::list<InputLayer, OutputLayer, Ls...>, batchSize>
+    : std::integral_constant<bool,
+            FitsFixedSize<meta::list<InputLayer>, batchSize>::value &&
+            InputLayer::numNodes * OutputLayer::numNodes <=
+                ML_ANN_FIXED_SIZE_LIMIT &&
+            FitsFixedSize<
+                meta::list<OutputLayer, Ls...>, batchSize>::value> {};
+
 } // namespace detail
 } // namespace ann
 } // namespace ml
@@ -23,6 +23,14 @@ struct FullyConnected {
     typedef ActivationFn Activation;
 };
 
+//! Fully connected layer whose weights and inputs are binarized to +-1,
+//! evaluated with XNOR and popcount after training (see binarization.h)
+template <unsigned size
+         ,typename ActivationFn = Tanh>
+struct BinaryFullyConnected {
+    typedef ActivationFn Activation;
+};
+
 template <unsigned size
          ,typename ActivationFn = Tanh>
 struct SymmetricFullyConnected {
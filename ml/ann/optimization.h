@@ -3,6 +3,7 @@
 #include <meta/tuple.h>
 #include <ml/ann/params.h>
 #include <ml/ann/regularization.h>
+#include <ml/ann/telemetry.h>
 
 #include <algorithm>
 #include <cmath>
@@ -53,31 +54,85 @@ void gradDescent(const Dataset& dataset, OptzParams optimizationParams,
     const double batchLearningRate = learningRate / static_cast<double>(batchSize);
     auto regularizer = meta::get<regularizationP>(optimizationParams);
     auto stop = meta::get<stopCriterionP>(optimizationParams);
+    auto monitor = meta::get<optimizationMonitorP>(optimizationParams);
+    typedef ObservesTraining<decltype(monitor)> Observed;
 
     typename NetworkParmas::Connections connections;
     meta::tup_each([] (auto& c) { c.init(); }, connections);
     decltype(connections) accumulatedDeltas;
     typename NetworkParmas::Activations activations;
     typename NetworkParmas::Delta delta;
+    Stopwatch stopwatch;
+    EpochEvent epochEvent{0, 0, 0.0, 0.0, 0.0, 0.0, allocationCount()};
     unsigned epoch = 0;
-    while (!stop(epoch, connections)) {
+    while (true) {
+        if (Observed::value) {
+            stopwatch.lap();
+        }
+        const bool done = stop(epoch, connections);
+        if (Observed::value && epoch > 0) {
+            epochEvent.validationTime = stopwatch.lap();
+            if (epochEvent.examples > 0) {
+                epochEvent.examplesPerSec =
+                    epochEvent.examples / epochEvent.trainTime;
+                epochEvent.loss /= epochEvent.examples;
+            }
+            epochEvent.allocations =
+                allocationCount() - epochEvent.allocations;
+            notify(monitor, epochEvent, Observed{});
+            epochEvent = EpochEvent{epoch, 0, 0.0, 0.0, 0.0, 0.0,
+                                    allocationCount()};
+        }
+        if (done) {
+            break;
+        }
         // TODO: sweep through the whole dataset starting at random position
         for (unsigned step = 0; step < dsSize / batchSize; ++step) {
+            BatchEvent batchEvent{epoch, step, batchSize,
+                                  0.0, 0.0, 0.0, 0.0, 0.0, 0};
+            if (Observed::value) {
+                stopwatch.lap();
+                batchEvent.allocations = allocationCount();
+            }
             meta::tup_each([] (auto& x) { x.zero(); }, accumulatedDeltas);
             unsigned batchStart = step * batchSize;
             auto examples = dataset.examples.middleCols(batchStart, batchSize);
             auto labels = dataset.labels.middleCols(batchStart, batchSize);
+            if (Observed::value) {
+                batchEvent.loadTime = stopwatch.lap();
+            }
 
             feedForward(
                 examples, connections, activations,
                 typename NetworkParmas::Layers{});
+            if (Observed::value) {
+                batchEvent.forwardTime = stopwatch.lap();
+            }
             backProp(labels, activations, connections, delta, accumulatedDeltas);
+            if (Observed::value) {
+                batchEvent.backwardTime = stopwatch.lap();
+            }
             meta::tup_each(
                 [batchLearningRate, &regularizer] (auto& theta, const auto& acc) {
                     theta.applyRegularizer(regularizer, batchLearningRate);
                     theta.update(acc, batchLearningRate);
                 },
                 connections, accumulatedDeltas);
+            if (Observed::value) {
+                batchEvent.updateTime = stopwatch.lap();
+                batchEvent.loss = NetworkParmas::lossFn(
+                        meta::tup_last(activations), labels);
+                batchEvent.allocations =
+                    allocationCount() - batchEvent.allocations;
+                notify(monitor, batchEvent, Observed{});
+                epochEvent.examples += batchSize;
+                epochEvent.loss += batchEvent.loss;
+                // Excluding time spent by the monitor itself
+                stopwatch.lap();
+                epochEvent.trainTime += batchEvent.loadTime +
+                    batchEvent.forwardTime + batchEvent.backwardTime +
+                    batchEvent.updateTime;
+            }
         }
         epoch++;
     }
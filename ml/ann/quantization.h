@@ -0,0 +1,330 @@
+#pragma once
+
+#include <meta/tuple.h>
+#include <ml/ann.h>
+#include <ml/ann/connection.h>
+#include <ml/exception.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <tuple>
+
+#include <Eigen/Dense>
+
+//! AVX2 int8 kernels are compiled with target attributes and selected at
+//! run time, so they are used without -mavx2 or -march=native
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define ML_ANN_AVX2_DISPATCH 1
+#include <immintrin.h>
+#endif
+
+namespace ml {
+namespace ann {
+namespace detail {
+
+typedef Eigen::Matrix<int8_t, Eigen::Dynamic, Eigen::Dynamic> QuantizedNodes;
+
+namespace {
+
+inline int32_t dotInt8Scalar(const int8_t* a, const int8_t* b, unsigned n) {
+    int32_t sum = 0;
+    for (unsigned i = 0; i < n; ++i) {
+        sum += static_cast<int32_t>(a[i]) * static_cast<int32_t>(b[i]);
+    }
+    return sum;
+}
+
+#ifdef ML_ANN_AVX2_DISPATCH
+
+//! Products of 16 int8 pairs summed in pairs into 8 int32 lanes. Operands
+//! are sign extended to int16 before multiplication, so unlike maddubs
+//! nothing saturates.
+__attribute__((target("avx2")))
+inline __m256i madd16Avx2(const int8_t* a, const int8_t* b) {
+    const __m256i va = _mm256_cvtepi8_epi16(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(a)));
+    const __m256i vb = _mm256_cvtepi8_epi16(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(b)));
+    return _mm256_madd_epi16(va, vb);
+}
+
+//! Main loop takes 32 values with two accumulators, remaining ones are
+//! handled by a 16 wide step and the scalar loop
+__attribute__((target("avx2")))
+inline int32_t dotInt8Avx2(const int8_t* a, const int8_t* b, unsigned n) {
+    __m256i acc0 = _mm256_setzero_si256();
+    __m256i acc1 = _mm256_setzero_si256();
+    unsigned i = 0;
+    for (; i + 32 <= n; i += 32) {
+        acc0 = _mm256_add_epi32(acc0, madd16Avx2(a + i, b + i));
+        acc1 = _mm256_add_epi32(acc1, madd16Avx2(a + i + 16, b + i + 16));
+    }
+    if (i + 16 <= n) {
+        acc0 = _mm256_add_epi32(acc0, madd16Avx2(a + i, b + i));
+        i += 16;
+    }
+    const __m256i acc = _mm256_add_epi32(acc0, acc1);
+    __m128i acc128 = _mm_add_epi32(
+            _mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+    acc128 = _mm_hadd_epi32(acc128, acc128);
+    acc128 = _mm_hadd_epi32(acc128, acc128);
+    return _mm_cvtsi128_si32(acc128) + dotInt8Scalar(a + i, b + i, n - i);
+}
+
+#endif
+
+//! True if dotInt8 uses the AVX2 kernel on this CPU
+inline bool hasAvx2Int8() {
+#ifdef ML_ANN_AVX2_DISPATCH
+    static const bool supported = __builtin_cpu_supports("avx2");
+    return supported;
+#else
+    return false;
+#endif
+}
+
+//! Dot product of two int8 vectors accumulated in int32
+inline int32_t dotInt8(const int8_t* a, const int8_t* b, unsigned n) {
+#ifdef ML_ANN_AVX2_DISPATCH
+    if (hasAvx2Int8()) {
+        return dotInt8Avx2(a, b, n);
+    }
+#endif
+    return dotInt8Scalar(a, b, n);
+}
+
+//! Symmetric scale mapping [-maxAbs, maxAbs] onto [-127, 127]
+inline double int8Scale(double maxAbs) {
+    return maxAbs > 0.0 ? maxAbs / 127.0 : 1.0;
+}
+
+inline int8_t quantizeValue(double x, double scale) {
+    const double q = std::round(x / scale);
+    return static_cast<int8_t>(std::max(-127.0, std::min(127.0, q)));
+}
+
+} // namespace
+
+template <typename Input>
+QuantizedNodes quantizeNodes(const Input& input, double scale) {
+    QuantizedNodes result(input.rows(), input.cols());
+    for (unsigned col = 0; col < input.cols(); ++col) {
+        for (unsigned row = 0; row < input.rows(); ++row) {
+            result(row, col) = quantizeValue(input(row, col), scale);
+        }
+    }
+    return result;
+}
+
+//! FullConnection with int8 weights quantized with a separate scale per
+//! output node. Input scale is fixed at construction, so bias is folded
+//! into the int32 accumulator.
+template <unsigned inSize, unsigned outSize>
+class QuantizedConnection {
+public:
+    QuantizedConnection() : weights_(outSize, inSize) {
+        scales_.fill(1.0);
+        bias_.fill(0);
+    }
+
+    void init(const FullConnection<inSize, outSize>& conn, double inputScale) {
+        const auto& weights = conn.weights();
+        for (unsigned row = 0; row < outSize; ++row) {
+            const double scale =
+                int8Scale(weights.row(row).cwiseAbs().maxCoeff());
+            for (unsigned col = 0; col < inSize; ++col) {
+                weights_(row, col) = quantizeValue(weights(row, col), scale);
+            }
+            scales_(row) = scale * inputScale;
+            bias_(row) = static_cast<int32_t>(
+                    std::round(conn.bias()(row) / scales_(row)));
+        }
+    }
+
+    //! Applies connection to quantized input and returns dequantized
+    //! preactivations
+    Eigen::MatrixXd transform(const QuantizedNodes& input) const {
+        REQUIRE(input.rows() == inSize,
+            "Invalid input size " << input.rows() << " != " << inSize);
+        Eigen::MatrixXd result(outSize, input.cols());
+        for (unsigned col = 0; col < input.cols(); ++col) {
+            const int8_t* x = input.data() + col * inSize;
+            for (unsigned row = 0; row < outSize; ++row) {
+                const int32_t acc =
+                    dotInt8(weights_.data() + row * inSize, x, inSize) +
+                    bias_(row);
+                result(row, col) = acc * scales_(row);
+            }
+        }
+        return result;
+    }
+
+    static uint64_t bytes() {
+        return outSize * inSize * sizeof(int8_t) +
+               outSize * (sizeof(int32_t) + sizeof(double));
+    }
+
+private:
+    Eigen::Matrix<int8_t, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>
+        weights_;
+    Eigen::Matrix<double, outSize, 1> scales_;
+    Eigen::Matrix<int32_t, outSize, 1> bias_;
+};
+
+template <typename Connection>
+struct QuantizedSelector {};
+
+template <unsigned inSize, unsigned outSize>
+struct QuantizedSelector<FullConnection<inSize, outSize>> {
+    typedef QuantizedConnection<inSize, outSize> type;
+};
+
+template <typename Connections>
+struct QuantizedConnections {};
+
+template <typename... Cs>
+struct QuantizedConnections<std::tuple<Cs...>> {
+    typedef std::tuple<typename QuantizedSelector<Cs>::type...> type;
+};
+
+} // namespace detail
+
+//! Largest absolute value of each layer's input seen on the calibration set
+template <typename NetConf>
+using ActivationRanges = std::array<
+        double,
+        std::tuple_size<typename NetConf::Connections>::value>;
+
+//! Runs float network over calibration set in chunks of chunkSize examples
+//! and records range of inputs of each connection.
+template <typename NetConf, typename Dataset>
+ActivationRanges<NetConf> calibrate(
+        const ANNClassifier<NetConf>& classifier,
+        const Dataset& calibrationSet,
+        const unsigned chunkSize = 1024) {
+    ActivationRanges<NetConf> ranges;
+    ranges.fill(0.0);
+    const uint64_t dsSize = size(calibrationSet);
+    typedef meta::apply<std::tuple, meta::tail<typename NetConf::Layers>>
+        LayersTuple;
+    for (uint64_t start = 0; start < dsSize; start += chunkSize) {
+        const uint64_t cols = std::min<uint64_t>(chunkSize, dsSize - start);
+        Eigen::MatrixXd nodes =
+            calibrationSet.examples.middleCols(start, cols);
+        unsigned pos = 0;
+        meta::tup_each(
+                [&nodes, &ranges, &pos](const auto& conn, auto layer) {
+                    ranges[pos] =
+                        std::max(ranges[pos], nodes.cwiseAbs().maxCoeff());
+                    typename decltype(layer)::Activation act;
+                    nodes = act(conn.transform(nodes));
+                    pos++;
+                },
+                classifier.connections(),
+                LayersTuple());
+    }
+    return ranges;
+}
+
+//! ANN classifier with int8 weights and activations
+template <typename NetConf>
+class QuantizedANNClassifier {
+public:
+    typedef typename detail::QuantizedConnections<
+                typename NetConf::Connections>::type Connections;
+
+    QuantizedANNClassifier(
+            const ANNClassifier<NetConf>& classifier,
+            const ActivationRanges<NetConf>& ranges) {
+        for (unsigned i = 0; i < ranges.size(); ++i) {
+            scales_[i] = detail::int8Scale(ranges[i]);
+        }
+        unsigned pos = 0;
+        meta::tup_each(
+                [this, &pos](auto& qconn, const auto& conn) {
+                    qconn.init(conn, scales_[pos++]);
+                },
+                connections_,
+                classifier.connections());
+    }
+
+    template <typename Input>
+    Eigen::MatrixXd operator() (const Input& input) const {
+        typedef meta::apply<std::tuple, meta::tail<typename NetConf::Layers>>
+            LayersTuple;
+        Eigen::MatrixXd nodes = input;
+        unsigned pos = 0;
+        meta::tup_each(
+                [this, &nodes, &pos](const auto& qconn, auto layer) {
+                    typename decltype(layer)::Activation act;
+                    nodes = act(qconn.transform(
+                                detail::quantizeNodes(nodes, scales_[pos++])));
+                },
+                connections_,
+                LayersTuple());
+        return nodes;
+    }
+
+    uint64_t bytes() const {
+        uint64_t result = sizeof(scales_);
+        meta::tup_each(
+                [&result](const auto& qconn) { result += qconn.bytes(); },
+                connections_);
+        return result;
+    }
+
+private:
+    Connections connections_;
+    ActivationRanges<NetConf> scales_;
+};
+
+//! Quantizes trained classifier using calibrationSet to choose activation
+//! scales
+template <typename NetConf, typename Dataset>
+QuantizedANNClassifier<NetConf> quantize(
+        const ANNClassifier<NetConf>& classifier,
+        const Dataset& calibrationSet) {
+    return QuantizedANNClassifier<NetConf>(
+            classifier, calibrate(classifier, calibrationSet));
+}
+
+struct QuantizationReport {
+    double floatLoss;
+    double quantizedLoss;
+    double maxAbsError;
+    double meanAbsError;
+};
+
+//! Compares outputs of float and quantized classifiers on a labelled dataset
+template <typename NetConf, typename Dataset>
+QuantizationReport compare(
+        const ANNClassifier<NetConf>& classifier,
+        const QuantizedANNClassifier<NetConf>& quantized,
+        const Dataset& dataset,
+        const unsigned chunkSize = 1024) {
+    QuantizationReport report{0.0, 0.0, 0.0, 0.0};
+    const uint64_t dsSize = size(dataset);
+    uint64_t numOutputs = 0;
+    for (uint64_t start = 0; start < dsSize; start += chunkSize) {
+        const uint64_t cols = std::min<uint64_t>(chunkSize, dsSize - start);
+        auto examples = dataset.examples.middleCols(start, cols);
+        auto labels = dataset.labels.middleCols(start, cols);
+        Eigen::MatrixXd floatOut = classifier(examples);
+        Eigen::MatrixXd quantOut = quantized(examples);
+        report.floatLoss += NetConf::lossFn(floatOut, labels);
+        report.quantizedLoss += NetConf::lossFn(quantOut, labels);
+        auto error = (floatOut - quantOut).cwiseAbs();
+        report.maxAbsError = std::max(report.maxAbsError, error.maxCoeff());
+        report.meanAbsError += error.sum();
+        numOutputs += error.size();
+    }
+    if (numOutputs > 0) {
+        report.meanAbsError /= static_cast<double>(numOutputs);
+    }
+    return report;
+}
+
+} // namespace ann
+} // namespace ml
@@ -1,7 +1,16 @@
 #pragma once
 
 #include <ml/ann/feed_forward.h>
+#include <ml/parallel.h>
+#include <ml/random.h>
+
+#include <algorithm>
+#include <cstdint>
 #include <limits>
+#include <numeric>
+#include <vector>
+
+#include <Eigen/Dense>
 
 namespace ml {
 namespace ann {
@@ -24,10 +33,17 @@ class EarlyStopping {
 public:
     EarlyStopping(const EarlyStopping&) = delete;
     EarlyStopping(EarlyStopping&&) = default;
+    //! Validation set is evaluated in chunks of chunkSize examples split
+    //! between numThreads threads, so at most numThreads * chunkSize outputs
+    //! are materialized at once.
     EarlyStopping(const Dataset& validationSet,
-                  const unsigned epochsBetweenUpdates)
+                  const unsigned epochsBetweenUpdates,
+                  const unsigned chunkSize = 1024,
+                  const unsigned numThreads = 1)
         : validationSet_(validationSet)
         , epochsBetweenUpdates_(epochsBetweenUpdates)
+        , chunkSize_(std::max(1u, chunkSize))
+        , numThreads_(std::max(1u, numThreads))
         , lastUpdateEpoch_(0)
         , lowestLoss_(std::numeric_limits<double>::max())
         , bestEpoch_(0) {}
@@ -63,6 +79,8 @@ public:
             if (currentLoss < lowestLoss_) {
                 lowestLoss_ = currentLoss;
                 bestEpoch_ = epoch;
+                // Snapshot storage is allocated once, so this is a copy
+                // of the weights without any allocations
                 out_ = connections;
             } else if (epoch - bestEpoch_ > 10) {
                 return true;
@@ -75,17 +93,81 @@ public:
         return out_;
     }
 
-private:
+    //! Validate on a fixed random subset of numExamples examples instead of
+    //! the whole validation set
+    void subsample(const uint64_t numExamples, const unsigned seed = 0) {
+        const uint64_t dsSize = size(validationSet_);
+        subset_.resize(dsSize);
+        std::iota(subset_.begin(), subset_.end(), 0);
+        if (numExamples >= dsSize) {
+            subset_.clear();
+            return;
+        }
+        Philox gen(seed);
+        std::shuffle(subset_.begin(), subset_.end(), gen);
+        subset_.resize(numExamples);
+        // Keeps gathered columns in memory order
+        std::sort(subset_.begin(), subset_.end());
+    }
+
+    //! Validation loss of connections, summed over the validation set or
+    //! its subsample
     double loss(const typename NetConf::Connections& connections) const {
-        auto prediction = detail::feedForward(
-                                validationSet_.examples,
-                                connections,
-                                typename NetConf::Layers{});
-        return NetConf::lossFn(prediction, validationSet_.labels);
+        const uint64_t numExamples =
+            subset_.empty() ? size(validationSet_) : subset_.size();
+        std::vector<double> losses(numThreads_, 0.0);
+        parallelRanges(0, numExamples, numThreads_,
+            [&](unsigned thread, uint64_t begin, uint64_t end) {
+                Eigen::MatrixXd examples;
+                Eigen::MatrixXd labels;
+                for (uint64_t start = begin; start < end; start += chunkSize_) {
+                    const uint64_t cols =
+                        std::min<uint64_t>(chunkSize_, end - start);
+                    if (subset_.empty()) {
+                        // Chunks of the whole set are evaluated in place
+                        losses[thread] += chunkLoss(
+                            validationSet_.examples.middleCols(start, cols),
+                            validationSet_.labels.middleCols(start, cols),
+                            connections);
+                    } else {
+                        gather(start, cols, examples, labels);
+                        losses[thread] +=
+                            chunkLoss(examples, labels, connections);
+                    }
+                }
+            });
+        return std::accumulate(losses.begin(), losses.end(), 0.0);
+    }
+
+private:
+    template <typename Examples, typename Labels>
+    static double chunkLoss(
+            const Examples& examples,
+            const Labels& labels,
+            const typename NetConf::Connections& connections) {
+        const auto prediction = detail::feedForward(
+                examples, connections, typename NetConf::Layers{});
+        return NetConf::lossFn(prediction, labels);
+    }
+
+    //! Copies subsampled examples of a chunk to contiguous matrices
+    void gather(
+            const uint64_t start, const uint64_t cols,
+            Eigen::MatrixXd& examples, Eigen::MatrixXd& labels) const {
+        examples.resize(validationSet_.examples.rows(), cols);
+        labels.resize(validationSet_.labels.rows(), cols);
+        for (uint64_t col = 0; col < cols; ++col) {
+            const uint64_t pos = subset_[start + col];
+            examples.col(col) = validationSet_.examples.col(pos);
+            labels.col(col) = validationSet_.labels.col(pos);
+        }
     }
 
     const Dataset& validationSet_;
     const unsigned epochsBetweenUpdates_;
+    const unsigned chunkSize_;
+    const unsigned numThreads_;
+    std::vector<uint64_t> subset_;
     unsigned lastUpdateEpoch_;
     double lowestLoss_;
     unsigned bestEpoch_;
@@ -0,0 +1,306 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <ostream>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace ml {
+namespace ann {
+
+//! Timings of a single mini-batch step, in seconds
+struct BatchEvent {
+    unsigned epoch;
+    unsigned batch;
+    unsigned examples;
+    double loadTime;
+    double forwardTime;
+    double backwardTime;
+    double updateTime;
+    double loss;
+    uint64_t allocations;
+};
+
+//! Summary of a training epoch. Validation time is the time spent in the
+//! stop criterion after the epoch.
+struct EpochEvent {
+    unsigned epoch;
+    uint64_t examples;
+    double trainTime;
+    double validationTime;
+    double examplesPerSec;
+    double loss;
+    uint64_t allocations;
+};
+
+namespace detail {
+
+//! Number of heap allocations made by the process so far. Stays zero unless
+//! ML_DEFINE_ALLOCATION_COUNTER is expanded in one of the translation units.
+inline std::atomic<uint64_t>& allocationCounter() {
+    static std::atomic<uint64_t> counter(0);
+    return counter;
+}
+
+inline void countAllocation() {
+    allocationCounter().fetch_add(1, std::memory_order_relaxed);
+}
+
+inline uint64_t allocationCount() {
+    return allocationCounter().load(std::memory_order_relaxed);
+}
+
+class Stopwatch {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    Stopwatch() : last_(Clock::now()) {}
+
+    //! Seconds elapsed since previous call
+    double lap() {
+        const auto now = Clock::now();
+        const std::chrono::duration<double> elapsed = now - last_;
+        last_ = now;
+        return elapsed.count();
+    }
+
+private:
+    Clock::time_point last_;
+};
+
+//! Monitors accepting training events have observe(const EpochEvent&) and
+//! observe(const BatchEvent&) member functions
+template <typename Monitor, typename = void>
+struct ObservesTraining : std::false_type {};
+
+template <typename Monitor>
+struct ObservesTraining<Monitor, decltype(
+        std::declval<Monitor&>().observe(std::declval<const EpochEvent&>()),
+        std::declval<Monitor&>().observe(std::declval<const BatchEvent&>()),
+        void())> : std::true_type {};
+
+template <typename Monitor, typename Event>
+void notify(Monitor& monitor, const Event& event, std::true_type) {
+    monitor.observe(event);
+}
+
+template <typename Monitor, typename Event>
+void notify(Monitor&, const Event&, std::false_type) {}
+
+} // namespace detail
+
+//! Fixed capacity buffer keeping the most recent events
+template <typename Event>
+class RingBuffer {
+public:
+    explicit RingBuffer(size_t capacity)
+        : events_(std::max<size_t>(1, capacity)), next_(0), size_(0) {}
+
+    void push(const Event& event) {
+        events_[next_] = event;
+        next_ = (next_ + 1) % events_.size();
+        size_ = std::min(size_ + 1, events_.size());
+    }
+
+    size_t size() const {
+        return size_;
+    }
+
+    //! i-th oldest event
+    const Event& operator[] (size_t i) const {
+        return events_[(next_ + events_.size() - size_ + i) % events_.size()];
+    }
+
+private:
+    std::vector<Event> events_;
+    size_t next_;
+    size_t size_;
+};
+
+//! Sink storing training events in preallocated ring buffers
+class TelemetryRecorder {
+public:
+    explicit TelemetryRecorder(
+            size_t batchCapacity = 1 << 16,
+            size_t epochCapacity = 1 << 10)
+        : batches_(batchCapacity), epochs_(epochCapacity) {}
+
+    void observe(const BatchEvent& event) {
+        batches_.push(event);
+    }
+
+    void observe(const EpochEvent& event) {
+        epochs_.push(event);
+    }
+
+    const RingBuffer<BatchEvent>& batches() const {
+        return batches_;
+    }
+
+    const RingBuffer<EpochEvent>& epochs() const {
+        return epochs_;
+    }
+
+private:
+    RingBuffer<BatchEvent> batches_;
+    RingBuffer<EpochEvent> epochs_;
+};
+
+//! Optimization monitor forwarding training events to a recorder
+template <typename Monitor>
+class TelemetryMonitor {
+public:
+    TelemetryMonitor(Monitor monitor, TelemetryRecorder& recorder)
+        : monitor_(std::move(monitor)), recorder_(&recorder) {}
+
+    const auto& connections() const {
+        return monitor_.connections();
+    }
+
+    template <typename Event>
+    void observe(const Event& event) {
+        recorder_->observe(event);
+    }
+
+private:
+    Monitor monitor_;
+    TelemetryRecorder* recorder_;
+};
+
+//! Wraps optimization monitor (e.g. EarlyStopping::Ref) so that training
+//! events are stored in recorder
+template <typename Monitor>
+TelemetryMonitor<Monitor> withTelemetry(
+        Monitor monitor, TelemetryRecorder& recorder) {
+    return TelemetryMonitor<Monitor>(std::move(monitor), recorder);
+}
+
+inline void writeCsv(std::ostream& o, const RingBuffer<BatchEvent>& events) {
+    o << "epoch,batch,examples,load,forward,backward,update,loss,allocations\n";
+    for (size_t i = 0; i < events.size(); ++i) {
+        const auto& e = events[i];
+        o << e.epoch << ',' << e.batch << ',' << e.examples << ','
+          << e.loadTime << ',' << e.forwardTime << ',' << e.backwardTime << ','
+          << e.updateTime << ',' << e.loss << ',' << e.allocations << '\n';
+    }
+}
+
+inline void writeCsv(std::ostream& o, const RingBuffer<EpochEvent>& events) {
+    o << "epoch,examples,train,validation,examples_per_sec,loss,allocations\n";
+    for (size_t i = 0; i < events.size(); ++i) {
+        const auto& e = events[i];
+        o << e.epoch << ',' << e.examples << ',' << e.trainTime << ','
+          << e.validationTime << ',' << e.examplesPerSec << ','
+          << e.loss << ',' << e.allocations << '\n';
+    }
+}
+
+inline void writeJson(std::ostream& o, const TelemetryRecorder& recorder) {
+    o << "{\"epochs\": [";
+    const auto& epochs = recorder.epochs();
+    for (size_t i = 0; i < epochs.size(); ++i) {
+        const auto& e = epochs[i];
+        o << (i ? ",\n  " : "\n  ")
+          << "{\"epoch\": " << e.epoch
+          << ", \"examples\": " << e.examples
+          << ", \"train\": " << e.trainTime
+          << ", \"validation\": " << e.validationTime
+          << ", \"examples_per_sec\": " << e.examplesPerSec
+          << ", \"loss\": " << e.loss
+          << ", \"allocations\": " << e.allocations << "}";
+    }
+    o << "],\n \"batches\": [";
+    const auto& batches = recorder.batches();
+    for (size_t i = 0; i < batches.size(); ++i) {
+        const auto& e = batches[i];
+        o << (i ? ",\n  " : "\n  ")
+          << "{\"epoch\": " << e.epoch
+          << ", \"batch\": " << e.batch
+          << ", \"examples\": " << e.examples
+          << ", \"load\": " << e.loadTime
+          << ", \"forward\": " << e.forwardTime
+          << ", \"backward\": " << e.backwardTime
+          << ", \"update\": " << e.updateTime
+          << ", \"loss\": " << e.loss
+          << ", \"allocations\": " << e.allocations << "}";
+    }
+    o << "]}\n";
+}
+
+} // namespace ann
+} // namespace ml
+
+//! Defines allocation hooks incrementing ml::ann::detail::allocationCounter.
+//! Should be expanded at global scope of exactly one translation unit. On
+//! glibc the whole C allocation family (malloc, calloc, realloc, memalign,
+//! posix_memalign, aligned_alloc and valloc) is interposed, which covers
+//! operator new and Eigen's aligned allocations too. Elsewhere only
+//! operator new is replaced, so allocations made directly with malloc and
+//! friends (including Eigen's) are not counted.
+#ifdef __GLIBC__
+#define ML_DEFINE_ALLOCATION_COUNTER \
+    extern "C" void* __libc_malloc(std::size_t); \
+    extern "C" void* __libc_calloc(std::size_t, std::size_t); \
+    extern "C" void* __libc_realloc(void*, std::size_t); \
+    extern "C" void* __libc_memalign(std::size_t, std::size_t); \
+    extern "C" void* __libc_valloc(std::size_t); \
+    extern "C" void* malloc(std::size_t size) noexcept { \
+        ml::ann::detail::countAllocation(); \
+        return __libc_malloc(size); \
+    } \
+    extern "C" void* calloc(std::size_t count, std::size_t size) noexcept { \
+        ml::ann::detail::countAllocation(); \
+        return __libc_calloc(count, size); \
+    } \
+    extern "C" void* realloc(void* ptr, std::size_t size) noexcept { \
+        ml::ann::detail::countAllocation(); \
+        return __libc_realloc(ptr, size); \
+    } \
+    extern "C" void* memalign(std::size_t alignment, std::size_t size) \
+            noexcept { \
+        ml::ann::detail::countAllocation(); \
+        return __libc_memalign(alignment, size); \
+    } \
+    extern "C" void* aligned_alloc(std::size_t alignment, std::size_t size) \
+            noexcept { \
+        ml::ann::detail::countAllocation(); \
+        return __libc_memalign(alignment, size); \
+    } \
+    extern "C" void* valloc(std::size_t size) noexcept { \
+        ml::ann::detail::countAllocation(); \
+        return __libc_valloc(size); \
+    } \
+    extern "C" int posix_memalign( \
+            void** ptr, std::size_t alignment, std::size_t size) noexcept { \
+        if (alignment % sizeof(void*) != 0 || \
+                (alignment & (alignment - 1)) != 0) { \
+            return EINVAL; \
+        } \
+        ml::ann::detail::countAllocation(); \
+        void* result = __libc_memalign(alignment, size); \
+        if (!result) { \
+            return ENOMEM; \
+        } \
+        *ptr = result; \
+        return 0; \
+    }
+#else
+#define ML_DEFINE_ALLOCATION_COUNTER \
+    void* operator new(std::size_t size) { \
+        ml::ann::detail::countAllocation(); \
+        if (void* ptr = std::malloc(size ? size : 1)) { \
+            return ptr; \
+        } \
+        throw std::bad_alloc(); \
+    } \
+    void operator delete(void* ptr) noexcept { \
+        std::free(ptr); \
+    }
+#endif
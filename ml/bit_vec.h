@@ -25,11 +25,35 @@ public:
 
     static unsigned size() { return SIZE; }
 
+    //! Number of 64 bit words holding the bits
+    static constexpr unsigned numPacks() { return 1 + (SIZE - 1) / 64; }
+
+    //! Words holding the bits, bit pos is bit pos % 64 of word pos / 64
+    const uint64_t* data() const {
+        return packs_.data();
+    }
+
+    //! Writable words, bits beyond SIZE must be left unset
+    uint64_t* data() {
+        return packs_.data();
+    }
+
     bool operator() (unsigned pos) const {
         auto& pack = packs_[pos / 64];
         return pack & (1ul << (pos & 0x0000003F));
     }
 
+    //! count <= 64 bits starting at pos, bit pos is the lowest one
+    uint64_t bits(unsigned pos, unsigned count) const {
+        const unsigned word = pos / 64;
+        const unsigned offset = pos % 64;
+        uint64_t result = packs_[word] >> offset;
+        if (offset + count > 64 && word + 1 < packs_.size()) {
+            result |= packs_[word + 1] << (64 - offset);
+        }
+        return count < 64 ? result & ((1ul << count) - 1) : result;
+    }
+
     void set(unsigned pos) {
         auto& pack = packs_[pos / 64];
         pack |= (1ul << (pos & 0x0000003F));
@@ -43,6 +67,16 @@ public:
         return sum;
     }
 
+    //! Calls f(pos) for every set bit in increasing order of positions
+    template <typename F>
+    void forEachSet(F f) const {
+        for (unsigned i = 0; i < packs_.size(); ++i) {
+            for (uint64_t pack = packs_[i]; pack; pack &= pack - 1) {
+                f(i * 64 + __builtin_ctzll(pack));
+            }
+        }
+    }
+
     unsigned operator* (const BitVec<SIZE>& other) const {
         unsigned sum = 0;
         for (unsigned i = 0; i < packs_.size(); ++i) {
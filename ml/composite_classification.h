@@ -1,11 +1,16 @@
 #pragma once
 
+#include <ml/dataset/dataset_traits.h>
+#include <ml/dataset/serialization.h>
 #include <ml/exception.h>
+#include <ml/pair_classifier_cache.h>
 
 #include <algorithm>
 #include <cmath>
 #include <numeric>
+#include <type_traits>
 #include <unordered_set>
+#include <utility>
 #include <vector>
 
 namespace ml {
@@ -14,15 +19,66 @@ namespace composite {
 
 namespace {
 
+//! Training statistics of classifiers which don't report any
+struct NoStats {
+    NoStats& operator+= (const NoStats&) {
+        return *this;
+    }
+};
+
+template <typename Classifier>
+auto trainingStats(const Classifier& classifier, int)
+        -> std::decay_t<decltype(classifier.stats())> {
+    return classifier.stats();
+}
+
+template <typename Classifier>
+NoStats trainingStats(const Classifier&, long) {
+    return {};
+}
+
+template <typename Classifier>
+using TrainingStats = decltype(
+        trainingStats(std::declval<const Classifier&>(), 0));
+
+//! Models accepting indices of pair dataset examples in the original
+//! dataset (e.g. to share kernel values between pairs) are given them
+template <typename Model, typename PairDataset>
+auto trainPair(
+        Model& model,
+        const PairDataset& pairDataset,
+        const std::vector<unsigned>& indices,
+        int) -> decltype(model(pairDataset, indices)) {
+    return model(pairDataset, indices);
+}
+
+template <typename Model, typename PairDataset>
+auto trainPair(
+        Model& model,
+        const PairDataset& pairDataset,
+        const std::vector<unsigned>&,
+        long) -> decltype(model(pairDataset)) {
+    return model(pairDataset);
+}
+
+//! Binary classifier trained by model on pair datasets made of Dataset
+template <typename Dataset, typename Model>
+using PairClassifier = decltype(trainPair(std::declval<Model&>(),
+            std::declval<const storage_t<Dataset>&>(),
+            std::declval<const std::vector<unsigned>&>(), 0));
+
 template <typename OneVsOneClassifier, typename DecisionFn>
 class CompositeClassifier {
 public:
     typedef std::vector<OneVsOneClassifier> OneVsOneClassifiers;
+    typedef TrainingStats<OneVsOneClassifier> Stats;
 
     CompositeClassifier(CompositeClassifier&&) = default;
-    explicit CompositeClassifier(OneVsOneClassifiers classifiers)
+    explicit CompositeClassifier(
+            OneVsOneClassifiers classifiers, Stats stats = Stats())
         : oneVsOneClassifiers_(std::move(classifiers))
-        , numClasses_(numClasses(oneVsOneClassifiers_.size())) {}
+        , numClasses_(numClasses(oneVsOneClassifiers_.size()))
+        , stats_(std::move(stats)) {}
 
     template <typename RowVector>
     int operator() (const RowVector& row) const {
@@ -32,6 +88,11 @@ public:
                 });
     }
 
+    //! Training statistics summed over all pair classifiers
+    const Stats& stats() const {
+        return stats_;
+    }
+
 private:
     static int numClasses(int numPairs) {
         return (1 + std::sqrt(1 + 8 * numPairs)) / 2;
@@ -45,6 +106,7 @@ private:
 
     OneVsOneClassifiers oneVsOneClassifiers_;
     const int numClasses_;
+    Stats stats_;
 };
 
 template <typename Dataset>
@@ -84,12 +146,21 @@ splitIndices(const Dataset& dataset) {
     return result;
 }
 
+//! Indices of examples of pair dataset in the original one
+inline std::vector<unsigned> pairIndices(
+        const std::vector<unsigned>& class0Indices,
+        const std::vector<unsigned>& class1Indices) {
+    std::vector<unsigned> result(class0Indices);
+    result.insert(result.end(), class1Indices.begin(), class1Indices.end());
+    return result;
+}
+
 template <typename Dataset>
-Dataset makePairDataSet(
+storage_t<Dataset> makePairDataSet(
         const std::vector<unsigned>& class0Indices,
         const std::vector<unsigned>& class1Indices,
         const Dataset& dataset) {
-    Dataset result(class0Indices.size() + class1Indices.size());
+    storage_t<Dataset> result(class0Indices.size() + class1Indices.size());
     unsigned pos = 0;
     for (unsigned i: class0Indices) {
         set(pos++, example(i, dataset), 1, result);
@@ -100,12 +171,25 @@ Dataset makePairDataSet(
     return result;
 }
 
+//! Hash of examples of a class in order of their indices
+template <typename Dataset>
+uint64_t classHash(
+        const std::vector<unsigned>& classIndices, const Dataset& dataset) {
+    Fnv1aHash hash;
+    for (unsigned i: classIndices) {
+        writeExample(hash, example(i, dataset));
+    }
+    return hash.value();
+}
+
 } // namespace
 
 //! Train composite multiclass classifier
 //
 //! \param dataset Labelled training set
-//! \param model Model of a bianary classification algorithm
+//! \param model Model of a bianary classification algorithm, called as
+//!        model(pairDataset, indices) if it accepts indices of pair dataset
+//!        examples in dataset and as model(pairDataset) otherwise
 //! \return Composite multiclass classifier
 // NOTICE: clang 3.3 can't compile this, if we try to add
 // DecisionFn argument and make it deduce template params.
@@ -115,24 +199,129 @@ template <
     typename DecisionFn>
 auto trainOneVsOneComposite(
         const Dataset& dataset, Model model)
-        -> CompositeClassifier<decltype(model(dataset)), DecisionFn> {
+        -> CompositeClassifier<PairClassifier<Dataset, Model>, DecisionFn> {
 
     auto classes = splitIndices(dataset);
     unsigned numClasses = classes.size();
-    typedef decltype(model(dataset)) OneVsOneClassifier;
+    typedef PairClassifier<Dataset, Model> OneVsOneClassifier;
     std::vector<OneVsOneClassifier> oneVsOneClassifiers;
     oneVsOneClassifiers.reserve(numClasses * (numClasses - 1) / 2);
+    TrainingStats<OneVsOneClassifier> stats;
 
     for (unsigned cls0 = 0; cls0 < numClasses - 1; ++cls0) {
         for (unsigned cls1 = cls0 + 1; cls1 < numClasses; ++cls1) {
             auto pairDataset = makePairDataSet(
                     classes[cls0], classes[cls1], dataset);
-            oneVsOneClassifiers.emplace_back(model(pairDataset));
+            oneVsOneClassifiers.emplace_back(trainPair(model, pairDataset,
+                        pairIndices(classes[cls0], classes[cls1]), 0));
+            stats += trainingStats(oneVsOneClassifiers.back(), 0);
         }
     }
 
-    return CompositeClassifier<decltype(model(dataset)), DecisionFn>{
-        std::move(oneVsOneClassifiers)};
+    return CompositeClassifier<OneVsOneClassifier, DecisionFn>{
+        std::move(oneVsOneClassifiers), std::move(stats)};
+}
+
+//! Train composite multiclass classifier, loading pair classifiers trained
+//! on the same examples of both classes with the same model from cache.
+//! Only K - 1 pair classifiers are trained if examples of a single class
+//! out of K change. Training stats are summed over trained pairs only.
+//
+//! \param dataset Labelled training set
+//! \param model Model of a bianary classification algorithm, see above
+//! \param cache Cache of pair classifiers, its modelKey has to describe
+//!        model
+//! \return Composite multiclass classifier
+template <
+    typename Dataset,
+    typename Model,
+    typename DecisionFn>
+auto trainOneVsOneComposite(
+        const Dataset& dataset, Model model, PairClassifierCache& cache)
+        -> CompositeClassifier<PairClassifier<Dataset, Model>, DecisionFn> {
+
+    auto classes = splitIndices(dataset);
+    unsigned numClasses = classes.size();
+    std::vector<uint64_t> classHashes;
+    for (const auto& classIndices: classes) {
+        classHashes.push_back(classHash(classIndices, dataset));
+    }
+    typedef PairClassifier<Dataset, Model> OneVsOneClassifier;
+    std::vector<OneVsOneClassifier> oneVsOneClassifiers;
+    oneVsOneClassifiers.reserve(numClasses * (numClasses - 1) / 2);
+    TrainingStats<OneVsOneClassifier> stats;
+
+    for (unsigned cls0 = 0; cls0 < numClasses - 1; ++cls0) {
+        for (unsigned cls1 = cls0 + 1; cls1 < numClasses; ++cls1) {
+            Fnv1aHash key;
+            writeString(key, cache.modelKey());
+            writeValue(key, classHashes[cls0]);
+            writeValue(key, classHashes[cls1]);
+            const uint64_t misses = cache.misses();
+            oneVsOneClassifiers.emplace_back(
+                cache.get<OneVsOneClassifier>(key.value(), [&] {
+                    auto pairDataset = makePairDataSet(
+                            classes[cls0], classes[cls1], dataset);
+                    return trainPair(model, pairDataset,
+                            pairIndices(classes[cls0], classes[cls1]), 0);
+                }));
+            if (cache.misses() != misses) {
+                stats += trainingStats(oneVsOneClassifiers.back(), 0);
+            }
+        }
+    }
+
+    return CompositeClassifier<OneVsOneClassifier, DecisionFn>{
+        std::move(oneVsOneClassifiers), std::move(stats)};
+}
+
+//! Train composite multiclass classifiers for a sequence of
+//! hyperparameter values at the cost of a single pass over class pairs
+//
+//! \param dataset Labelled training set
+//! \param pathModel Binary classification algorithm returning a vector of
+//!        classifiers, one per hyperparameter value (e.g. svc::trainPath)
+//! \return Composite multiclass classifier for each hyperparameter value
+template <
+    typename Dataset,
+    typename PathModel,
+    typename DecisionFn>
+auto trainOneVsOneCompositePath(
+        const Dataset& dataset, PathModel pathModel)
+        -> std::vector<CompositeClassifier<
+            typename PairClassifier<Dataset, PathModel>::value_type,
+            DecisionFn>> {
+
+    auto classes = splitIndices(dataset);
+    unsigned numClasses = classes.size();
+    typedef typename PairClassifier<Dataset, PathModel>::value_type
+        OneVsOneClassifier;
+    typedef CompositeClassifier<OneVsOneClassifier, DecisionFn> Composite;
+    std::vector<std::vector<OneVsOneClassifier>> oneVsOneClassifiers;
+    std::vector<TrainingStats<OneVsOneClassifier>> stats;
+
+    for (unsigned cls0 = 0; cls0 < numClasses - 1; ++cls0) {
+        for (unsigned cls1 = cls0 + 1; cls1 < numClasses; ++cls1) {
+            auto pairDataset = makePairDataSet(
+                    classes[cls0], classes[cls1], dataset);
+            auto path = trainPair(pathModel, pairDataset,
+                    pairIndices(classes[cls0], classes[cls1]), 0);
+            oneVsOneClassifiers.resize(path.size());
+            stats.resize(path.size());
+            for (unsigned i = 0; i < path.size(); ++i) {
+                stats[i] += trainingStats(path[i], 0);
+                oneVsOneClassifiers[i].emplace_back(std::move(path[i]));
+            }
+        }
+    }
+
+    std::vector<Composite> result;
+    result.reserve(oneVsOneClassifiers.size());
+    for (unsigned i = 0; i < oneVsOneClassifiers.size(); ++i) {
+        result.emplace_back(
+                std::move(oneVsOneClassifiers[i]), std::move(stats[i]));
+    }
+    return result;
 }
 
 } // namespace composite
@@ -9,23 +9,21 @@ namespace dag {
 
 namespace {
 
-//! DAG decision function
+//! DAG decision function. Candidate classes are eliminated from the highest
+//! one down: the survivor of the previous comparisons is compared with the
+//! next lower class, so K - 1 pair classifiers are evaluated without
+//! keeping the list of candidates.
 struct DAGDecide {
     template <typename ClassifyOneVsOne>
     int operator()(const int numClasses, ClassifyOneVsOne classify) const {
-        std::vector<int> candidates(numClasses);
-        std::iota(candidates.begin(), candidates.end(), 0);
-        while (candidates.size() > 1) {
-            int cls0 = candidates[candidates.size() - 2];
-            int cls1 = candidates[candidates.size() - 1];
-            candidates.resize(candidates.size() - 1);
-
-            if (classify(cls0, cls1) == -1) {
-                // popping cls0
-                candidates.back() = cls1;
+        int survivor = numClasses - 1;
+        for (int cls0 = numClasses - 2; cls0 >= 0; --cls0) {
+            if (classify(cls0, survivor) != -1) {
+                // popping survivor
+                survivor = cls0;
             }
         }
-        return candidates[0];
+        return survivor;
     }
 };
 
@@ -44,6 +42,27 @@ auto train(const Dataset& dataset, Model model)
         Dataset, Model, DAGDecide>(dataset, model);
 }
 
+//! Train DAG multiclass classifier, loading pair classifiers trained on
+//! unchanged classes from cache, see c12n::composite::PairClassifierCache
+template <typename Dataset, typename Model>
+auto train(const Dataset& dataset, Model model,
+        c12n::composite::PairClassifierCache& cache)
+    -> decltype(c12n::composite::trainOneVsOneComposite<
+            Dataset, Model, DAGDecide>(dataset, model, cache)) {
+    return c12n::composite::trainOneVsOneComposite<
+        Dataset, Model, DAGDecide>(dataset, model, cache);
+}
+
+//! Train DAG multiclass classifiers for a sequence of hyperparameter
+//! values, see c12n::composite::trainOneVsOneCompositePath
+template <typename Dataset, typename PathModel>
+auto trainPath(const Dataset& dataset, PathModel pathModel)
+    -> decltype(c12n::composite::trainOneVsOneCompositePath<
+            Dataset, PathModel, DAGDecide>(dataset, pathModel)) {
+    return c12n::composite::trainOneVsOneCompositePath<
+        Dataset, PathModel, DAGDecide>(dataset, pathModel);
+}
+
 } // namespace dag
 } // namespace ml
 
@@ -0,0 +1,296 @@
+#pragma once
+
+#include <ml/bit_vec.h>
+#include <ml/dataset/dataset_traits.h>
+#include <ml/exception.h>
+
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+//! popcnt and AVX-512 popcount kernels are compiled with target attributes
+//! and selected at run time, so they are used without -march=native
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define ML_BIT_MATRIX_POPCOUNT_DISPATCH 1
+#include <immintrin.h>
+#endif
+
+namespace ml {
+
+namespace detail {
+
+//! Allocator of memory aligned as required by T, even if it's stricter
+//! than what operator new guarantees
+template <typename T>
+struct AlignedAllocator {
+    typedef T value_type;
+
+    AlignedAllocator() = default;
+
+    template <typename U>
+    AlignedAllocator(const AlignedAllocator<U>&) {}
+
+    T* allocate(std::size_t n) {
+        void* p = nullptr;
+        const std::size_t alignment =
+            alignof(T) < sizeof(void*) ? sizeof(void*) : alignof(T);
+        if (posix_memalign(&p, alignment, n * sizeof(T)) != 0) {
+            throw std::bad_alloc();
+        }
+        return static_cast<T*>(p);
+    }
+
+    void deallocate(T* p, std::size_t) {
+        std::free(p);
+    }
+};
+
+template <typename T, typename U>
+bool operator== (const AlignedAllocator<T>&, const AlignedAllocator<U>&) {
+    return true;
+}
+
+template <typename T, typename U>
+bool operator!= (const AlignedAllocator<T>&, const AlignedAllocator<U>&) {
+    return false;
+}
+
+//! Words of a row padded to a multiple of 512 bits
+constexpr unsigned paddedPacks(unsigned numPacks) {
+    return (numPacks + 7) / 8 * 8;
+}
+
+//! Bits of an example followed by zero words up to the padded row width.
+//! Rows start at cache line (and AVX-512 register) boundary.
+template <
+    unsigned SIZE,
+    unsigned PADDING =
+        paddedPacks(BitVec<SIZE>::numPacks()) - BitVec<SIZE>::numPacks()>
+struct alignas(64) BitRow {
+    BitVec<SIZE> bits;
+    std::array<uint64_t, PADDING> padding{};
+};
+
+template <unsigned SIZE>
+struct alignas(64) BitRow<SIZE, 0> {
+    BitVec<SIZE> bits;
+};
+
+} // namespace detail
+
+//! Dataset of binary examples stored in a contiguous array of 64 byte
+//! aligned rows padded with zero words to a multiple of 512 bits, so that
+//! loops over rows can use aligned full width vector loads. Labels are kept
+//! in a separate compact array.
+template <unsigned SIZE, typename Label = int8_t>
+class BitMatrix {
+public:
+    typedef detail::BitRow<SIZE> Row;
+    //! Number of 64 bit words of a padded row
+    static constexpr unsigned ROW_PACKS =
+        detail::paddedPacks(BitVec<SIZE>::numPacks());
+    static_assert(sizeof(Row) == ROW_PACKS * sizeof(uint64_t),
+                  "Rows must be padded without gaps");
+
+    BitMatrix() = default;
+    BitMatrix(BitMatrix&&) = default;
+    BitMatrix& operator= (BitMatrix&&) = default;
+
+    explicit BitMatrix(uint64_t size)
+        : rows_(size)
+        , labels_(size) {}
+
+    //! Copy of examples with their labels, e.g. as returned by readMINSTData
+    template <typename OtherLabel>
+    BitMatrix(
+            const std::vector<BitVec<SIZE>>& examples,
+            const std::vector<OtherLabel>& labels)
+        : rows_(examples.size())
+        , labels_(examples.size()) {
+        REQUIRE(examples.size() == labels.size(),
+                "Number of examples and labels differ: "
+                << examples.size() << " != " << labels.size());
+        for (uint64_t i = 0; i < examples.size(); ++i) {
+            rows_[i].bits = examples[i];
+            labels_[i] = static_cast<Label>(labels[i]);
+        }
+    }
+
+    uint64_t size() const {
+        return rows_.size();
+    }
+
+    const BitVec<SIZE>& example(uint64_t pos) const {
+        return rows_[pos].bits;
+    }
+
+    const Label& label(uint64_t pos) const {
+        return labels_[pos];
+    }
+
+    //! ROW_PACKS words of row pos, aligned to 64 bytes
+    const uint64_t* row(uint64_t pos) const {
+        return rows_[pos].bits.data();
+    }
+
+    void set(uint64_t pos, const BitVec<SIZE>& example, Label label) {
+        rows_[pos].bits = example;
+        labels_[pos] = label;
+    }
+
+private:
+    std::vector<Row, detail::AlignedAllocator<Row>> rows_;
+    std::vector<Label> labels_;
+};
+
+template <unsigned SIZE, typename Label>
+constexpr unsigned BitMatrix<SIZE, Label>::ROW_PACKS;
+
+template <unsigned SIZE, typename Label>
+struct dataset_traits<BitMatrix<SIZE, Label>> {
+    typedef BitMatrix<SIZE, Label> storage_type;
+};
+
+template <unsigned SIZE, typename Label>
+uint64_t size(const BitMatrix<SIZE, Label>& dataset) {
+    return dataset.size();
+}
+
+template <unsigned SIZE, typename Label>
+const BitVec<SIZE>& example(uint64_t pos, const BitMatrix<SIZE, Label>& dataset) {
+    return dataset.example(pos);
+}
+
+template <unsigned SIZE, typename Label>
+const Label& label(uint64_t pos, const BitMatrix<SIZE, Label>& dataset) {
+    return dataset.label(pos);
+}
+
+//! Label is converted to the label type of dataset
+template <unsigned SIZE, typename Label>
+void set(
+        uint64_t pos,
+        const BitVec<SIZE>& example,
+        const std::common_type_t<Label>& label,
+        BitMatrix<SIZE, Label>& dataset) {
+    dataset.set(pos, example, label);
+}
+
+namespace detail {
+
+//! Popcount of the data words only, padding words are zero in both rows
+template <unsigned SIZE, typename Label>
+void distancesScalar(const uint64_t* x,
+        const BitMatrix<SIZE, Label>& dataset, unsigned* result) {
+    for (uint64_t i = 0; i < dataset.size(); ++i) {
+        const uint64_t* row = dataset.row(i);
+        unsigned sum = 0;
+        for (unsigned w = 0; w < BitVec<SIZE>::numPacks(); ++w) {
+            sum += __builtin_popcountll(x[w] ^ row[w]);
+        }
+        result[i] = sum;
+    }
+}
+
+#ifdef ML_BIT_MATRIX_POPCOUNT_DISPATCH
+
+//! distancesScalar compiled with the popcnt instruction instead of the
+//! generic bit counting sequence
+template <unsigned SIZE, typename Label>
+__attribute__((target("popcnt")))
+void distancesPopcnt(const uint64_t* x,
+        const BitMatrix<SIZE, Label>& dataset, unsigned* result) {
+    for (uint64_t i = 0; i < dataset.size(); ++i) {
+        const uint64_t* row = dataset.row(i);
+        unsigned sum = 0;
+        for (unsigned w = 0; w < BitVec<SIZE>::numPacks(); ++w) {
+            sum += static_cast<unsigned>(__builtin_popcountll(x[w] ^ row[w]));
+        }
+        result[i] = sum;
+    }
+}
+
+//! Rows are whole 512 bit registers, so every row takes aligned loads and
+//! VPOPCNTQ of ROW_PACKS / 8 registers and a single horizontal sum
+template <unsigned SIZE, typename Label>
+__attribute__((target("avx512f,avx512vpopcntdq")))
+void distancesAvx512(const uint64_t* x,
+        const BitMatrix<SIZE, Label>& dataset, unsigned* result) {
+    static const unsigned NUM_REGS = BitMatrix<SIZE, Label>::ROW_PACKS / 8;
+    __m512i xRegs[NUM_REGS];
+    for (unsigned r = 0; r < NUM_REGS; ++r) {
+        xRegs[r] = _mm512_load_si512(x + 8 * r);
+    }
+    for (uint64_t i = 0; i < dataset.size(); ++i) {
+        const uint64_t* row = dataset.row(i);
+        __m512i sum = _mm512_setzero_si512();
+        for (unsigned r = 0; r < NUM_REGS; ++r) {
+            const __m512i diff = _mm512_xor_si512(
+                    xRegs[r], _mm512_load_si512(row + 8 * r));
+            sum = _mm512_add_epi64(sum, _mm512_popcnt_epi64(diff));
+        }
+        // Lane sums are folded within the register, the total fits the
+        // low 32 bits of lane 0. Zero masked shuffles avoid the undefined
+        // source operand of the unmasked ones, which GCC warns about.
+        sum = _mm512_add_epi64(sum,
+                _mm512_maskz_shuffle_i64x2(0xff, sum, sum, 0x4e));
+        sum = _mm512_add_epi64(sum,
+                _mm512_maskz_shuffle_i64x2(0xff, sum, sum, 0xb1));
+        sum = _mm512_add_epi64(sum,
+                _mm512_maskz_shuffle_epi32(0xffff, sum, _MM_PERM_BADC));
+        result[i] = static_cast<unsigned>(_mm512_cvtsi512_si32(sum));
+    }
+}
+
+#endif
+
+//! True if distances uses the AVX-512 kernel on this CPU
+inline bool hasAvx512Popcount() {
+#ifdef ML_BIT_MATRIX_POPCOUNT_DISPATCH
+    static const bool supported = __builtin_cpu_supports("avx512f") &&
+        __builtin_cpu_supports("avx512vpopcntdq");
+    return supported;
+#else
+    return false;
+#endif
+}
+
+inline bool hasPopcnt() {
+#ifdef ML_BIT_MATRIX_POPCOUNT_DISPATCH
+    static const bool supported = __builtin_cpu_supports("popcnt");
+    return supported;
+#else
+    return false;
+#endif
+}
+
+} // namespace detail
+
+//! Hamming distances between x and every row of dataset. Uses VPOPCNTQ on
+//! whole padded rows if the CPU has it, otherwise counts bits of the data
+//! words of every row.
+template <unsigned SIZE, typename Label>
+std::vector<unsigned> distances(
+        const BitVec<SIZE>& x, const BitMatrix<SIZE, Label>& dataset) {
+    typename BitMatrix<SIZE, Label>::Row padded;
+    padded.bits = x;
+    const uint64_t* xPacks = padded.bits.data();
+    std::vector<unsigned> result(dataset.size());
+#ifdef ML_BIT_MATRIX_POPCOUNT_DISPATCH
+    if (detail::hasAvx512Popcount()) {
+        detail::distancesAvx512(xPacks, dataset, result.data());
+        return result;
+    }
+    if (detail::hasPopcnt()) {
+        detail::distancesPopcnt(xPacks, dataset, result.data());
+        return result;
+    }
+#endif
+    detail::distancesScalar(xPacks, dataset, result.data());
+    return result;
+}
+
+} // namespace ml
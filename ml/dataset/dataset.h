@@ -20,6 +20,7 @@ struct VecDataset {
 
 template <typename X, typename Y>
 struct dataset_traits<VecDataset<X, Y>> {
+    typedef VecDataset<X, Y> storage_type;
 };
 
 template <typename X, typename Y>
@@ -1,9 +1,42 @@
 #pragma once
 
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
 namespace ml {
 
 template <typename Dataset>
 struct dataset_traits { };
 
-} // namespace ml
+namespace detail {
+
+template <typename...>
+using void_t = void;
+
+template <typename Dataset, typename = void>
+struct StorageType {
+    typedef Dataset type;
+};
+
+template <typename Dataset>
+struct StorageType<Dataset,
+        void_t<typename dataset_traits<Dataset>::storage_type>> {
+    typedef typename dataset_traits<Dataset>::storage_type type;
+};
 
+} // namespace detail
+
+//! Dataset type owning examples, which is constructed by algorithms that
+//! copy subsets of Dataset. Views over other datasets declare it as
+//! dataset_traits<View>::storage_type, owning datasets are storage of their
+//! own.
+template <typename Dataset>
+using storage_t = typename detail::StorageType<Dataset>::type;
+
+//! Type of examples of Dataset
+template <typename Dataset>
+using example_t = std::decay_t<decltype(
+        example(uint64_t(0), std::declval<const Dataset&>()))>;
+
+} // namespace ml
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <ml/dataset/dataset_traits.h>
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace ml {
+
+//! Dataset consisting of examples of another dataset at given positions,
+//! e.g. a cross-validation fold. Examples are not copied; the underlying
+//! dataset must outlive the view.
+template <typename Dataset>
+class IndexView {
+public:
+    IndexView(const Dataset& dataset, std::vector<uint64_t> positions)
+        : dataset_(&dataset), positions_(std::move(positions)) {}
+
+    const Dataset& dataset() const {
+        return *dataset_;
+    }
+
+    const std::vector<uint64_t>& positions() const {
+        return positions_;
+    }
+
+private:
+    const Dataset* dataset_;
+    std::vector<uint64_t> positions_;
+};
+
+template <typename Dataset>
+struct dataset_traits<IndexView<Dataset>> {
+    typedef storage_t<Dataset> storage_type;
+};
+
+template <typename Dataset>
+uint64_t size(const IndexView<Dataset>& view) {
+    return view.positions().size();
+}
+
+template <typename Dataset>
+decltype(auto) example(uint64_t pos, const IndexView<Dataset>& view) {
+    return example(view.positions()[pos], view.dataset());
+}
+
+template <typename Dataset>
+decltype(auto) label(uint64_t pos, const IndexView<Dataset>& view) {
+    return label(view.positions()[pos], view.dataset());
+}
+
+} // namespace ml
@@ -0,0 +1,160 @@
+#pragma once
+
+#include <ml/bit_vec.h>
+#include <ml/dataset/dataset_traits.h>
+
+#include <cstdint>
+#include <istream>
+#include <string>
+#include <type_traits>
+
+#include <Eigen/Dense>
+
+namespace ml {
+
+//! 64 bit FNV-1a hash of bytes written to it. Has the write member of
+//! std::ostream, so anything written by writeExample / writeDataset can be
+//! hashed without serializing it first.
+class Fnv1aHash {
+public:
+    Fnv1aHash& write(const char* data, std::streamsize count) {
+        for (std::streamsize i = 0; i < count; ++i) {
+            value_ = (value_ ^ static_cast<unsigned char>(data[i])) *
+                0x100000001b3ull;
+        }
+        return *this;
+    }
+
+    uint64_t value() const {
+        return value_;
+    }
+
+private:
+    uint64_t value_ = 0xcbf29ce484222325ull;
+};
+
+namespace detail {
+
+template <typename Out, typename T>
+void writeValues(Out& o, const T* data, uint64_t count) {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "Only trivially copyable values are written as bytes");
+    o.write(reinterpret_cast<const char*>(data), sizeof(T) * count);
+}
+
+template <typename T>
+void readValues(std::istream& in, T* data, uint64_t count) {
+    in.read(reinterpret_cast<char*>(data), sizeof(T) * count);
+}
+
+//! Whether the rest of in has at least count values of given size, so a
+//! corrupt count isn't allocated. True for streams which can't seek.
+inline bool holds(std::istream& in, uint64_t count, uint64_t valueSize) {
+    const std::streampos position = in.tellg();
+    if (!in || position < 0) {
+        return bool(in);
+    }
+    in.seekg(0, std::ios::end);
+    const std::streampos end = in.tellg();
+    in.seekg(position);
+    return in && end >= position &&
+        count <= static_cast<uint64_t>(end - position) / valueSize;
+}
+
+} // namespace detail
+
+//! Writes value of trivially copyable type (e.g. a kernel) as bytes
+template <typename Out, typename T>
+void writeValue(Out& o, const T& value) {
+    detail::writeValues(o, &value, 1);
+}
+
+//! Reads value written by writeValue, T doesn't have to be default
+//! constructible
+template <typename T>
+T readValue(std::istream& in) {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "Only trivially copyable values are read as bytes");
+    std::aligned_storage_t<sizeof(T), alignof(T)> storage{};
+    in.read(reinterpret_cast<char*>(&storage), sizeof(T));
+    return reinterpret_cast<const T&>(storage);
+}
+
+template <typename Out>
+void writeString(Out& o, const std::string& s) {
+    const uint64_t length = s.size();
+    writeValue(o, length);
+    o.write(s.data(), length);
+}
+
+template <typename Out, unsigned SIZE>
+void writeExample(Out& o, const BitVec<SIZE>& x) {
+    detail::writeValues(o, x.data(), x.numPacks());
+}
+
+template <unsigned SIZE>
+void readExample(std::istream& in, BitVec<SIZE>& x) {
+    detail::readValues(in, x.data(), x.numPacks());
+}
+
+//! Dense examples are written with their dimensions
+template <typename Out, typename Derived>
+void writeExample(Out& o, const Eigen::DenseBase<Derived>& x) {
+    const typename Derived::PlainObject plain = x;
+    const uint64_t shape[] = {
+        static_cast<uint64_t>(plain.rows()),
+        static_cast<uint64_t>(plain.cols())};
+    detail::writeValues(o, shape, 2);
+    detail::writeValues(o, plain.data(), plain.size());
+}
+
+template <typename Scalar, int Rows, int Cols, int Options,
+         int MaxRows, int MaxCols>
+void readExample(std::istream& in,
+        Eigen::Matrix<Scalar, Rows, Cols, Options, MaxRows, MaxCols>& x) {
+    uint64_t shape[2];
+    detail::readValues(in, shape, 2);
+    if ((Rows != Eigen::Dynamic && shape[0] != uint64_t(Rows)) ||
+            (Cols != Eigen::Dynamic && shape[1] != uint64_t(Cols)) ||
+            !detail::holds(in, shape[0], sizeof(Scalar)) ||
+            (shape[0] > 0 && !detail::holds(
+                    in, shape[1], shape[0] * sizeof(Scalar)))) {
+        in.setstate(std::ios::failbit);
+        return;
+    }
+    x.resize(shape[0], shape[1]);
+    detail::readValues(in, x.data(), x.size());
+}
+
+//! Writes number of examples, examples and labels (as 64 bit integers)
+template <typename Out, typename Dataset>
+void writeDataset(Out& o, const Dataset& dataset) {
+    const uint64_t N = size(dataset);
+    writeValue(o, N);
+    for (uint64_t i = 0; i < N; ++i) {
+        writeExample(o, example(i, dataset));
+        const int64_t y = label(i, dataset);
+        writeValue(o, y);
+    }
+}
+
+//! Reads dataset written by writeDataset. Reading stops as soon as the
+//! stream fails, which callers should check. Stream fails if it's too
+//! short for the number of examples, each of them has a label at least.
+template <typename Dataset>
+Dataset readDataset(std::istream& in) {
+    const uint64_t N = readValue<uint64_t>(in);
+    if (!detail::holds(in, N, sizeof(int64_t))) {
+        in.setstate(std::ios::failbit);
+    }
+    Dataset result(in ? N : 0);
+    for (uint64_t i = 0; in && i < N; ++i) {
+        example_t<Dataset> x;
+        readExample(in, x);
+        const int64_t y = readValue<int64_t>(in);
+        set(i, x, static_cast<int>(y), result);
+    }
+    return result;
+}
+
+} // namespace ml
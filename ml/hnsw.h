@@ -0,0 +1,528 @@
+#pragma once
+
+#include <ml/dataset/serialization.h>
+#include <ml/exception.h>
+#include <ml/parallel.h>
+#include <ml/random.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <istream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <queue>
+#include <utility>
+#include <vector>
+
+#include <Eigen/Dense>
+
+namespace ml {
+namespace hnsw {
+
+//! (squared Euclidean distance, position of indexed point)
+typedef std::pair<float, uint64_t> Neighbour;
+
+//! HNSW index options
+struct Params {
+    //! Links per node on upper layers, twice as many on the bottom layer.
+    //! More links give better recall for more memory and slower inserts.
+    unsigned M = 16;
+    //! Size of candidate list of inserts, trades build time for recall
+    unsigned efConstruction = 200;
+    //! Default size of candidate list of searches, trades query time for
+    //! recall
+    unsigned ef = 50;
+    //! Threads inserting points concurrently
+    unsigned numThreads = defaultNumThreads();
+    //! Seed of random node levels
+    unsigned seed = 0;
+};
+
+namespace detail {
+
+//! Marks of visited nodes reset in O(1) by bumping the current tag
+class Visited {
+public:
+    explicit Visited(uint64_t size) : tags_(size, 0), tag_(0) {}
+
+    void clear() {
+        if (++tag_ == 0) {
+            std::fill(tags_.begin(), tags_.end(), 0);
+            tag_ = 1;
+        }
+    }
+
+    //! Marks node, returns true if it wasn't marked before
+    bool visit(uint64_t node) {
+        if (tags_[node] == tag_) {
+            return false;
+        }
+        tags_[node] = tag_;
+        return true;
+    }
+
+private:
+    std::vector<uint16_t> tags_;
+    uint16_t tag_;
+};
+
+//! Visited marks reused by searches, so queries don't allocate memory
+//! proportional to the index size
+class VisitedPool {
+public:
+    explicit VisitedPool(uint64_t size) : size_(size) {}
+
+    std::unique_ptr<Visited> acquire() {
+        std::unique_ptr<Visited> result;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!free_.empty()) {
+                result = std::move(free_.back());
+                free_.pop_back();
+            }
+        }
+        if (!result) {
+            result.reset(new Visited(size_));
+        }
+        result->clear();
+        return result;
+    }
+
+    void release(std::unique_ptr<Visited> visited) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        free_.push_back(std::move(visited));
+    }
+
+private:
+    uint64_t size_;
+    std::mutex mutex_;
+    std::vector<std::unique_ptr<Visited>> free_;
+};
+
+template <typename T>
+void write(std::ostream& o, const T* data, uint64_t count) {
+    o.write(reinterpret_cast<const char*>(data), sizeof(T) * count);
+}
+
+template <typename T>
+void read(std::istream& in, T* data, uint64_t count) {
+    in.read(reinterpret_cast<char*>(data), sizeof(T) * count);
+    REQUIRE(in, "Unexpected end of HNSW index");
+}
+
+} // namespace detail
+
+//! Approximate nearest neighbours search in Euclidean space with
+//! hierarchical navigable small world graphs (Malkov & Yashunin, 2016).
+//! Every point is a node of the bottom layer graph and of a random
+//! geometrically distributed number of sparser upper layers. Searches
+//! descend greedily from the single node of the top layer and finish with a
+//! beam search of width ef on the bottom layer, visiting O(log N) nodes.
+//! Points are stored as floats in columns of a matrix, links of the bottom
+//! layer are kept in one flat array to keep searches cache friendly.
+class Index {
+public:
+    //! Indexes columns of points, inserting them concurrently
+    template <typename Points>
+    Index(const Eigen::MatrixBase<Points>& points,
+          const Params& params = Params())
+        : points_(points.template cast<float>())
+        , M_(std::max(2u, params.M))
+        , maxM0_(2 * M_)
+        , efConstruction_(std::max(params.efConstruction, M_))
+        , ef_(std::max(1u, params.ef))
+        , entryPoint_(0)
+        , maxLevel_(0)
+        , visited_(new detail::VisitedPool(points_.cols())) {
+        REQUIRE(points_.cols() < (1l << 32),
+                "HNSW index supports up to 2^32 points");
+        REQUIRE(M_ <= MAX_M, "Too many links per node: " << M_);
+        build(params);
+    }
+
+    Index(Index&&) = default;
+    Index& operator= (Index&&) = default;
+
+    uint64_t size() const {
+        return points_.cols();
+    }
+
+    unsigned dimension() const {
+        return points_.rows();
+    }
+
+    const Eigen::MatrixXf& points() const {
+        return points_;
+    }
+
+    //! Approximate k nearest neighbours of query in increasing order of
+    //! distance, ef (0 selects Params::ef) is the size of the candidate list
+    template <typename Query>
+    std::vector<Neighbour> search(
+            const Eigen::MatrixBase<Query>& query,
+            unsigned k,
+            unsigned ef = 0) const {
+        REQUIRE(query.rows() == dimension() && query.cols() == 1,
+                "Invalid query size (" << query.rows() << "x" << query.cols()
+                << ") != (" << dimension() << "x1)");
+        if (size() == 0 || k == 0) {
+            return {};
+        }
+        const Eigen::VectorXf q = query.template cast<float>();
+        uint32_t node = entryPoint_;
+        for (unsigned level = maxLevel_; level > 0; --level) {
+            node = greedy(q, node, level, nullptr);
+        }
+        auto visited = visited_->acquire();
+        auto nearest = searchLayer(q, node, std::max(k, ef ? ef : ef_),
+                0, *visited, nullptr);
+        visited_->release(std::move(visited));
+
+        std::vector<Neighbour> result(nearest.size());
+        for (auto it = result.rbegin(); it != result.rend(); ++it) {
+            *it = Neighbour(nearest.top().first, nearest.top().second);
+            nearest.pop();
+        }
+        result.resize(std::min<uint64_t>(k, result.size()));
+        return result;
+    }
+
+    //! Writes index in a binary format readable by load() on machines of
+    //! the same endianness
+    void save(std::ostream& o) const {
+        const uint64_t header[] = {MAGIC, VERSION,
+            dimension(), size(), M_, efConstruction_, ef_,
+            entryPoint_, maxLevel_};
+        detail::write(o, header, sizeof(header) / sizeof(header[0]));
+        detail::write(o, levels_.data(), levels_.size());
+        detail::write(o, links0_.data(), links0_.size());
+        for (const auto& links: upperLinks_) {
+            detail::write(o, links.data(), links.size());
+        }
+        detail::write(o, points_.data(), points_.size());
+        REQUIRE(o, "Failed to write HNSW index");
+    }
+
+    //! Reads index written by save(), throws if it's truncated or its
+    //! header and links don't describe a valid graph
+    static Index load(std::istream& in) {
+        uint64_t header[9];
+        detail::read(in, header, 9);
+        REQUIRE(header[0] == MAGIC, "Not an HNSW index");
+        REQUIRE(header[1] == VERSION,
+                "Unsupported HNSW index version " << header[1]);
+        Index result;
+        const uint64_t dim = header[2];
+        const uint64_t N = header[3];
+        REQUIRE(header[4] >= 2 && header[4] <= MAX_M,
+                "Invalid number of links per node: " << header[4]);
+        result.M_ = header[4];
+        result.maxM0_ = 2 * result.M_;
+        result.efConstruction_ = header[5];
+        result.ef_ = header[6];
+        REQUIRE(N < (1ull << 32) && dim <= UINT32_MAX,
+                "Invalid HNSW index size " << dim << "x" << N);
+        // Every node has a level and bottom layer links, every point dim
+        // floats, so counts the stream can't hold aren't allocated
+        REQUIRE(ml::detail::holds(in, N,
+                    sizeof(uint8_t) + sizeof(uint32_t) * (result.maxM0_ + 1)) &&
+                (N == 0 || ml::detail::holds(in, dim, sizeof(float) * N)),
+                "Unexpected end of HNSW index");
+        REQUIRE(N == 0 ? header[7] == 0 && header[8] == 0 : header[7] < N,
+                "Invalid HNSW entry point " << header[7]);
+        result.entryPoint_ = header[7];
+        result.points_.resize(dim, N);
+        result.levels_.resize(N);
+        detail::read(in, result.levels_.data(), N);
+        REQUIRE(N == 0 || header[8] == result.levels_[result.entryPoint_],
+                "HNSW entry point isn't on the top level " << header[8]);
+        result.maxLevel_ = header[8];
+        for (uint8_t level: result.levels_) {
+            REQUIRE(level <= result.maxLevel_,
+                    "HNSW node level " << unsigned(level)
+                    << " is above the top level " << result.maxLevel_);
+        }
+        result.allocateLinks();
+        detail::read(in, result.links0_.data(), result.links0_.size());
+        for (auto& links: result.upperLinks_) {
+            detail::read(in, links.data(), links.size());
+        }
+        result.checkLinks();
+        detail::read(in, result.points_.data(), result.points_.size());
+        result.visited_.reset(new detail::VisitedPool(N));
+        return result;
+    }
+
+private:
+    static const uint64_t MAGIC = 0x57534e48; // "HNSW"
+    static const uint64_t VERSION = 1;
+    static const unsigned MAX_M = 256;
+
+    //! (distance, node), the farthest one on top
+    typedef std::priority_queue<std::pair<float, uint32_t>> Farthest;
+    //! (distance, node), the nearest one on top
+    typedef std::priority_queue<
+            std::pair<float, uint32_t>,
+            std::vector<std::pair<float, uint32_t>>,
+            std::greater<std::pair<float, uint32_t>>> Nearest;
+
+    Index() = default;
+
+    float distance(const Eigen::VectorXf& q, uint32_t node) const {
+        return (points_.col(node) - q).squaredNorm();
+    }
+
+    float distance(uint32_t a, uint32_t b) const {
+        return (points_.col(a) - points_.col(b)).squaredNorm();
+    }
+
+    unsigned maxLinks(unsigned level) const {
+        return level == 0 ? maxM0_ : M_;
+    }
+
+    //! Link count followed by maxLinks(level) link slots
+    uint32_t* links(uint32_t node, unsigned level) {
+        return level == 0 ?
+            &links0_[uint64_t(node) * (maxM0_ + 1)] :
+            &upperLinks_[node][(level - 1) * (M_ + 1)];
+    }
+
+    const uint32_t* links(uint32_t node, unsigned level) const {
+        return const_cast<Index*>(this)->links(node, level);
+    }
+
+    void allocateLinks() {
+        links0_.assign(uint64_t(size()) * (maxM0_ + 1), 0);
+        upperLinks_.resize(size());
+        for (uint64_t node = 0; node < size(); ++node) {
+            upperLinks_[node].assign(levels_[node] * (M_ + 1), 0);
+        }
+    }
+
+    //! Throws unless every link list fits its slots and points to a node
+    //! present on the level of the list
+    void checkLinks() const {
+        for (uint64_t node = 0; node < size(); ++node) {
+            for (unsigned level = 0; level <= levels_[node]; ++level) {
+                const uint32_t* l = links(node, level);
+                REQUIRE(l[0] <= maxLinks(level),
+                        "Too many links of HNSW node " << node << ": " << l[0]);
+                for (uint32_t i = 1; i <= l[0]; ++i) {
+                    REQUIRE(l[i] < size() && levels_[l[i]] >= level,
+                            "Invalid link of HNSW node " << node
+                            << " on level " << level << ": " << l[i]);
+                }
+            }
+        }
+    }
+
+    //! Calls f(neighbour) for every link of node, holding its lock while
+    //! the graph is being built
+    template <typename F>
+    void forEachLink(uint32_t node, unsigned level,
+            std::mutex* locks, F f) const {
+        if (!locks) {
+            const uint32_t* l = links(node, level);
+            for (uint32_t i = 1; i <= l[0]; ++i) {
+                f(l[i]);
+            }
+            return;
+        }
+        uint32_t copy[1 + 2 * MAX_M];
+        {
+            std::lock_guard<std::mutex> lock(locks[node]);
+            const uint32_t* l = links(node, level);
+            std::copy(l, l + 1 + l[0], copy);
+        }
+        for (uint32_t i = 1; i <= copy[0]; ++i) {
+            f(copy[i]);
+        }
+    }
+
+    //! Node nearest to q reachable greedily from start on level
+    uint32_t greedy(const Eigen::VectorXf& q, uint32_t start,
+            unsigned level, std::mutex* locks) const {
+        uint32_t node = start;
+        float best = distance(q, node);
+        bool improved = true;
+        while (improved) {
+            improved = false;
+            forEachLink(node, level, locks, [&](uint32_t neighbour) {
+                const float d = distance(q, neighbour);
+                if (d < best) {
+                    best = d;
+                    node = neighbour;
+                    improved = true;
+                }
+            });
+        }
+        return node;
+    }
+
+    //! ef nodes nearest to q found by beam search from start on level
+    Farthest searchLayer(const Eigen::VectorXf& q, uint32_t start,
+            unsigned ef, unsigned level, detail::Visited& visited,
+            std::mutex* locks) const {
+        Farthest result;
+        Nearest candidates;
+        const float d = distance(q, start);
+        result.emplace(d, start);
+        candidates.emplace(d, start);
+        visited.visit(start);
+        while (!candidates.empty()) {
+            const auto candidate = candidates.top();
+            if (candidate.first > result.top().first) {
+                break;
+            }
+            candidates.pop();
+            forEachLink(candidate.second, level, locks,
+                [&](uint32_t neighbour) {
+                    if (!visited.visit(neighbour)) {
+                        return;
+                    }
+                    const float d = distance(q, neighbour);
+                    if (result.size() < ef || d < result.top().first) {
+                        candidates.emplace(d, neighbour);
+                        result.emplace(d, neighbour);
+                        if (result.size() > ef) {
+                            result.pop();
+                        }
+                    }
+                });
+        }
+        return result;
+    }
+
+    //! Up to m candidates closer to the base node than to any closer
+    //! selected one, which keeps links pointing in diverse directions
+    std::vector<uint32_t> selectNeighbours(
+            std::vector<std::pair<float, uint32_t>> candidates,
+            unsigned m) const {
+        std::sort(candidates.begin(), candidates.end());
+        std::vector<uint32_t> result;
+        for (const auto& candidate: candidates) {
+            if (result.size() >= m) {
+                break;
+            }
+            bool diverse = true;
+            for (uint32_t selected: result) {
+                if (distance(candidate.second, selected) < candidate.first) {
+                    diverse = false;
+                    break;
+                }
+            }
+            if (diverse) {
+                result.push_back(candidate.second);
+            }
+        }
+        return result;
+    }
+
+    //! Adds link from node to neighbour, shrinking full link lists
+    void link(uint32_t node, uint32_t neighbour, unsigned level,
+            std::mutex* locks) {
+        std::lock_guard<std::mutex> lock(locks[node]);
+        uint32_t* l = links(node, level);
+        if (l[0] < maxLinks(level)) {
+            l[++l[0]] = neighbour;
+            return;
+        }
+        std::vector<std::pair<float, uint32_t>> candidates;
+        candidates.reserve(l[0] + 1);
+        candidates.emplace_back(distance(node, neighbour), neighbour);
+        for (uint32_t i = 1; i <= l[0]; ++i) {
+            candidates.emplace_back(distance(node, l[i]), l[i]);
+        }
+        const auto selected = selectNeighbours(
+                std::move(candidates), maxLinks(level));
+        l[0] = selected.size();
+        std::copy(selected.begin(), selected.end(), l + 1);
+    }
+
+    void insert(uint32_t node, detail::Visited& visited,
+            std::mutex& entryLock, std::mutex* locks) {
+        const unsigned level = levels_[node];
+        std::unique_lock<std::mutex> lock(entryLock);
+        const unsigned topLevel = maxLevel_;
+        uint32_t entry = entryPoint_;
+        if (level <= topLevel) {
+            lock.unlock();
+        }
+
+        const Eigen::VectorXf q = points_.col(node);
+        for (unsigned l = topLevel; l > level; --l) {
+            entry = greedy(q, entry, l, locks);
+        }
+        for (unsigned l = std::min(level, topLevel) + 1; l-- > 0; ) {
+            visited.clear();
+            auto found = searchLayer(
+                    q, entry, efConstruction_, l, visited, locks);
+            std::vector<std::pair<float, uint32_t>> candidates;
+            candidates.reserve(found.size());
+            for (; !found.empty(); found.pop()) {
+                candidates.push_back(found.top());
+            }
+            entry = candidates.back().second;
+            const auto neighbours = selectNeighbours(candidates, M_);
+            {
+                std::lock_guard<std::mutex> nodeLock(locks[node]);
+                uint32_t* l0 = links(node, l);
+                l0[0] = neighbours.size();
+                std::copy(neighbours.begin(), neighbours.end(), l0 + 1);
+            }
+            for (uint32_t neighbour: neighbours) {
+                link(neighbour, node, l, locks);
+            }
+        }
+        if (level > topLevel) {
+            maxLevel_ = level;
+            entryPoint_ = node;
+        }
+    }
+
+    void build(const Params& params) {
+        const uint64_t N = size();
+        levels_.resize(N);
+        Philox gen(params.seed);
+        const double levelMult = 1.0 / std::log(double(M_));
+        for (auto& level: levels_) {
+            level = static_cast<uint8_t>(std::min(31.0, std::floor(
+                        -std::log(1.0 - gen.uniform()) * levelMult)));
+        }
+        allocateLinks();
+        if (N == 0) {
+            return;
+        }
+        maxLevel_ = levels_[0];
+
+        std::unique_ptr<std::mutex[]> locks(new std::mutex[N]);
+        std::mutex entryLock;
+        std::atomic<uint64_t> next(1);
+        // Nodes are taken one at a time, so threads stay busy until the end
+        parallelRanges(0, params.numThreads, params.numThreads,
+            [&](unsigned, uint64_t, uint64_t) {
+                detail::Visited visited(N);
+                for (uint64_t node = next++; node < N; node = next++) {
+                    insert(node, visited, entryLock, locks.get());
+                }
+            });
+    }
+
+    Eigen::MatrixXf points_;
+    unsigned M_;
+    unsigned maxM0_;
+    unsigned efConstruction_;
+    unsigned ef_;
+    uint32_t entryPoint_;
+    unsigned maxLevel_;
+    std::vector<uint8_t> levels_;
+    std::vector<uint32_t> links0_;
+    std::vector<std::vector<uint32_t>> upperLinks_;
+    std::unique_ptr<detail::VisitedPool> visited_;
+};
+
+} // namespace hnsw
+} // namespace ml
@@ -4,9 +4,18 @@
 #include <ml/dot.h>
 
 #include <cmath>
+#include <limits>
+#include <type_traits>
+#include <utility>
+
+#include <Eigen/Dense>
 
 namespace ml {
 
+//! Example type is a dense Eigen vector
+template <typename Example>
+using IsDense = std::is_base_of<Eigen::MatrixBase<Example>, Example>;
+
 struct RBFKernel {
     RBFKernel() : sigma2_(1.0) {}
     explicit RBFKernel(double sigma2) : sigma2_(2.0 * sigma2) {}
@@ -22,10 +31,45 @@ struct RBFKernel {
         return std::exp(-static_cast<double>(distance(x, y)) / sigma2_);
     }
 
+    double sigma2() const {
+        return sigma2_ / 2.0;
+    }
+
+    //! Kernel values of rows of x and rows of y given squared norms of the
+    //! rows, computed as exp(-(|x|^2 + |y|^2 - 2 x y^T) / 2 sigma^2)
+    template <typename DerivedX, typename DerivedY>
+    Eigen::MatrixXd block(
+            const Eigen::MatrixBase<DerivedX>& x,
+            const Eigen::MatrixBase<DerivedY>& y,
+            const Eigen::VectorXd& xNorms,
+            const Eigen::VectorXd& yNorms) const {
+        Eigen::MatrixXd result = -2.0 * x * y.transpose();
+        result.colwise() += xNorms;
+        result.rowwise() += yNorms.transpose();
+        // Rounding errors may make squared distances slightly negative
+        return (-result.array().max(0.0) / sigma2_).exp().matrix();
+    }
+
 private:
     const double sigma2_;
 };
 
+struct LinearKernel {
+    template <typename RowVectorX, typename RowVectorY>
+    double operator() (const RowVectorX& x, const RowVectorY& y) const {
+        return static_cast<double>(dot(x, y));
+    }
+
+    template <typename DerivedX, typename DerivedY>
+    Eigen::MatrixXd block(
+            const Eigen::MatrixBase<DerivedX>& x,
+            const Eigen::MatrixBase<DerivedY>& y,
+            const Eigen::VectorXd&,
+            const Eigen::VectorXd&) const {
+        return x * y.transpose();
+    }
+};
+
 namespace {
 
 template <typename T>
@@ -44,7 +88,130 @@ struct PolynomialKernel {
         double base = 1.0 + static_cast<double>(dot(x, y));
         return pow(base, N);
     }
+
+    template <typename DerivedX, typename DerivedY>
+    Eigen::MatrixXd block(
+            const Eigen::MatrixBase<DerivedX>& x,
+            const Eigen::MatrixBase<DerivedY>& y,
+            const Eigen::VectorXd&,
+            const Eigen::VectorXd&) const {
+        Eigen::MatrixXd result = x * y.transpose();
+        return result.unaryExpr([](double d) { return pow(1.0 + d, N); });
+    }
 };
 
+namespace detail {
+
+template <typename Kernel, typename = void>
+struct HasBlock : std::false_type { };
+
+template <typename Kernel>
+struct HasBlock<Kernel, decltype(std::declval<const Kernel&>().block(
+            std::declval<const Eigen::MatrixXd&>(),
+            std::declval<const Eigen::MatrixXd&>(),
+            std::declval<const Eigen::VectorXd&>(),
+            std::declval<const Eigen::VectorXd&>()), void())>
+    : std::true_type { };
+
+template <typename Kernel, typename DerivedX, typename DerivedY>
+Eigen::MatrixXd kernelBlock(
+        const Kernel& kernel,
+        const Eigen::MatrixBase<DerivedX>& x,
+        const Eigen::MatrixBase<DerivedY>& y,
+        std::true_type) {
+    return kernel.block(x, y,
+            x.rowwise().squaredNorm(), y.rowwise().squaredNorm());
+}
+
+template <typename Kernel, typename DerivedX, typename DerivedY>
+Eigen::MatrixXd kernelBlock(
+        const Kernel& kernel,
+        const Eigen::MatrixBase<DerivedX>& x,
+        const Eigen::MatrixBase<DerivedY>& y,
+        std::false_type) {
+    Eigen::MatrixXd result(x.rows(), y.rows());
+    for (unsigned i = 0; i < x.rows(); ++i) {
+        for (unsigned j = 0; j < y.rows(); ++j) {
+            result(i, j) = kernel(x.row(i), y.row(j));
+        }
+    }
+    return result;
+}
+
+template <typename Kernel, typename DerivedX, typename DerivedY>
+Eigen::MatrixXd kernelBlock(
+        const Kernel& kernel,
+        const Eigen::MatrixBase<DerivedX>& x,
+        const Eigen::MatrixBase<DerivedY>& y,
+        const Eigen::VectorXd& yNorms,
+        std::true_type) {
+    return kernel.block(x, y, x.rowwise().squaredNorm(), yNorms);
+}
+
+template <typename Kernel, typename DerivedX, typename DerivedY>
+Eigen::MatrixXd kernelBlock(
+        const Kernel& kernel,
+        const Eigen::MatrixBase<DerivedX>& x,
+        const Eigen::MatrixBase<DerivedY>& y,
+        const Eigen::VectorXd&,
+        std::false_type) {
+    return kernelBlock(kernel, x, y, std::false_type());
+}
+
+} // namespace detail
+
+//! Kernel has block member computing kernel values of many pairs of dense
+//! examples with matrix products
+template <typename Kernel>
+using HasBlock = detail::HasBlock<Kernel>;
+
+//! Kernel values of all pairs of rows of dense matrices x and y. Kernels
+//! with block member are computed with a single matrix product (GEMM),
+//! others pair by pair.
+template <typename Kernel, typename DerivedX, typename DerivedY>
+Eigen::MatrixXd kernelBlock(
+        const Kernel& kernel,
+        const Eigen::MatrixBase<DerivedX>& x,
+        const Eigen::MatrixBase<DerivedY>& y) {
+    return detail::kernelBlock(kernel, x, y, HasBlock<Kernel>());
+}
+
+//! kernelBlock with squared norms of rows of y computed beforehand, e.g.
+//! once for fixed support vectors. Norms are unused by kernels without
+//! block member.
+template <typename Kernel, typename DerivedX, typename DerivedY>
+Eigen::MatrixXd kernelBlock(
+        const Kernel& kernel,
+        const Eigen::MatrixBase<DerivedX>& x,
+        const Eigen::MatrixBase<DerivedY>& y,
+        const Eigen::VectorXd& yNorms) {
+    return detail::kernelBlock(kernel, x, y, yNorms, HasBlock<Kernel>());
+}
+
+//! Gram matrix of rows of x
+template <typename Kernel, typename Derived>
+Eigen::MatrixXd gram(const Kernel& kernel, const Eigen::MatrixBase<Derived>& x) {
+    return kernelBlock(kernel, x, x);
+}
+
+//! Upper bound of |kernel(x, y)| over all examples y, which allows to stop
+//! summing a kernel expansion once the rest of it can't change its sign.
+//! Infinite when no bound is known.
+template <typename Kernel, typename RowVector>
+double kernelBound(const Kernel&, const RowVector&) {
+    return std::numeric_limits<double>::infinity();
+}
+
+template <typename RowVector>
+double kernelBound(const RBFKernel&, const RowVector&) {
+    return 1.0;
+}
+
+//! Dot product of binary vectors doesn't exceed the number of set bits
+template <unsigned N, unsigned SIZE>
+double kernelBound(const PolynomialKernel<N>&, const BitVec<SIZE>& x) {
+    return pow(1.0 + x.count(), N);
+}
+
 } // namespace ml
 
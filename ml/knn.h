@@ -0,0 +1,321 @@
+#pragma once
+
+#include <ml/bit_vec.h>
+#include <ml/dataset/bit_matrix.h>
+#include <ml/dataset/dataset_traits.h>
+#include <ml/exception.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <queue>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace ml {
+namespace knn {
+
+//! (Hamming distance, position in dataset)
+typedef std::pair<unsigned, uint64_t> Neighbour;
+
+//! k-NN search options
+struct Params {
+    //! Length of substrings of multi-index hashing, 0 selects log2 of the
+    //! dataset size. Longer substrings give fewer candidates per lookup
+    //! but more lookups per search radius.
+    unsigned substringBits = 0;
+    //! Largest substring length (up to 32), tables take 2^substringBits
+    //! entries each
+    unsigned maxSubstringBits = 20;
+    //! Searches which would look up more buckets than dataset size times
+    //! this factor scan the whole dataset instead
+    double maxLookupsRatio = 0.25;
+    //! Always scan the whole dataset
+    bool bruteForce = false;
+};
+
+namespace detail {
+
+//! Number of s bit keys at Hamming distance r from a key
+inline double numKeysAtRadius(unsigned s, unsigned r) {
+    double result = 1.0;
+    for (unsigned i = 0; i < r; ++i) {
+        result = result * (s - i) / (i + 1);
+    }
+    return result;
+}
+
+//! Next larger integer with the same number of set bits (Gosper's hack)
+inline uint64_t nextCombination(uint64_t mask) {
+    const uint64_t lowest = mask & -mask;
+    const uint64_t ripple = mask + lowest;
+    return ripple | (((mask ^ ripple) >> 2) / lowest);
+}
+
+//! k nearest neighbours seen so far, the farthest one on top
+class Nearest {
+public:
+    explicit Nearest(unsigned k) : k_(k) {}
+
+    void add(unsigned distance, uint64_t pos) {
+        const Neighbour neighbour(distance, pos);
+        if (heap_.size() < k_) {
+            heap_.push(neighbour);
+        } else if (neighbour < heap_.top()) {
+            heap_.pop();
+            heap_.push(neighbour);
+        }
+    }
+
+    bool full() const {
+        return heap_.size() == k_;
+    }
+
+    unsigned farthest() const {
+        return heap_.top().first;
+    }
+
+    //! Neighbours in increasing order of distance
+    std::vector<Neighbour> sorted() {
+        std::vector<Neighbour> result(heap_.size());
+        for (auto it = result.rbegin(); it != result.rend(); ++it) {
+            *it = heap_.top();
+            heap_.pop();
+        }
+        return result;
+    }
+
+private:
+    unsigned k_;
+    std::priority_queue<Neighbour> heap_;
+};
+
+} // namespace detail
+
+//! Exact Hamming k nearest neighbours search by multi-index hashing
+//! (Norouzi et al., 2012). Codes are split into m substrings, each indexed
+//! by its own table. Codes within distance d of a query share at least one
+//! substring within distance d / m of the query substring, so searching
+//! tables with growing substring radius r finds all codes within
+//! m * (r + 1) - 1 bits without scanning the dataset. Searches which would
+//! need too many lookups fall back to a linear scan of aligned rows.
+template <unsigned SIZE, typename Label = int>
+class MultiIndexHash {
+public:
+    template <typename Dataset>
+    MultiIndexHash(const Dataset& dataset, const Params& params = Params())
+        : params_(params)
+        , codes_(size(dataset)) {
+        for (uint64_t i = 0; i < size(dataset); ++i) {
+            set(i, example(i, dataset), label(i, dataset), codes_);
+        }
+        substringBits_ = params.substringBits;
+        if (substringBits_ == 0) {
+            substringBits_ = static_cast<unsigned>(std::round(
+                        std::log2(std::max<uint64_t>(2, size(dataset)))));
+        }
+        REQUIRE(params.maxSubstringBits <= 32,
+                "Substrings are too long: " << params.maxSubstringBits);
+        substringBits_ = std::max(1u,
+                std::min({substringBits_, params.maxSubstringBits, SIZE}));
+        numSubstrings_ = (SIZE + substringBits_ - 1) / substringBits_;
+        if (!params.bruteForce) {
+            buildTables();
+        }
+    }
+
+    const BitMatrix<SIZE, Label>& codes() const {
+        return codes_;
+    }
+
+    //! k nearest neighbours of x in increasing order of (distance, position)
+    std::vector<Neighbour> search(const BitVec<SIZE>& x, unsigned k) const {
+        k = static_cast<unsigned>(std::min<uint64_t>(k, codes_.size()));
+        detail::Nearest nearest(k);
+        if (k == 0) {
+            return nearest.sorted();
+        }
+        if (params_.bruteForce) {
+            return scan(x, k);
+        }
+
+        std::vector<uint64_t> queryKeys(numSubstrings_);
+        for (unsigned i = 0; i < numSubstrings_; ++i) {
+            queryKeys[i] = substring(x, i);
+        }
+        std::vector<bool> seen(codes_.size(), false);
+        const double maxLookups = params_.maxLookupsRatio * codes_.size();
+        double lookups = 0.0;
+        for (unsigned r = 0; r <= substringBits_; ++r) {
+            lookups += numSubstrings_ * detail::numKeysAtRadius(substringBits_, r);
+            if (lookups > maxLookups) {
+                // Codes found so far would be added twice
+                return scan(x, k);
+            }
+            for (unsigned i = 0; i < numSubstrings_; ++i) {
+                const unsigned bits = substringLength(i);
+                if (r > bits) {
+                    continue;
+                }
+                forEachKeyAtRadius(queryKeys[i], bits, r, [&](uint64_t key) {
+                    const auto& table = tables_[i];
+                    for (uint32_t b = table.offsets[key];
+                            b < table.offsets[key + 1]; ++b) {
+                        const uint32_t pos = table.positions[b];
+                        if (!seen[pos]) {
+                            seen[pos] = true;
+                            nearest.add(distance(x, example(pos, codes_)), pos);
+                        }
+                    }
+                });
+            }
+            // All codes within numSubstrings_ * (r + 1) - 1 bits are found
+            if (nearest.full() &&
+                    nearest.farthest() < numSubstrings_ * (r + 1)) {
+                break;
+            }
+        }
+        return nearest.sorted();
+    }
+
+private:
+    //! Positions of codes grouped by substring value
+    struct Table {
+        std::vector<uint32_t> offsets;
+        std::vector<uint32_t> positions;
+    };
+
+    unsigned substringLength(unsigned i) const {
+        return std::min(substringBits_, SIZE - i * substringBits_);
+    }
+
+    uint64_t substring(const BitVec<SIZE>& x, unsigned i) const {
+        return x.bits(i * substringBits_, substringLength(i));
+    }
+
+    void buildTables() {
+        REQUIRE(codes_.size() < (1ul << 32),
+                "Multi-index hashing supports up to 2^32 codes");
+        tables_.resize(numSubstrings_);
+        for (unsigned i = 0; i < numSubstrings_; ++i) {
+            Table& table = tables_[i];
+            table.offsets.assign((1ul << substringLength(i)) + 1, 0);
+            for (uint64_t pos = 0; pos < codes_.size(); ++pos) {
+                ++table.offsets[substring(example(pos, codes_), i) + 1];
+            }
+            for (uint64_t key = 1; key < table.offsets.size(); ++key) {
+                table.offsets[key] += table.offsets[key - 1];
+            }
+            table.positions.resize(codes_.size());
+            std::vector<uint32_t> next(
+                    table.offsets.begin(), table.offsets.end() - 1);
+            for (uint64_t pos = 0; pos < codes_.size(); ++pos) {
+                table.positions[next[substring(example(pos, codes_), i)]++] =
+                    static_cast<uint32_t>(pos);
+            }
+        }
+    }
+
+    template <typename F>
+    static void forEachKeyAtRadius(
+            uint64_t key, unsigned bits, unsigned r, F f) {
+        if (r == 0) {
+            f(key);
+            return;
+        }
+        const uint64_t end = 1ul << bits;
+        for (uint64_t mask = (1ul << r) - 1; mask < end;
+                mask = detail::nextCombination(mask)) {
+            f(key ^ mask);
+        }
+    }
+
+    std::vector<Neighbour> scan(const BitVec<SIZE>& x, unsigned k) const {
+        detail::Nearest nearest(k);
+        const auto all = distances(x, codes_);
+        for (uint64_t pos = 0; pos < all.size(); ++pos) {
+            nearest.add(all[pos], pos);
+        }
+        return nearest.sorted();
+    }
+
+    Params params_;
+    BitMatrix<SIZE, Label> codes_;
+    unsigned substringBits_;
+    unsigned numSubstrings_;
+    std::vector<Table> tables_;
+};
+
+namespace c12n {
+
+//! k nearest neighbours majority vote classifier of binary examples
+template <unsigned SIZE, typename Label = int>
+class KNNClassifier {
+public:
+    KNNClassifier(MultiIndexHash<SIZE, Label> index, unsigned k)
+        : index_(std::move(index)), k_(k) {}
+
+    //! Most frequent label among k nearest neighbours, ties are resolved in
+    //! favour of the label of the nearer neighbour
+    int operator() (const BitVec<SIZE>& row) const {
+        const auto neighbours = index_.search(row, k_);
+        REQUIRE(!neighbours.empty(), "Can't classify with empty dataset");
+        // (label, votes) in order of the nearest neighbour of each label
+        std::vector<std::pair<int, unsigned>> votes;
+        for (const auto& neighbour: neighbours) {
+            const int cls = label(neighbour.second, index_.codes());
+            auto it = std::find_if(votes.begin(), votes.end(),
+                    [cls](const std::pair<int, unsigned>& v) {
+                        return v.first == cls;
+                    });
+            if (it == votes.end()) {
+                votes.emplace_back(cls, 1);
+            } else {
+                ++it->second;
+            }
+        }
+        return std::max_element(votes.begin(), votes.end(),
+                [](const std::pair<int, unsigned>& a,
+                   const std::pair<int, unsigned>& b) {
+                    return a.second < b.second;
+                })->first;
+    }
+
+    const MultiIndexHash<SIZE, Label>& index() const {
+        return index_;
+    }
+
+private:
+    MultiIndexHash<SIZE, Label> index_;
+    unsigned k_;
+};
+
+} // namespace c12n
+
+namespace detail {
+
+template <typename Example>
+struct BitVecSize;
+
+template <unsigned SIZE>
+struct BitVecSize<BitVec<SIZE>> : std::integral_constant<unsigned, SIZE> { };
+
+} // namespace detail
+
+//! Build k-NN classifier of binary examples
+//!
+//! \param dataset Labelled dataset of BitVec examples
+//! \param k Number of neighbours voting for a label
+//! \param params Search options
+//! \return Multiclass classifier
+template <typename Dataset>
+c12n::KNNClassifier<detail::BitVecSize<example_t<Dataset>>::value> train(
+        const Dataset& dataset, unsigned k, const Params& params = Params()) {
+    const unsigned SIZE = detail::BitVecSize<example_t<Dataset>>::value;
+    return c12n::KNNClassifier<SIZE>(
+            MultiIndexHash<SIZE>(dataset, params), k);
+}
+
+} // namespace knn
+} // namespace ml
@@ -39,6 +39,27 @@ auto train(const Dataset& dataset, Model model)
         Dataset, Model, MaxWinsDecide>(dataset, model);
 }
 
+//! Train 'Max Wins' composite classifier, loading pair classifiers trained
+//! on unchanged classes from cache
+template <typename Dataset, typename Model>
+auto train(const Dataset& dataset, Model model,
+        c12n::composite::PairClassifierCache& cache)
+    -> decltype(c12n::composite::trainOneVsOneComposite<
+            Dataset, Model, MaxWinsDecide>(dataset, model, cache)) {
+    return c12n::composite::trainOneVsOneComposite<
+        Dataset, Model, MaxWinsDecide>(dataset, model, cache);
+}
+
+//! Train 'Max Wins' multiclass classifiers for a sequence of hyperparameter
+//! values, see c12n::composite::trainOneVsOneCompositePath
+template <typename Dataset, typename PathModel>
+auto trainPath(const Dataset& dataset, PathModel pathModel)
+    -> decltype(c12n::composite::trainOneVsOneCompositePath<
+            Dataset, PathModel, MaxWinsDecide>(dataset, pathModel)) {
+    return c12n::composite::trainOneVsOneCompositePath<
+        Dataset, PathModel, MaxWinsDecide>(dataset, pathModel);
+}
+
 } // namespace max_wins
 } // namespace ml
 
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <ml/dataset/serialization.h>
+#include <ml/exception.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <exception>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <utility>
+
+namespace ml {
+namespace c12n {
+namespace composite {
+
+//! On-disk cache of trained pair classifiers of composite multiclass
+//! classifiers. Every classifier is kept in its own file of directory named
+//! after its key, a hash of the examples of both classes and modelKey (see
+//! trainOneVsOneComposite), so retraining after examples of a single class
+//! change trains only pairs involving that class and loads the others.
+//!
+//! Classifiers are cached if they have save(std::ostream&) and
+//! static load(std::istream&) members, e.g. svc classifiers.
+class PairClassifierCache {
+public:
+    //! \param directory Existing directory holding cached classifiers
+    //! \param modelKey Description of every parameter of the model which
+    //!        trains pair classifiers (algorithm, kernel and its parameters,
+    //!        regularization, ...), classifiers trained with a different
+    //!        description are never loaded
+    PairClassifierCache(std::string directory, std::string modelKey)
+        : directory_(std::move(directory)), modelKey_(std::move(modelKey)) {}
+
+    const std::string& modelKey() const {
+        return modelKey_;
+    }
+
+    //! Classifier cached under key, or the one returned by train(), which
+    //! is cached then. Files which can't be read are replaced, also when
+    //! loading them throws (e.g. std::bad_alloc for a corrupt size).
+    template <typename Classifier, typename Train>
+    Classifier get(uint64_t key, Train train) {
+        const std::string path = this->path(key);
+        try {
+            std::ifstream in(path, std::ios::binary);
+            if (in && readValue<uint64_t>(in) == MAGIC &&
+                    readValue<uint64_t>(in) == VERSION &&
+                    readValue<uint64_t>(in) == key) {
+                Classifier classifier = Classifier::load(in);
+                if (in) {
+                    ++hits_;
+                    return classifier;
+                }
+            }
+        } catch (const std::exception&) {
+            // Retrained below
+        }
+        ++misses_;
+        Classifier classifier = train();
+        // Readers never see partially written files
+        const std::string tmpPath = path + ".tmp";
+        {
+            std::ofstream o(tmpPath, std::ios::binary | std::ios::trunc);
+            const uint64_t header[] = {MAGIC, VERSION, key};
+            writeValue(o, header);
+            classifier.save(o);
+            REQUIRE(o, "Failed to write pair classifier " << tmpPath);
+        }
+        if (std::rename(tmpPath.c_str(), path.c_str()) != 0) {
+            throw MAKE_EX(ml::RuntimeException,
+                    "Failed to replace pair classifier ") << path;
+        }
+        return classifier;
+    }
+
+    //! Number of classifiers loaded from files
+    uint64_t hits() const {
+        return hits_;
+    }
+
+    //! Number of classifiers trained
+    uint64_t misses() const {
+        return misses_;
+    }
+
+private:
+    std::string path(uint64_t key) const {
+        std::ostringstream oss;
+        oss << directory_ << "/" << std::hex << std::setw(16)
+            << std::setfill('0') << key << ".pair";
+        return oss.str();
+    }
+
+    static const uint64_t MAGIC = 0x52494150; // "PAIR"
+    static const uint64_t VERSION = 1;
+
+    std::string directory_;
+    std::string modelKey_;
+    uint64_t hits_ = 0;
+    uint64_t misses_ = 0;
+};
+
+} // namespace composite
+} // namespace c12n
+} // namespace ml
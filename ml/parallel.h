@@ -0,0 +1,226 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ml {
+
+//! Number of threads to use when caller didn't specify one
+inline unsigned defaultNumThreads() {
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+//! Splits [begin, end) into at most numThreads contiguous ranges and calls
+//! f(thread, rangeBegin, rangeEnd) for each of them concurrently. The last
+//! range is processed by the calling thread. Exceptions are propagated to
+//! the caller.
+template <typename F>
+void parallelRanges(uint64_t begin, uint64_t end, unsigned numThreads, F f) {
+    const uint64_t total = end > begin ? end - begin : 0;
+    const unsigned numRanges = static_cast<unsigned>(
+            std::max<uint64_t>(1, std::min<uint64_t>(numThreads, total)));
+    const uint64_t rangeSize = (total + numRanges - 1) / numRanges;
+
+    std::vector<std::future<void>> futures;
+    futures.reserve(numRanges - 1);
+    for (unsigned thread = 0; thread + 1 < numRanges; ++thread) {
+        const uint64_t rangeBegin = begin + thread * rangeSize;
+        const uint64_t rangeEnd = std::min(end, rangeBegin + rangeSize);
+        futures.push_back(std::async(std::launch::async,
+                    [&f, thread, rangeBegin, rangeEnd] {
+                        f(thread, rangeBegin, rangeEnd);
+                    }));
+    }
+    const uint64_t lastBegin =
+        std::min(end, begin + (numRanges - 1) * rangeSize);
+    f(numRanges - 1, lastBegin, end);
+    for (auto& future: futures) {
+        future.get();
+    }
+}
+
+//! Calls f(job) for every job in [0, numJobs) on numThreads threads
+//! including the calling one. Jobs are dealt round-robin into per-thread
+//! queues; a thread runs jobs from the front of its own queue and steals
+//! from the back of the others' when it runs out, so jobs of very different
+//! cost are balanced. The first exception thrown by a job is propagated to
+//! the caller after all threads stop.
+template <typename F>
+void parallelJobs(uint64_t numJobs, unsigned numThreads, F f) {
+    numThreads = static_cast<unsigned>(
+            std::max<uint64_t>(1, std::min<uint64_t>(numThreads, numJobs)));
+    struct Queue {
+        std::mutex mutex;
+        std::deque<uint64_t> jobs;
+    };
+    std::vector<Queue> queues(numThreads);
+    for (uint64_t job = 0; job < numJobs; ++job) {
+        queues[job % numThreads].jobs.push_back(job);
+    }
+
+    auto pop = [&](unsigned thread, uint64_t& job) {
+        for (unsigned i = 0; i < numThreads; ++i) {
+            Queue& queue = queues[(thread + i) % numThreads];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (queue.jobs.empty()) {
+                continue;
+            }
+            if (i == 0) {
+                job = queue.jobs.front();
+                queue.jobs.pop_front();
+            } else {
+                job = queue.jobs.back();
+                queue.jobs.pop_back();
+            }
+            return true;
+        }
+        return false;
+    };
+    std::atomic<bool> failed(false);
+    parallelRanges(0, numThreads, numThreads,
+        [&](unsigned, uint64_t thread, uint64_t) {
+            uint64_t job;
+            while (!failed && pop(thread, job)) {
+                try {
+                    f(job);
+                } catch (...) {
+                    failed = true;
+                    throw;
+                }
+            }
+        });
+}
+
+//! Fixed set of worker threads for repeated fine-grained parallel loops,
+//! avoiding thread creation on every call of parallelRanges. Calls of
+//! parallelRanges must not overlap.
+class ThreadPool {
+public:
+    //! Pool running loops on numThreads threads including the calling one
+    explicit ThreadPool(unsigned numThreads)
+        : generation_(0)
+        , pending_(0)
+        , stop_(false)
+        , task_(nullptr)
+        , context_(nullptr) {
+        for (unsigned i = 1; i < std::max(1u, numThreads); ++i) {
+            workers_.emplace_back([this, i] { work(i - 1); });
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator= (const ThreadPool&) = delete;
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        wake_.notify_all();
+        for (auto& worker: workers_) {
+            worker.join();
+        }
+    }
+
+    unsigned size() const {
+        return workers_.size() + 1;
+    }
+
+    //! Same as ml::parallelRanges with numThreads equal to size()
+    template <typename F>
+    void parallelRanges(uint64_t begin, uint64_t end, F f) {
+        const uint64_t total = end > begin ? end - begin : 0;
+        if (workers_.empty() || total < 2) {
+            f(0u, begin, end);
+            return;
+        }
+        const uint64_t rangeSize = (total + size() - 1) / size();
+        auto range = [&](unsigned thread) {
+            const uint64_t rangeBegin = std::min(end, begin + thread * rangeSize);
+            const uint64_t rangeEnd = std::min(end, rangeBegin + rangeSize);
+            if (rangeBegin < rangeEnd) {
+                f(thread, rangeBegin, rangeEnd);
+            }
+        };
+        typedef decltype(range) Range;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            task_ = [](const void* context, unsigned thread) {
+                (*static_cast<const Range*>(context))(thread);
+            };
+            context_ = &range;
+            pending_ = workers_.size();
+            error_ = nullptr;
+            ++generation_;
+        }
+        wake_.notify_all();
+
+        std::exception_ptr error;
+        try {
+            range(workers_.size());
+        } catch (...) {
+            error = std::current_exception();
+        }
+        std::unique_lock<std::mutex> lock(mutex_);
+        done_.wait(lock, [this] { return pending_ == 0; });
+        if (!error) {
+            error = error_;
+        }
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+
+private:
+    void work(unsigned thread) {
+        uint64_t seen = 0;
+        while (true) {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait(lock, [&] { return stop_ || generation_ != seen; });
+            if (stop_) {
+                return;
+            }
+            seen = generation_;
+            const auto task = task_;
+            const void* context = context_;
+            lock.unlock();
+
+            std::exception_ptr error;
+            try {
+                task(context, thread);
+            } catch (...) {
+                error = std::current_exception();
+            }
+
+            lock.lock();
+            if (error && !error_) {
+                error_ = error;
+            }
+            if (--pending_ == 0) {
+                lock.unlock();
+                done_.notify_one();
+            }
+        }
+    }
+
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+    uint64_t generation_;
+    unsigned pending_;
+    bool stop_;
+    void (*task_)(const void*, unsigned);
+    const void* context_;
+    std::exception_ptr error_;
+};
+
+} // namespace ml
@@ -0,0 +1,212 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+
+#include <Eigen/Dense>
+
+namespace ml {
+
+//! Philox4x32-10 counter-based generator (Salmon et al., 2011). Every
+//! block of 4 random words is a function of its 128 bit counter and the
+//! seed, so streams (the upper half of the counter) are independent and any
+//! block is computed without the preceding ones. Generators are cheap to
+//! create, e.g. one per thread with stream equal to thread index, which
+//! makes parallel runs reproducible. Satisfies UniformRandomBitGenerator,
+//! so it works with std distributions and std::shuffle.
+class Philox {
+public:
+    typedef uint32_t result_type;
+
+    explicit Philox(uint64_t seed = 0, uint64_t stream = 0)
+        : key_{{static_cast<uint32_t>(seed),
+                static_cast<uint32_t>(seed >> 32)}}
+        , stream_(stream) {}
+
+    static constexpr result_type min() {
+        return 0;
+    }
+
+    static constexpr result_type max() {
+        return std::numeric_limits<result_type>::max();
+    }
+
+    result_type operator() () {
+        if (position_ == 4) {
+            buffer_ = block(counter_++);
+            position_ = 0;
+        }
+        return buffer_[position_++];
+    }
+
+    //! Generator of another stream with the same seed
+    Philox stream(uint64_t stream) const {
+        Philox result;
+        result.key_ = key_;
+        result.stream_ = stream;
+        return result;
+    }
+
+    //! Words of block counter of this stream
+    std::array<uint32_t, 4> block(uint64_t counter) const {
+        uint32_t ctr[4] = {
+            static_cast<uint32_t>(counter),
+            static_cast<uint32_t>(counter >> 32),
+            static_cast<uint32_t>(stream_),
+            static_cast<uint32_t>(stream_ >> 32)};
+        rounds(ctr, key_[0], key_[1]);
+        return {{ctr[0], ctr[1], ctr[2], ctr[3]}};
+    }
+
+    //! Fills count words with the following blocks of the stream. Blocks
+    //! are computed in batches of independent lanes, which compilers
+    //! vectorize.
+    void fill(uint32_t* words, uint64_t count) {
+        // Buffered words come first to keep the sequence of operator()
+        while (count > 0 && position_ < 4) {
+            *words++ = buffer_[position_++];
+            --count;
+        }
+        static const unsigned LANES = 8;
+        while (count >= 4 * LANES) {
+            uint32_t ctr[4][LANES];
+            for (unsigned lane = 0; lane < LANES; ++lane) {
+                const uint64_t counter = counter_ + lane;
+                ctr[0][lane] = static_cast<uint32_t>(counter);
+                ctr[1][lane] = static_cast<uint32_t>(counter >> 32);
+                ctr[2][lane] = static_cast<uint32_t>(stream_);
+                ctr[3][lane] = static_cast<uint32_t>(stream_ >> 32);
+            }
+            uint32_t k0 = key_[0];
+            uint32_t k1 = key_[1];
+            for (unsigned round = 0; round < ROUNDS; ++round) {
+                for (unsigned lane = 0; lane < LANES; ++lane) {
+                    round4(ctr[0][lane], ctr[1][lane], ctr[2][lane],
+                            ctr[3][lane], k0, k1);
+                }
+                k0 += W0;
+                k1 += W1;
+            }
+            for (unsigned lane = 0; lane < LANES; ++lane) {
+                for (unsigned word = 0; word < 4; ++word) {
+                    words[4 * lane + word] = ctr[word][lane];
+                }
+            }
+            counter_ += LANES;
+            words += 4 * LANES;
+            count -= 4 * LANES;
+        }
+        while (count > 0) {
+            *words++ = (*this)();
+            --count;
+        }
+    }
+
+    //! Uniform double in [0, 1) with 53 random bits
+    double uniform() {
+        const uint32_t high = (*this)() >> 5;
+        const uint32_t low = (*this)() >> 6;
+        return (high * 67108864.0 + low) * (1.0 / 9007199254740992.0);
+    }
+
+    //! Uniform integer in [0, n) for n > 0, by multiplication with
+    //! rejection of the biased low range (Lemire, 2019)
+    uint32_t below(uint32_t n) {
+        uint64_t product = static_cast<uint64_t>((*this)()) * n;
+        uint32_t low = static_cast<uint32_t>(product);
+        if (low < n) {
+            const uint32_t threshold = -n % n;
+            while (low < threshold) {
+                product = static_cast<uint64_t>((*this)()) * n;
+                low = static_cast<uint32_t>(product);
+            }
+        }
+        return static_cast<uint32_t>(product >> 32);
+    }
+
+    //! Fills coefficients of m with uniform values in [low, high)
+    template <typename Derived>
+    void fillUniform(Eigen::PlainObjectBase<Derived>& m,
+            double low, double high) {
+        static const unsigned CHUNK = 256;
+        uint32_t words[2 * CHUNK];
+        const double scale = (high - low) * (1.0 / 9007199254740992.0);
+        auto* data = m.data();
+        for (Eigen::Index begin = 0; begin < m.size(); begin += CHUNK) {
+            const Eigen::Index n = std::min<Eigen::Index>(
+                    CHUNK, m.size() - begin);
+            fill(words, 2 * n);
+            for (Eigen::Index i = 0; i < n; ++i) {
+                const double bits = (words[2 * i] >> 5) * 67108864.0 +
+                    (words[2 * i + 1] >> 6);
+                data[begin + i] = low + bits * scale;
+            }
+        }
+    }
+
+private:
+    static const unsigned ROUNDS = 10;
+    static const uint32_t M0 = 0xD2511F53;
+    static const uint32_t M1 = 0xCD9E8D57;
+    static const uint32_t W0 = 0x9E3779B9;
+    static const uint32_t W1 = 0xBB67AE85;
+
+    static void round4(uint32_t& c0, uint32_t& c1, uint32_t& c2, uint32_t& c3,
+            uint32_t k0, uint32_t k1) {
+        const uint64_t p0 = static_cast<uint64_t>(M0) * c0;
+        const uint64_t p1 = static_cast<uint64_t>(M1) * c2;
+        const uint32_t n0 = static_cast<uint32_t>(p1 >> 32) ^ c1 ^ k0;
+        const uint32_t n2 = static_cast<uint32_t>(p0 >> 32) ^ c3 ^ k1;
+        c0 = n0;
+        c1 = static_cast<uint32_t>(p1);
+        c2 = n2;
+        c3 = static_cast<uint32_t>(p0);
+    }
+
+    static void rounds(uint32_t (&ctr)[4], uint32_t k0, uint32_t k1) {
+        for (unsigned round = 0; round < ROUNDS; ++round) {
+            round4(ctr[0], ctr[1], ctr[2], ctr[3], k0, k1);
+            k0 += W0;
+            k1 += W1;
+        }
+    }
+
+    std::array<uint32_t, 2> key_;
+    uint64_t stream_;
+    uint64_t counter_ = 0;
+    std::array<uint32_t, 4> buffer_{};
+    unsigned position_ = 4;
+};
+
+namespace detail {
+
+inline std::atomic<uint64_t>& globalSeed() {
+    static std::atomic<uint64_t> seed{0};
+    return seed;
+}
+
+inline std::atomic<uint64_t>& nextStream() {
+    static std::atomic<uint64_t> stream{0};
+    return stream;
+}
+
+} // namespace detail
+
+//! Seeds generators returned by randomStream() and restarts their
+//! numbering, so that a run making the same calls gets the same numbers
+inline void seedRandom(uint64_t seed) {
+    detail::globalSeed() = seed;
+    detail::nextStream() = 0;
+}
+
+//! Generator of a new stream of the global seed (see seedRandom) for code
+//! without a seed of its own, e.g. weights initialization. Streams are
+//! numbered in order of calls.
+inline Philox randomStream() {
+    return Philox(detail::globalSeed(), detail::nextStream()++);
+}
+
+} // namespace ml
@@ -0,0 +1,248 @@
+#pragma once
+
+#include <ml/dataset/dataset.h>
+#include <ml/parallel.h>
+#include <ml/random.h>
+#include <ml/svm/smo.h>
+#include <ml/svm/svc.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <numeric>
+#include <utility>
+#include <vector>
+
+namespace ml {
+namespace svm {
+namespace cascade {
+
+//! Cascade SVM options
+struct Params {
+    //! Number of subsets of training set solved in the first layer
+    unsigned numPartitions = 8;
+    //! Maximum number of passes through the cascade
+    unsigned maxPasses = 3;
+    //! Threads solving subproblems of a layer concurrently
+    unsigned numThreads = defaultNumThreads();
+    //! Seed of training set shuffling before partitioning
+    unsigned seed = 0;
+    //! Options of SMO solving every subproblem
+    smo::Params smo;
+};
+
+typedef std::vector<uint64_t> Positions;
+
+//! Solution of SVM dual problem restricted to examples at positions
+struct Solution {
+    Positions positions;
+    std::vector<double> alphas;
+    double threshold;
+};
+
+namespace detail {
+
+//! Solves the subproblem of examples at problem.positions warm started
+//! from problem.alphas and problem.threshold
+template <typename Dataset, typename Kernel>
+Solution solveSubset(
+        const Dataset& dataset,
+        Solution problem,
+        const double C,
+        Kernel kernel,
+        const smo::Params& params,
+        smo::Stats& stats) {
+    const auto subset = c12n::detail::subset(dataset, problem.positions);
+    auto solution = smo::solve(subset, C,
+            c12n::detail::wrapKernel(kernel, subset), params, stats,
+            smo::Solution(std::move(problem.alphas), problem.threshold));
+    return {std::move(problem.positions), std::move(solution.first),
+            solution.second};
+}
+
+//! Positions of support vectors in increasing order
+inline Positions supportVectors(const Solution& solution) {
+    Positions result;
+    for (uint64_t i = 0; i < solution.alphas.size(); ++i) {
+        if (solution.alphas[i] > 0.0) {
+            result.push_back(solution.positions[i]);
+        }
+    }
+    return result;
+}
+
+inline Positions merge(const Positions& a, const Positions& b) {
+    Positions result;
+    result.reserve(a.size() + b.size());
+    std::set_union(a.begin(), a.end(), b.begin(), b.end(),
+            std::back_inserter(result));
+    return result;
+}
+
+//! Alphas of solution at positions, which include positions of its support
+//! vectors, and zero at the other ones
+inline std::vector<double> alphasAt(
+        const Solution& solution, const Positions& positions) {
+    std::vector<double> result(positions.size(), 0.0);
+    uint64_t j = 0;
+    for (uint64_t i = 0; i < solution.alphas.size(); ++i) {
+        if (solution.alphas[i] > 0.0) {
+            while (positions[j] < solution.positions[i]) {
+                ++j;
+            }
+            result[j] = solution.alphas[i];
+        }
+    }
+    return result;
+}
+
+//! Subproblem of support vectors of solution starting from it
+inline Solution supportSolution(const Solution& solution) {
+    Solution result{supportVectors(solution), {}, solution.threshold};
+    result.alphas = alphasAt(solution, result.positions);
+    return result;
+}
+
+//! Subproblem of support vectors of a and b. In a feedback pass both
+//! solved problems which contained the support vectors of feedback, the
+//! solution of the previous pass, and started from it, so their changes
+//! are combined as a + b - feedback, which keeps the equality constraint of
+//! the dual. When that leaves [0, C] beyond rounding, which smo::solve
+//! clips, the subproblem starts from feedback. In the first pass a and b
+//! share no examples and a + b overshoots the merged solution, so the
+//! subproblem is solved from scratch.
+inline Solution mergeSolutions(
+        const Solution& a, const Solution& b, const Solution& feedback,
+        const double C) {
+    Solution result;
+    result.positions = merge(merge(supportVectors(a), supportVectors(b)),
+            supportVectors(feedback));
+    result.alphas = alphasAt(feedback, result.positions);
+    result.threshold = feedback.threshold;
+    if (feedback.positions.empty()) {
+        return result;
+    }
+    const auto alphasA = alphasAt(a, result.positions);
+    const auto alphasB = alphasAt(b, result.positions);
+    const double tolerance = 1e-9 * C;
+    std::vector<double> alphas(result.positions.size());
+    for (uint64_t i = 0; i < alphas.size(); ++i) {
+        alphas[i] = alphasA[i] + alphasB[i] - result.alphas[i];
+        if (alphas[i] < -tolerance || alphas[i] > C + tolerance) {
+            return result;
+        }
+    }
+    result.alphas = std::move(alphas);
+    result.threshold = a.threshold + b.threshold - feedback.threshold;
+    return result;
+}
+
+} // namespace detail
+
+//! Cascade SVM (Graf et al., 2005). Training set is split into partitions
+//! which are solved independently; support vectors of pairs of solutions
+//! are merged and solved again layer by layer down to a single problem.
+//! Support vectors of the last layer are fed back into every partition
+//! until they don't change between passes.
+template <typename Dataset, typename Kernel>
+Solution solve(
+        const Dataset& dataset,
+        const double C,
+        Kernel kernel,
+        const Params& params,
+        smo::Stats& stats) {
+    const uint64_t N = size(dataset);
+    const unsigned numPartitions = static_cast<unsigned>(
+            std::max<uint64_t>(1, std::min<uint64_t>(params.numPartitions, N)));
+
+    Positions shuffled(N);
+    std::iota(shuffled.begin(), shuffled.end(), 0);
+    Philox gen(params.seed);
+    std::shuffle(shuffled.begin(), shuffled.end(), gen);
+    std::vector<Positions> partitions(numPartitions);
+    for (uint64_t i = 0; i < N; ++i) {
+        partitions[i % numPartitions].push_back(shuffled[i]);
+    }
+    for (auto& partition: partitions) {
+        std::sort(partition.begin(), partition.end());
+    }
+
+    // Solution of the previous pass, its support vectors are fed back
+    Solution feedback{{}, {}, 0.0};
+    Solution result;
+    for (unsigned pass = 0; pass < std::max(1u, params.maxPasses); ++pass) {
+        const Positions feedbackSupport = detail::supportVectors(feedback);
+        std::vector<Solution> layer(numPartitions);
+        for (unsigned i = 0; i < numPartitions; ++i) {
+            layer[i].positions = detail::merge(partitions[i], feedbackSupport);
+            layer[i].alphas = detail::alphasAt(feedback, layer[i].positions);
+            layer[i].threshold = feedback.threshold;
+        }
+        while (true) {
+            std::vector<Solution> solutions(layer.size());
+            std::vector<smo::Stats> layerStats(layer.size());
+            parallelRanges(0, layer.size(), params.numThreads,
+                [&](unsigned, uint64_t begin, uint64_t end) {
+                    for (uint64_t i = begin; i < end; ++i) {
+                        solutions[i] = detail::solveSubset(dataset,
+                                std::move(layer[i]), C, kernel, params.smo,
+                                layerStats[i]);
+                    }
+                });
+            for (const auto& solutionStats: layerStats) {
+                stats += solutionStats;
+            }
+            if (layer.size() == 1) {
+                result = std::move(solutions.front());
+                break;
+            }
+            std::vector<Solution> next;
+            for (uint64_t i = 0; i < solutions.size(); i += 2) {
+                next.push_back(i + 1 < solutions.size() ?
+                    detail::mergeSolutions(solutions[i], solutions[i + 1],
+                            feedback, C) :
+                    detail::supportSolution(solutions[i]));
+            }
+            layer = std::move(next);
+        }
+
+        if (numPartitions == 1 ||
+                detail::supportVectors(result) == feedbackSupport) {
+            break;
+        }
+        feedback = result;
+    }
+    return result;
+}
+
+} // namespace cascade
+
+namespace c12n {
+
+//! Train soft margin SVM binary classifier with cascade of SMO solvers.
+//! Suitable for training sets too large for a single SMO run.
+//!
+//! \param trainingSet Labelled training dataset
+//! \param C Regularization parameter
+//! \param kernel Kernel function
+//! \param params Cascade options
+//! \return Binary classifier
+template <typename Dataset, typename Kernel>
+detail::SVMClassifier<storage_t<Dataset>, Kernel>
+trainCascade(
+        const Dataset& trainingSet,
+        const double C,
+        Kernel kernel,
+        const cascade::Params& params = cascade::Params()) {
+    smo::Stats stats;
+    const auto solution =
+        cascade::solve(trainingSet, C, kernel, params, stats);
+    return detail::makeClassifier(
+            detail::subset(trainingSet, solution.positions),
+            solution.alphas, solution.threshold, kernel, stats,
+            params.smo.maxSupportVectors);
+}
+
+} // namespace c12n
+} // namespace svm
+} // namespace ml
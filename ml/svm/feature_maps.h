@@ -0,0 +1,242 @@
+#pragma once
+
+#include <ml/bit_vec.h>
+#include <ml/dataset/dataset.h>
+#include <ml/dataset/dataset_traits.h>
+#include <ml/exception.h>
+#include <ml/kernels.h>
+#include <ml/random.h>
+#include <ml/svm/linear.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <numeric>
+#include <random>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <Eigen/Dense>
+
+namespace ml {
+namespace svm {
+
+typedef VecDataset<Eigen::RowVectorXd, int> DenseDataset;
+
+namespace detail {
+
+template <typename Derived>
+const Derived& toDense(const Eigen::MatrixBase<Derived>& x) {
+    return x.derived();
+}
+
+template <unsigned SIZE>
+Eigen::RowVectorXd toDense(const BitVec<SIZE>& x) {
+    Eigen::RowVectorXd result(SIZE);
+    for (unsigned i = 0; i < SIZE; ++i) {
+        result(i) = x(i) ? 1.0 : 0.0;
+    }
+    return result;
+}
+
+} // namespace detail
+
+//! Random Fourier features approximating RBF kernel (Rahimi & Recht, 2007):
+//! dot product of mapped examples converges to the kernel value as the
+//! number of features grows.
+class RandomFourierFeatures {
+public:
+    RandomFourierFeatures(
+            const RBFKernel& kernel,
+            unsigned inputDim,
+            unsigned numFeatures,
+            unsigned seed = 0)
+        : omega_(numFeatures, inputDim)
+        , phase_(numFeatures)
+        , scale_(std::sqrt(2.0 / numFeatures)) {
+        Philox gen(seed);
+        std::normal_distribution<> normal(0.0, 1.0 / std::sqrt(kernel.sigma2()));
+        std::uniform_real_distribution<> uniform(0.0, 2.0 * M_PI);
+        for (unsigned row = 0; row < omega_.rows(); ++row) {
+            for (unsigned col = 0; col < omega_.cols(); ++col) {
+                omega_(row, col) = normal(gen);
+            }
+            phase_(row) = uniform(gen);
+        }
+    }
+
+    template <typename Example>
+    Eigen::RowVectorXd operator() (const Example& x) const {
+        Eigen::VectorXd projection =
+            omega_ * detail::toDense(x).transpose() + phase_;
+        return features(projection);
+    }
+
+    //! Binary examples are projected by summing columns of set bits
+    template <unsigned SIZE>
+    Eigen::RowVectorXd operator() (const BitVec<SIZE>& x) const {
+        Eigen::VectorXd projection = phase_;
+        for (unsigned i = 0; i < SIZE; ++i) {
+            if (x(i)) {
+                projection += omega_.col(i);
+            }
+        }
+        return features(projection);
+    }
+
+    unsigned numFeatures() const {
+        return omega_.rows();
+    }
+
+private:
+    Eigen::RowVectorXd features(const Eigen::VectorXd& projection) const {
+        return scale_ * projection.array().cos().matrix().transpose();
+    }
+
+    Eigen::MatrixXd omega_;
+    Eigen::VectorXd phase_;
+    double scale_;
+};
+
+//! Nystroem approximation of an arbitrary kernel: examples are represented
+//! by kernel values at randomly sampled landmarks, whitened by the landmark
+//! Gram matrix.
+template <typename Kernel, typename Example>
+class NystromFeatures {
+public:
+    template <typename Dataset>
+    NystromFeatures(
+            Kernel kernel,
+            const Dataset& dataset,
+            unsigned numLandmarks,
+            unsigned seed = 0)
+        : kernel_(kernel) {
+        std::vector<uint64_t> indices(size(dataset));
+        std::iota(indices.begin(), indices.end(), 0);
+        Philox gen(seed);
+        std::shuffle(indices.begin(), indices.end(), gen);
+        indices.resize(std::min<uint64_t>(numLandmarks, indices.size()));
+        REQUIRE(!indices.empty(), "Can't sample landmarks from empty dataset");
+
+        const unsigned m = indices.size();
+        landmarks_.reserve(m);
+        for (uint64_t i: indices) {
+            landmarks_.push_back(example(i, dataset));
+        }
+        Eigen::SelfAdjointEigenSolver<Eigen::MatrixXd> eigen(
+                landmarksGram(IsDense<Example>()));
+        const auto& values = eigen.eigenvalues();
+        const double cutoff = 1e-10 * values.maxCoeff();
+        unsigned rank = 0;
+        for (unsigned i = 0; i < m; ++i) {
+            rank += values(i) > cutoff;
+        }
+        // Eigenvalues are sorted in increasing order
+        projection_ = eigen.eigenvectors().rightCols(rank) *
+            values.tail(rank).cwiseSqrt().cwiseInverse().asDiagonal();
+    }
+
+    template <typename RowVector>
+    Eigen::RowVectorXd operator() (const RowVector& x) const {
+        Eigen::RowVectorXd values(landmarks_.size());
+        for (unsigned i = 0; i < landmarks_.size(); ++i) {
+            values(i) = kernel_(x, landmarks_[i]);
+        }
+        return values * projection_;
+    }
+
+    unsigned numFeatures() const {
+        return projection_.cols();
+    }
+
+private:
+    //! Gram matrix of dense landmarks is computed by a matrix product
+    Eigen::MatrixXd landmarksGram(std::true_type) const {
+        Eigen::MatrixXd landmarks(landmarks_.size(), landmarks_.front().size());
+        for (unsigned i = 0; i < landmarks_.size(); ++i) {
+            landmarks.row(i) = landmarks_[i];
+        }
+        return gram(kernel_, landmarks);
+    }
+
+    Eigen::MatrixXd landmarksGram(std::false_type) const {
+        const unsigned m = landmarks_.size();
+        Eigen::MatrixXd result(m, m);
+        for (unsigned i = 0; i < m; ++i) {
+            for (unsigned j = 0; j <= i; ++j) {
+                result(i, j) = result(j, i) =
+                    kernel_(landmarks_[i], landmarks_[j]);
+            }
+        }
+        return result;
+    }
+
+    Kernel kernel_;
+    std::vector<Example> landmarks_;
+    Eigen::MatrixXd projection_;
+};
+
+template <typename Kernel, typename Dataset>
+NystromFeatures<Kernel, example_t<Dataset>> nystrom(
+        Kernel kernel,
+        const Dataset& dataset,
+        unsigned numLandmarks,
+        unsigned seed = 0) {
+    return NystromFeatures<Kernel, example_t<Dataset>>(
+            kernel, dataset, numLandmarks, seed);
+}
+
+//! Applies feature map to every example of dataset
+template <typename Dataset, typename FeatureMap>
+DenseDataset mapFeatures(const Dataset& dataset, const FeatureMap& map) {
+    DenseDataset result(size(dataset));
+    for (uint64_t i = 0; i < size(dataset); ++i) {
+        set(i, map(example(i, dataset)),
+            static_cast<int>(label(i, dataset)), result);
+    }
+    return result;
+}
+
+namespace c12n {
+namespace detail {
+
+//! Linear SVM classifier over explicitly mapped features
+template <typename FeatureMap>
+class FeatureMapClassifier {
+public:
+    FeatureMapClassifier(FeatureMap map, LinearClassifier linear)
+        : map_(std::move(map)), linear_(std::move(linear)) {}
+
+    template <typename RowVector>
+    int operator() (const RowVector& row) const {
+        return linear_(map_(row));
+    }
+
+private:
+    FeatureMap map_;
+    LinearClassifier linear_;
+};
+
+} // namespace detail
+
+//! Train SVM with approximate kernel given by an explicit feature map. Cost
+//! of training and inference is linear in the number of examples, accuracy
+//! is controlled by the number of features of the map.
+//!
+//! \param trainingSet Labelled training dataset
+//! \param C Regularization parameter
+//! \param map Feature map, e.g. RandomFourierFeatures or NystromFeatures
+//! \return Binary classifier
+template <typename Dataset, typename FeatureMap>
+detail::FeatureMapClassifier<FeatureMap>
+trainWithFeatureMap(
+        const Dataset& trainingSet, const double C, FeatureMap map) {
+    auto linear = trainLinear(mapFeatures(trainingSet, map), C);
+    return detail::FeatureMapClassifier<FeatureMap>(
+            std::move(map), std::move(linear));
+}
+
+} // namespace c12n
+} // namespace svm
+} // namespace ml
@@ -0,0 +1,171 @@
+#pragma once
+
+#include <ml/svm/smo_stats.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <list>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace ml {
+namespace svm {
+namespace smo {
+
+namespace detail {
+
+//! Kernel computing whole rows of kernel matrix at once by row(i, values)
+template <typename Kernel, typename = void>
+struct HasRows : std::false_type { };
+
+template <typename Kernel>
+struct HasRows<Kernel, decltype(std::declval<const Kernel&>().row(
+            0u, std::declval<double*>()), void())>
+    : std::true_type { };
+
+} // namespace detail
+
+//! Kernel matrix rows cached in LRU order within a memory budget. Entries of
+//! a cached row are computed on first access, so caching a row is cheap when
+//! only a few of its entries are used. Kernel values outside cached rows are
+//! looked up in the cached row of the other index (the matrix is symmetric)
+//! and computed directly otherwise. Kernels which compute whole rows at once
+//! (see detail::HasRows) fill cached rows eagerly instead. All evaluations
+//! are counted in stats.
+template <typename Kernel>
+class KernelCache {
+public:
+    //! Row of kernel matrix, valid until the next call to KernelCache::row
+    class Row {
+    public:
+        Row(const KernelCache& cache, unsigned i, double* values)
+            : cache_(cache), i_(i), values_(values) {}
+
+        double operator() (unsigned j) const {
+            return (*this)(j, *cache_.stats_);
+        }
+
+        //! Distinct entries may be accessed concurrently, each thread
+        //! counting its own kernel evaluations in stats
+        double operator() (unsigned j, Stats& stats) const {
+            if (!values_) {
+                stats.kernelEval();
+                return cache_.kernel_(i_, j);
+            }
+            if (std::isnan(values_[j])) {
+                stats.kernelEval();
+                values_[j] = cache_.kernel_(i_, j);
+            } else {
+                stats.kernelCacheHit();
+            }
+            return values_[j];
+        }
+
+    private:
+        const KernelCache& cache_;
+        unsigned i_;
+        double* values_;
+    };
+
+    KernelCache(
+            const Kernel& kernel,
+            unsigned size,
+            uint64_t budgetBytes,
+            Stats& stats)
+        : kernel_(kernel)
+        , size_(size)
+        , maxRows_(budgetBytes / (sizeof(double) * std::max(1u, size)))
+        , rows_(size)
+        , positions_(size)
+        , stats_(&stats) {
+        // Pair of rows is used at every step, caching less is pointless
+        if (maxRows_ < 2) {
+            maxRows_ = 0;
+        }
+    }
+
+    double operator() (unsigned i, unsigned j) const {
+        return (*this)(i, j, *stats_);
+    }
+
+    //! Missing entries of cached rows are stored, so this must not be
+    //! called concurrently (see lookup)
+    double operator() (unsigned i, unsigned j, Stats& stats) const {
+        if (!rows_[i].empty()) {
+            return Row(*this, i, rows_[i].data())(j, stats);
+        }
+        if (!rows_[j].empty()) {
+            return Row(*this, j, rows_[j].data())(i, stats);
+        }
+        stats.kernelEval();
+        return kernel_(i, j);
+    }
+
+    //! Read only lookup for concurrent scans over examples, every thread
+    //! counting its own kernel evaluations in stats. Entries missing in
+    //! cached rows are computed without being stored, since another thread
+    //! may look up the same entry of the row of the other index.
+    double lookup(unsigned i, unsigned j, Stats& stats) const {
+        const double cached = !rows_[i].empty() ? rows_[i][j] :
+            !rows_[j].empty() ? rows_[j][i] :
+            std::numeric_limits<double>::quiet_NaN();
+        if (!std::isnan(cached)) {
+            stats.kernelCacheHit();
+            return cached;
+        }
+        stats.kernelEval();
+        return kernel_(i, j);
+    }
+
+    //! Further evaluations are counted in stats
+    void attach(Stats& stats) {
+        stats_ = &stats;
+    }
+
+    //! Row i is cached (evicting the least recently used one if necessary)
+    //! unless the budget is too small
+    Row row(unsigned i) {
+        if (maxRows_ == 0) {
+            return Row(*this, i, nullptr);
+        }
+        if (!rows_[i].empty()) {
+            lru_.splice(lru_.begin(), lru_, positions_[i]);
+        } else {
+            if (lru_.size() == maxRows_) {
+                const unsigned evicted = lru_.back();
+                lru_.pop_back();
+                rows_[i].swap(rows_[evicted]);
+            }
+            fill(i, detail::HasRows<Kernel>());
+            lru_.push_front(i);
+            positions_[i] = lru_.begin();
+        }
+        return Row(*this, i, rows_[i].data());
+    }
+
+private:
+    void fill(unsigned i, std::true_type) {
+        rows_[i].resize(size_);
+        kernel_.row(i, rows_[i].data());
+        stats_->kernelEval(size_);
+    }
+
+    void fill(unsigned i, std::false_type) {
+        rows_[i].assign(size_, std::numeric_limits<double>::quiet_NaN());
+    }
+
+    const Kernel& kernel_;
+    unsigned size_;
+    uint64_t maxRows_;
+    mutable std::vector<std::vector<double>> rows_;
+    std::list<unsigned> lru_;
+    std::vector<std::list<unsigned>::iterator> positions_;
+    Stats* stats_;
+};
+
+} // namespace smo
+} // namespace svm
+} // namespace ml
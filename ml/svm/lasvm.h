@@ -0,0 +1,330 @@
+#pragma once
+
+#include <ml/dataset/dataset.h>
+#include <ml/dataset/dataset_traits.h>
+#include <ml/exception.h>
+#include <ml/svm/smo_stats.h>
+#include <ml/svm/svc.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <utility>
+#include <vector>
+
+namespace ml {
+namespace svm {
+namespace lasvm {
+
+//! Online solver options
+struct Params {
+    //! Steps are taken for pairs of examples violating optimality
+    //! conditions by more than tolerance
+    double tolerance = 0.001;
+    //! Reprocess steps taken after each added example
+    unsigned reprocessSteps = 1;
+    //! Non-support examples are dropped after every cleanInterval added
+    //! examples
+    uint64_t cleanInterval = 64;
+    //! Reprocess steps taken by finish() at most, 0 means no limit
+    uint64_t maxFinishSteps = 0;
+    //! Support vectors kept by classifiers (see svc::reduce), 0 keeps all
+    uint64_t maxSupportVectors = 0;
+};
+
+//! Online SVM solver (LASVM, Bordes et al., 2005). The solver keeps SMO
+//! state of an expansion set of examples: signed coefficients (alpha times
+//! label), gradients of the dual and the kernel matrix of the set. Every
+//! added example is inserted with a single SMO step pairing it with the
+//! most violating example (process), followed by a few steps between the
+//! most violating pair of the set (reprocess). Examples which are not
+//! support vectors and can't become ones are periodically dropped, so the
+//! cost of an update depends on the number of added examples and support
+//! vectors, not on the number of examples seen before.
+//!
+//! Kernel values of the expansion set are kept in memory, which takes
+//! 8 * n^2 bytes for n examples in the set.
+template <typename Example, typename Kernel>
+class Solver {
+public:
+    Solver(double C, Kernel kernel, const Params& params = Params())
+        : C_(C), kernel_(std::move(kernel)), params_(params) {
+        REQUIRE(C > 0.0, "Regularization parameter must be positive: " << C);
+    }
+
+    //! Adds labelled example (label is 1 or -1) and takes process and
+    //! reprocess steps
+    void add(const Example& x, int y) {
+        REQUIRE(y == 1 || y == -1, "Invalid label " << y);
+        const uint64_t k = insert(x, y);
+        process(k);
+        for (unsigned step = 0; step < params_.reprocessSteps; ++step) {
+            if (!reprocess()) {
+                break;
+            }
+        }
+        if (++sinceClean_ >= params_.cleanInterval) {
+            clean();
+        }
+    }
+
+    //! Adds every example of dataset in order
+    template <typename Dataset>
+    void add(const Dataset& dataset) {
+        for (uint64_t i = 0; i < size(dataset); ++i) {
+            add(example(i, dataset), label(i, dataset));
+        }
+    }
+
+    //! Reprocess steps until the expansion set is optimal within tolerance,
+    //! followed by dropping non-support examples. Examples can be added
+    //! afterwards.
+    void finish() {
+        for (uint64_t step = 0; params_.maxFinishSteps == 0 ||
+                step < params_.maxFinishSteps; ++step) {
+            if (!reprocess()) {
+                break;
+            }
+        }
+        clean();
+    }
+
+    //! Drops examples with zero coefficients whose gradients are beyond the
+    //! ones of the most violating pair, so that they wouldn't be picked by
+    //! a step of the current expansion set. Called every
+    //! Params::cleanInterval added examples and by finish(), doesn't change
+    //! the classifier.
+    void clean() {
+        sinceClean_ = 0;
+        const auto extremes = violatingPair();
+        if (extremes.first == NONE || extremes.second == NONE) {
+            return;
+        }
+        const double maxGradient = gradients_[extremes.first];
+        const double minGradient = gradients_[extremes.second];
+        std::vector<uint64_t> kept;
+        for (uint64_t s = 0; s < betas_.size(); ++s) {
+            const bool useless = betas_[s] == 0.0 &&
+                ((labels_[s] < 0 && gradients_[s] >= maxGradient) ||
+                 (labels_[s] > 0 && gradients_[s] <= minGradient));
+            if (!useless) {
+                kept.push_back(s);
+            }
+        }
+        if (kept.size() == betas_.size()) {
+            return;
+        }
+        for (uint64_t i = 0; i < kept.size(); ++i) {
+            const uint64_t s = kept[i];
+            if (s != i) {
+                examples_[i] = std::move(examples_[s]);
+            }
+            labels_[i] = labels_[s];
+            betas_[i] = betas_[s];
+            gradients_[i] = gradients_[s];
+            std::vector<double> row(kept.size());
+            for (uint64_t j = 0; j < kept.size(); ++j) {
+                row[j] = kernelRows_[s][kept[j]];
+            }
+            kernelRows_[i] = std::move(row);
+        }
+        examples_.resize(kept.size());
+        labels_.resize(kept.size());
+        betas_.resize(kept.size());
+        gradients_.resize(kept.size());
+        kernelRows_.resize(kept.size());
+    }
+
+    //! Number of examples in the expansion set
+    uint64_t numExamples() const {
+        return examples_.size();
+    }
+
+    uint64_t numSupportVectors() const {
+        return std::count_if(betas_.begin(), betas_.end(),
+                [](double beta) { return beta != 0.0; });
+    }
+
+    double threshold() const {
+        const auto extremes = violatingPair();
+        if (extremes.first == NONE || extremes.second == NONE) {
+            return 0.0;
+        }
+        return (gradients_[extremes.first] + gradients_[extremes.second]) / 2.0;
+    }
+
+    //! Costs of all steps taken so far
+    const smo::Stats& stats() const {
+        return stats_;
+    }
+
+    //! Classifier of the current solution, with support vectors ordered by
+    //! decreasing |alpha| and reduced to Params::maxSupportVectors
+    c12n::detail::SVMClassifier<VecDataset<Example, int>, Kernel>
+    classifier() const {
+        std::vector<uint64_t> positions;
+        for (uint64_t s = 0; s < betas_.size(); ++s) {
+            if (betas_[s] != 0.0) {
+                positions.push_back(s);
+            }
+        }
+        std::stable_sort(positions.begin(), positions.end(),
+            [this](uint64_t a, uint64_t b) {
+                return std::abs(betas_[a]) > std::abs(betas_[b]);
+            });
+        VecDataset<Example, int> supportVectors(positions.size());
+        std::vector<double> coefficients;
+        coefficients.reserve(positions.size());
+        for (uint64_t i = 0; i < positions.size(); ++i) {
+            set(i, examples_[positions[i]], labels_[positions[i]],
+                    supportVectors);
+            coefficients.push_back(betas_[positions[i]]);
+        }
+        return c12n::reduce(
+                c12n::detail::SVMClassifier<VecDataset<Example, int>, Kernel>(
+                    std::move(supportVectors),
+                    std::move(coefficients),
+                    threshold(),
+                    kernel_,
+                    stats_),
+                params_.maxSupportVectors);
+    }
+
+private:
+    static constexpr uint64_t NONE = std::numeric_limits<uint64_t>::max();
+
+    double lower(uint64_t s) const {
+        return std::min(0.0, C_ * labels_[s]);
+    }
+
+    double upper(uint64_t s) const {
+        return std::max(0.0, C_ * labels_[s]);
+    }
+
+    //! Appends example with zero coefficient, returns its position
+    uint64_t insert(const Example& x, int y) {
+        const uint64_t k = examples_.size();
+        std::vector<double> row(k + 1);
+        double gradient = y;
+        for (uint64_t s = 0; s < k; ++s) {
+            row[s] = kernel_(x, examples_[s]);
+            gradient -= betas_[s] * row[s];
+            kernelRows_[s].push_back(row[s]);
+        }
+        row[k] = kernel_(x, x);
+        stats_.kernelEval(k + 1);
+        examples_.push_back(x);
+        labels_.push_back(y);
+        betas_.push_back(0.0);
+        gradients_.push_back(gradient);
+        kernelRows_.push_back(std::move(row));
+        return k;
+    }
+
+    //! Example with the largest gradient whose coefficient can grow and the
+    //! one with the smallest gradient whose coefficient can decrease
+    std::pair<uint64_t, uint64_t> violatingPair() const {
+        uint64_t i = NONE;
+        uint64_t j = NONE;
+        for (uint64_t s = 0; s < betas_.size(); ++s) {
+            if (betas_[s] < upper(s) &&
+                    (i == NONE || gradients_[s] > gradients_[i])) {
+                i = s;
+            }
+            if (betas_[s] > lower(s) &&
+                    (j == NONE || gradients_[s] < gradients_[j])) {
+                j = s;
+            }
+        }
+        return {i, j};
+    }
+
+    //! SMO step increasing coefficient i and decreasing coefficient j if
+    //! they violate optimality conditions
+    bool step(uint64_t i, uint64_t j) {
+        if (i == NONE || j == NONE ||
+                gradients_[i] - gradients_[j] <= params_.tolerance) {
+            stats_.step(false);
+            return false;
+        }
+        const auto& rowI = kernelRows_[i];
+        const auto& rowJ = kernelRows_[j];
+        const double curvature = std::max(
+                rowI[i] + rowJ[j] - 2.0 * rowI[j], 1e-12);
+        const double lambda = std::min({
+                (gradients_[i] - gradients_[j]) / curvature,
+                upper(i) - betas_[i],
+                betas_[j] - lower(j)});
+        betas_[i] += lambda;
+        betas_[j] -= lambda;
+        for (uint64_t s = 0; s < gradients_.size(); ++s) {
+            gradients_[s] -= lambda * (rowI[s] - rowJ[s]);
+        }
+        stats_.step(true);
+        return true;
+    }
+
+    //! Step pairing example k with the most violating example of the other
+    //! direction
+    void process(uint64_t k) {
+        const auto extremes = violatingPair();
+        if (labels_[k] > 0) {
+            step(k, extremes.second);
+        } else {
+            step(extremes.first, k);
+        }
+    }
+
+    bool reprocess() {
+        const auto extremes = violatingPair();
+        return step(extremes.first, extremes.second);
+    }
+
+    double C_;
+    Kernel kernel_;
+    Params params_;
+    std::vector<Example> examples_;
+    std::vector<int> labels_;
+    //! Coefficients alpha times label, within [min(0, C y), max(0, C y)]
+    std::vector<double> betas_;
+    //! Gradients of the dual, y - sum of beta * K
+    std::vector<double> gradients_;
+    std::vector<std::vector<double>> kernelRows_;
+    uint64_t sinceClean_ = 0;
+    smo::Stats stats_;
+};
+
+template <typename Example, typename Kernel>
+constexpr uint64_t Solver<Example, Kernel>::NONE;
+
+} // namespace lasvm
+
+namespace c12n {
+
+//! Train soft margin SVM binary classifier with online solver, a single
+//! pass over the training set followed by reprocessing. Use lasvm::Solver
+//! directly to refresh a classifier with new examples.
+//!
+//! \param trainingSet Labelled training dataset
+//! \param C Regularization parameter
+//! \param kernel Kernel function
+//! \param params Online solver options
+//! \return Binary classifier
+template <typename Dataset, typename Kernel>
+detail::SVMClassifier<VecDataset<example_t<Dataset>, int>, Kernel>
+trainOnline(
+        const Dataset& trainingSet,
+        const double C,
+        Kernel kernel,
+        const lasvm::Params& params = lasvm::Params()) {
+    lasvm::Solver<example_t<Dataset>, Kernel> solver(C, kernel, params);
+    solver.add(trainingSet);
+    solver.finish();
+    return solver.classifier();
+}
+
+} // namespace c12n
+} // namespace svm
+} // namespace ml
@@ -0,0 +1,216 @@
+#pragma once
+
+#include <ml/bit_vec.h>
+#include <ml/dataset/dataset.h>
+#include <ml/kernels.h>
+#include <ml/random.h>
+#include <ml/sign.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <utility>
+#include <vector>
+
+#include <Eigen/Dense>
+
+namespace ml {
+namespace svm {
+namespace linear {
+
+typedef Eigen::RowVectorXd Weights;
+
+namespace detail {
+
+template <typename Derived>
+double dot(const Weights& w, const Eigen::MatrixBase<Derived>& x) {
+    return w.dot(x);
+}
+
+template <typename Derived>
+double squaredNorm(const Eigen::MatrixBase<Derived>& x) {
+    return x.squaredNorm();
+}
+
+template <typename Derived>
+void addScaled(Weights& w, double a, const Eigen::MatrixBase<Derived>& x) {
+    w += a * x;
+}
+
+template <typename Derived>
+unsigned dimension(const Eigen::MatrixBase<Derived>& x) {
+    return x.size();
+}
+
+template <unsigned SIZE>
+double dot(const Weights& w, const BitVec<SIZE>& x) {
+    double sum = 0.0;
+    x.forEachSet([&](unsigned pos) { sum += w(pos); });
+    return sum;
+}
+
+template <unsigned SIZE>
+double squaredNorm(const BitVec<SIZE>& x) {
+    return x.count();
+}
+
+template <unsigned SIZE>
+void addScaled(Weights& w, double a, const BitVec<SIZE>& x) {
+    x.forEachSet([&](unsigned pos) { w(pos) += a; });
+}
+
+template <unsigned SIZE>
+unsigned dimension(const BitVec<SIZE>&) {
+    return SIZE;
+}
+
+} // namespace detail
+
+//! Dual coordinate descent for L1-loss linear SVM (Hsieh et al., 2008)
+//! with shrinking of examples stuck at bounds. Bias is learned as a weight
+//! of an implicit constant feature. Works with dense Eigen rows and BitVec
+//! examples.
+//!
+//! \return Weight vector and bias
+template <typename Dataset>
+std::pair<Weights, double>
+solve(const Dataset& dataset,
+      const double C,
+      const double eps = 0.1,
+      const unsigned maxIterations = 1000) {
+    const uint64_t N = size(dataset);
+    if (N == 0) {
+        return {Weights(), 0.0};
+    }
+    Weights w = Weights::Zero(detail::dimension(example(0, dataset)));
+    double bias = 0.0;
+    std::vector<double> alphas(N, 0.0);
+    std::vector<double> diag(N);
+    for (uint64_t i = 0; i < N; ++i) {
+        diag[i] = detail::squaredNorm(example(i, dataset)) + 1.0;
+    }
+
+    const double inf = std::numeric_limits<double>::infinity();
+    std::vector<uint64_t> active(N);
+    std::iota(active.begin(), active.end(), 0);
+    uint64_t activeSize = N;
+    // Projected gradient bounds of the previous pass used for shrinking
+    double maxPGOld = inf;
+    double minPGOld = -inf;
+    Philox gen(0);
+    for (unsigned iteration = 0; iteration < maxIterations; ++iteration) {
+        std::shuffle(active.begin(), active.begin() + activeSize, gen);
+        double maxPG = -inf;
+        double minPG = inf;
+        for (uint64_t pos = 0; pos < activeSize; ++pos) {
+            const uint64_t i = active[pos];
+            const auto& x = example(i, dataset);
+            const double y = label(i, dataset);
+            const double G = y * (detail::dot(w, x) + bias) - 1.0;
+            double PG = G;
+            if (alphas[i] == 0.0) {
+                if (G > maxPGOld) {
+                    std::swap(active[pos--], active[--activeSize]);
+                    continue;
+                }
+                PG = std::min(G, 0.0);
+            } else if (alphas[i] == C) {
+                if (G < minPGOld) {
+                    std::swap(active[pos--], active[--activeSize]);
+                    continue;
+                }
+                PG = std::max(G, 0.0);
+            }
+            maxPG = std::max(maxPG, PG);
+            minPG = std::min(minPG, PG);
+            if (PG != 0.0) {
+                const double alpha =
+                    std::min(std::max(alphas[i] - G / diag[i], 0.0), C);
+                const double d = (alpha - alphas[i]) * y;
+                alphas[i] = alpha;
+                detail::addScaled(w, d, x);
+                bias += d;
+            }
+        }
+        if (maxPG - minPG < eps) {
+            if (activeSize == N) {
+                break;
+            }
+            // Converged on the shrunk problem, verify on all examples
+            activeSize = N;
+            maxPGOld = inf;
+            minPGOld = -inf;
+            continue;
+        }
+        maxPGOld = maxPG > 0.0 ? maxPG : inf;
+        minPGOld = minPG < 0.0 ? minPG : -inf;
+    }
+    return {std::move(w), bias};
+}
+
+} // namespace linear
+
+namespace c12n {
+namespace detail {
+
+//! Binary linear SVM classifier
+class LinearClassifier {
+public:
+    LinearClassifier(linear::Weights weights, double bias)
+        : weights_(std::move(weights)), bias_(bias) {}
+
+    template <typename RowVector>
+    double decision(const RowVector& row) const {
+        return linear::detail::dot(weights_, row) + bias_;
+    }
+
+    template <typename RowVector>
+    int operator() (const RowVector& row) const {
+        return sign(decision(row));
+    }
+
+    const linear::Weights& weights() const {
+        return weights_;
+    }
+
+    double bias() const {
+        return bias_;
+    }
+
+private:
+    linear::Weights weights_;
+    double bias_;
+};
+
+} // namespace detail
+
+//! Train linear soft margin SVM binary classifier. Prediction costs a single
+//! dot product with the weight vector regardless of the number of support
+//! vectors.
+//!
+//! \param trainingSet Labelled training dataset
+//! \param C Regularization parameter
+//! \return Binary classifier
+template <typename Dataset>
+detail::LinearClassifier
+trainLinear(const Dataset& trainingSet, const double C) {
+    auto solution = linear::solve(trainingSet, C);
+    return detail::LinearClassifier(
+            std::move(solution.first), solution.second);
+}
+
+//! Linear kernel SVM is trained in primal weights representation
+template <typename Dataset>
+detail::LinearClassifier
+train(const Dataset& trainingSet, const double C, LinearKernel) {
+    return trainLinear(trainingSet, C);
+}
+
+} // namespace c12n
+} // namespace svm
+
+namespace svc = svm::c12n;
+
+} // namespace ml
@@ -0,0 +1,155 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <shared_mutex>
+#include <utility>
+#include <vector>
+
+namespace ml {
+namespace svm {
+namespace smo {
+
+//! Kernel values keyed by pairs of indices of the original training set,
+//! shared by solvers of different subproblems (e.g. pair classifiers of a
+//! composite classifier, which see every example in K - 1 subproblems).
+//! Values are kept in open addressing hash tables of shards guarded by
+//! reader-writer locks, so concurrent lookups don't block each other.
+//! Values are not cached any more once the memory budget is exhausted.
+class SharedKernelCache {
+public:
+    explicit SharedKernelCache(uint64_t budgetBytes, unsigned numShards = 64)
+        : shards_(std::max(1u, numShards))
+        , maxShardCapacity_(budgetBytes / shards_.size() / sizeof(Entry)) {}
+
+    SharedKernelCache(const SharedKernelCache&) = delete;
+    SharedKernelCache& operator= (const SharedKernelCache&) = delete;
+
+    //! Kernel value of examples i and j, calling compute() on cache miss
+    template <typename Compute>
+    double operator() (uint64_t i, uint64_t j, Compute compute) {
+        // Zero key marks empty entries
+        const uint64_t key = (i < j ? (j << 32) | i : (i << 32) | j) + 1;
+        const uint64_t hash = key * 0x9E3779B97F4A7C15ull;
+        Shard& shard = shards_[(hash >> 48) % shards_.size()];
+        {
+            std::shared_lock<std::shared_timed_mutex> lock(shard.mutex);
+            const Entry* entry = find(shard, key, hash);
+            if (entry && entry->key == key) {
+                shard.hits.fetch_add(1, std::memory_order_relaxed);
+                return entry->value;
+            }
+        }
+        const double value = compute();
+        std::lock_guard<std::shared_timed_mutex> lock(shard.mutex);
+        ++shard.misses;
+        // Keep load factor at most 1/2
+        if (2 * (shard.size + 1) > shard.entries.size()) {
+            grow(shard);
+            if (2 * (shard.size + 1) > shard.entries.size()) {
+                return value;
+            }
+        }
+        Entry* entry = find(shard, key, hash);
+        if (entry->key == 0) {
+            *entry = {key, value};
+            ++shard.size;
+        }
+        return value;
+    }
+
+    //! Number of lookups which found cached value
+    uint64_t hits() const {
+        uint64_t result = 0;
+        for (const auto& shard: shards_) {
+            result += shard.hits.load(std::memory_order_relaxed);
+        }
+        return result;
+    }
+
+    //! Number of lookups which computed kernel value
+    uint64_t misses() const {
+        uint64_t result = 0;
+        for (const auto& shard: shards_) {
+            std::shared_lock<std::shared_timed_mutex> lock(shard.mutex);
+            result += shard.misses;
+        }
+        return result;
+    }
+
+private:
+    struct Entry {
+        uint64_t key;
+        double value;
+    };
+
+    struct Shard {
+        mutable std::shared_timed_mutex mutex;
+        //! Power of two number of entries, linear probing
+        std::vector<Entry> entries;
+        uint64_t size = 0;
+        std::atomic<uint64_t> hits{0};
+        uint64_t misses = 0;
+    };
+
+    //! Entry with key or empty entry where it belongs, nullptr if there are
+    //! no entries
+    static Entry* find(Shard& shard, uint64_t key, uint64_t hash) {
+        if (shard.entries.empty()) {
+            return nullptr;
+        }
+        const uint64_t mask = shard.entries.size() - 1;
+        for (uint64_t pos = hash & mask; ; pos = (pos + 1) & mask) {
+            Entry& entry = shard.entries[pos];
+            if (entry.key == key || entry.key == 0) {
+                return &entry;
+            }
+        }
+    }
+
+    void grow(Shard& shard) const {
+        const uint64_t capacity =
+            std::max<uint64_t>(1024, 2 * shard.entries.size());
+        if (capacity > maxShardCapacity_) {
+            return;
+        }
+        std::vector<Entry> entries(capacity, Entry{0, 0.0});
+        entries.swap(shard.entries);
+        for (const Entry& entry: entries) {
+            if (entry.key != 0) {
+                *find(shard, entry.key,
+                      entry.key * 0x9E3779B97F4A7C15ull) = entry;
+            }
+        }
+    }
+
+    std::vector<Shard> shards_;
+    uint64_t maxShardCapacity_;
+};
+
+//! Kernel of a subproblem given by positions (i, j) in its dataset, looking
+//! values up in a shared cache by original indices keys[i], keys[j]
+template <typename Kernel>
+class SharedCachedKernel {
+public:
+    SharedCachedKernel(
+            Kernel kernel,
+            SharedKernelCache& cache,
+            const std::vector<unsigned>& keys)
+        : kernel_(std::move(kernel)), cache_(cache), keys_(keys) {}
+
+    double operator() (unsigned i, unsigned j) const {
+        return cache_(keys_[i], keys_[j], [&] { return kernel_(i, j); });
+    }
+
+private:
+    Kernel kernel_;
+    SharedKernelCache& cache_;
+    const std::vector<unsigned>& keys_;
+};
+
+} // namespace smo
+} // namespace svm
+} // namespace ml
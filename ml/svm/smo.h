@@ -3,11 +3,17 @@
 #include <ml/dataset/dataset.h>
 #include <ml/dataset/dataset_traits.h>
 #include <ml/dot.h>
+#include <ml/exception.h>
+#include <ml/parallel.h>
+#include <ml/random.h>
 #include <ml/sign.h>
+#include <ml/svm/kernel_cache.h>
+#include <ml/svm/smo_stats.h>
 
 #include <algorithm>
+#include <functional>
+#include <memory>
 #include <numeric>
-#include <random>
 #include <tuple>
 #include <unordered_set>
 #include <vector>
@@ -19,13 +25,29 @@ namespace ml {
 namespace svm {
 namespace smo {
 
-namespace {
+//! Solver options
+struct Params {
+    //! Keep errors up to date only for non-bound examples. Errors of bound
+    //! examples are recomputed on demand, which reduces number of kernel
+    //! evaluations per step from 2N to about twice the non-bound set size.
+    bool sparseErrorCache = false;
+    //! Memory budget for cached kernel matrix rows, in bytes
+    uint64_t kernelCacheBytes = 0;
+    //! Threads used for scans over all examples (error cache updates,
+    //! second choice heuristic and threshold computation)
+    unsigned numThreads = 1;
+    //! Problems with fewer examples are solved on the calling thread only
+    uint64_t parallelThreshold = 10000;
+    //! Option of svc::train, svc::trainPath and cascade training rather
+    //! than of the solver, which doesn't read it: classifiers built from
+    //! the solution are compressed to at most this many support vectors
+    //! with svc::reduce, 0 keeps all of them
+    uint64_t maxSupportVectors = 0;
+    //! Seed of random starting positions of scans for the second example
+    uint64_t seed = 0;
+};
 
-uint64_t random(uint64_t n) {
-    static std::random_device rd;
-    std::uniform_int_distribution<uint64_t> dist(0, n - 1);
-    return dist(rd);
-}
+namespace {
 
 bool nonBound(double x, double bound) {
     return x > 0.0 && x < bound;
@@ -35,34 +57,39 @@ double clip(double x, double low, double high) {
     return std::max(low, std::min(high, x));
 }
 
-class ErrorCache {
+//! Runs reductions over examples on a thread pool if the problem is large
+//! enough. Every thread counts solver costs in its own Stats, which are
+//! merged into the caller's ones.
+class Workers {
 public:
-    explicit ErrorCache(const unsigned size) : cache_(size) {}
-
-    double operator() (unsigned i) const {
-        return cache_[i];
-    }
-
-    void set(unsigned i, double value) {
-        cache_[i] = value;
-    }
-
-    template <typename Kernel>
-    void update(
-            unsigned i0, double dAlpha0,
-            unsigned i1, double dAlpha1,
-            double dThreshold,
-            const Kernel& kernel) {
-        const unsigned size = cache_.size();
-        for (unsigned i = 0; i < size; ++i) {
-            cache_[i] += dThreshold +
-                dAlpha0 * kernel(i, i0) + dAlpha1 * kernel(i, i1);
+    Workers(uint64_t size, const Params& params)
+        : pool_(params.numThreads > 1 && size >= params.parallelThreshold ?
+                new ThreadPool(params.numThreads) : nullptr) {}
+
+    //! Combines f(stats, begin, end) results of ranges of [0, end) in
+    //! order of ranges
+    template <typename T, typename F, typename Combine>
+    T reduce(uint64_t end, Stats& stats, T init, F f, Combine combine) {
+        if (!pool_) {
+            return combine(init, f(stats, uint64_t(0), end));
         }
+        std::vector<T> results(pool_->size(), init);
+        std::vector<Stats> threadStats(pool_->size());
+        pool_->parallelRanges(0, end,
+            [&](unsigned thread, uint64_t rangeBegin, uint64_t rangeEnd) {
+                Stats local;
+                results[thread] = f(local, rangeBegin, rangeEnd);
+                threadStats[thread] = local;
+            });
+        for (unsigned thread = 0; thread < results.size(); ++thread) {
+            init = combine(init, results[thread]);
+            stats += threadStats[thread];
+        }
+        return init;
     }
 
 private:
-    std::vector<double> cache_;
-
+    std::unique_ptr<ThreadPool> pool_;
 };
 
 template <typename Dataset, typename Kernel>
@@ -80,28 +107,168 @@ double learnedFunction(
     return sum;
 }
 
+//! Cache of prediction errors. In sparse mode only errors of non-bound
+//! examples are updated after every step; errors of bound examples lag
+//! behind and are brought up to date on access, either by replaying missed
+//! updates or by evaluating learned function, whichever is cheaper. Updates
+//! are replayed only if fewer than half the number of support vectors were
+//! missed, so the log keeps at most the last N of them.
+template <typename Dataset, typename Kernel>
+class ErrorCache {
+public:
+    ErrorCache(
+            const Dataset& dataset,
+            const double C,
+            const std::vector<double>& alphas,
+            const double& threshold,
+            Kernel& K,
+            Workers& workers,
+            bool sparse)
+        : cache_(size(dataset))
+        , versions_(size(dataset), 0)
+        , numSupport_(0)
+        , dataset_(dataset)
+        , C_(C)
+        , alphas_(alphas)
+        , threshold_(threshold)
+        , K_(K)
+        , workers_(workers)
+        , sparse_(sparse) {}
+
+    //! Errors of non-bound examples are always up to date. Parallel scans
+    //! (see choosePair) read only those, so lagging errors are brought up
+    //! to date, storing kernel values in cached rows, by one thread only.
+    double operator() (unsigned i, Stats& stats) {
+        const uint64_t lag = numUpdates() - versions_[i];
+        if (lag == 0) {
+            stats.errorCacheHit();
+            return cache_[i];
+        }
+        stats.errorCacheMiss();
+        if (versions_[i] >= firstUpdate_ && 2 * lag < numSupport_) {
+            for (uint64_t u = versions_[i]; u < numUpdates(); ++u) {
+                const auto& update = updates_[u - firstUpdate_];
+                cache_[i] += update.dThreshold +
+                    update.dAlpha0 * K_(i, update.i0, stats) +
+                    update.dAlpha1 * K_(i, update.i1, stats);
+            }
+        } else {
+            auto K = [this, &stats](unsigned i, unsigned j) {
+                return K_(i, j, stats);
+            };
+            cache_[i] = learnedFunction(i, threshold_, dataset_, alphas_, K) -
+                label(i, dataset_);
+        }
+        versions_[i] = numUpdates();
+        return cache_[i];
+    }
+
+    void set(unsigned i, double value) {
+        cache_[i] = value;
+    }
+
+    //! Error of example i needs no kernel values on access
+    bool current(unsigned i) const {
+        return versions_[i] == numUpdates();
+    }
+
+    void update(
+            unsigned i0, double dAlpha0,
+            unsigned i1, double dAlpha1,
+            double dThreshold,
+            Stats& stats) {
+        stats.errorCacheUpdate();
+        if (sparse_) {
+            updates_.push_back({i0, i1, dAlpha0, dAlpha1, dThreshold});
+            if (updates_.size() > std::max<uint64_t>(cache_.size(), 1)) {
+                // Older half is never replayed, its lag exceeds N / 2
+                const uint64_t numDropped = updates_.size() / 2;
+                updates_.erase(updates_.begin(),
+                        updates_.begin() + numDropped);
+                firstUpdate_ += numDropped;
+            }
+        }
+        const auto row0 = K_.row(i0);
+        const auto row1 = K_.row(i1);
+        const uint64_t version = numUpdates();
+        numSupport_ = workers_.reduce(cache_.size(), stats, uint64_t(0),
+            [&](Stats& stats, uint64_t begin, uint64_t end) {
+                uint64_t numSupport = 0;
+                for (uint64_t i = begin; i < end; ++i) {
+                    numSupport += alphas_[i] > 0.0;
+                    if (!sparse_ || i == i0 || i == i1 ||
+                            nonBound(alphas_[i], C_)) {
+                        cache_[i] += dThreshold +
+                            dAlpha0 * row0(i, stats) + dAlpha1 * row1(i, stats);
+                        versions_[i] = version;
+                    }
+                }
+                return numSupport;
+            },
+            std::plus<uint64_t>());
+    }
+
+private:
+    struct Update {
+        unsigned i0;
+        unsigned i1;
+        double dAlpha0;
+        double dAlpha1;
+        double dThreshold;
+    };
+
+    //! Number of updates since the start, including dropped ones
+    uint64_t numUpdates() const {
+        return firstUpdate_ + updates_.size();
+    }
+
+    std::vector<double> cache_;
+    //! Number of updates applied to each error
+    std::vector<uint64_t> versions_;
+    //! Updates after the first firstUpdate_ ones
+    std::vector<Update> updates_;
+    uint64_t firstUpdate_ = 0;
+    uint64_t numSupport_;
+    const Dataset& dataset_;
+    const double C_;
+    const std::vector<double>& alphas_;
+    const double& threshold_;
+    Kernel& K_;
+    Workers& workers_;
+    const bool sparse_;
+
+};
+
+template <typename ErrorCache>
 unsigned choosePair(
         unsigned i0,
         const double error0,
         const double C,
         const std::vector<double>& alphas,
-        ErrorCache& errorCache) {
+        ErrorCache& errorCache,
+        Workers& workers,
+        Stats& stats) {
 
-    const unsigned N = alphas.size();
-    unsigned result = i0;
-    double dErrorMax = 0.0;
+    typedef std::pair<double, unsigned> Candidate;
     // trying to maximize |error0 - error1|
-    for (unsigned i = 0; i < N; ++i) {
-        if (!nonBound(alphas[i], C))
-            continue;
-
-        const double dError = std::abs(errorCache(i) - error0);
-        if (dError > dErrorMax) {
-            result = i;
-            dErrorMax = dError;
-        }
-    }
-    return result;
+    return workers.reduce(alphas.size(), stats, Candidate(0.0, i0),
+        [&](Stats& stats, uint64_t begin, uint64_t end) {
+            Candidate best(0.0, i0);
+            for (uint64_t i = begin; i < end; ++i) {
+                if (!nonBound(alphas[i], C))
+                    continue;
+
+                ASSERT(errorCache.current(i));
+                const double dError = std::abs(errorCache(i, stats) - error0);
+                if (dError > best.first) {
+                    best = Candidate(dError, i);
+                }
+            }
+            return best;
+        },
+        [](const Candidate& a, const Candidate& b) {
+            return b.first > a.first ? b : a;
+        }).second;
 }
 
 std::pair<double, double> computeBounds(
@@ -117,7 +284,7 @@ std::pair<double, double> computeBounds(
     }
 }
 
-template <typename Dataset, typename Kernel>
+template <typename Dataset, typename Kernel, typename ErrorCache>
 bool step(
         unsigned i0, unsigned i1,
         const double error0,
@@ -126,7 +293,8 @@ bool step(
         double& threshold,
         std::vector<double>& alphas,
         const Kernel& K,
-        ErrorCache& errorCache) {
+        ErrorCache& errorCache,
+        Stats& stats) {
     static const double EPS = 0.001;
     if (i0 == i1)
         return false;
@@ -141,7 +309,7 @@ bool step(
     if (L == H)
         return false;
 
-    const double error1 = errorCache(i1);
+    const double error1 = errorCache(i1, stats);
 
     const double k01 = K(i0, i1);
     const double k00 = K(i0, i0);
@@ -196,12 +364,12 @@ bool step(
 
     alphas[i0] = alpha0;
     alphas[i1] = alpha1;
-    errorCache.update(i0, dAlpha0, i1, dAlpha1, -dThreshold, K);
+    errorCache.update(i0, dAlpha0, i1, dAlpha1, -dThreshold, stats);
 
     return true;
 }
 
-template <typename Dataset, typename Kernel>
+template <typename Dataset, typename Kernel, typename ErrorCache>
 bool examine(
         const unsigned i0,
         const Dataset& dataset,
@@ -209,35 +377,44 @@ bool examine(
         double& threshold,
         std::vector<double>& alphas,
         const Kernel& K,
-        ErrorCache& errorCache) {
+        ErrorCache& errorCache,
+        Workers& workers,
+        Philox& gen,
+        Stats& stats) {
 
     const unsigned N = alphas.size();
     static const double TOLERANCE = 0.001;
     const double alpha0 = alphas[i0];
     const int label0 = label(i0, dataset);
-    const double error0 = errorCache(i0);
+    const double error0 = errorCache(i0, stats);
 
     if ((label0 * error0 < -TOLERANCE && alpha0 < C) ||
         (label0 * error0 > TOLERANCE && alpha0 > 0.0)) {
 
-        const unsigned i1 = choosePair(i0, error0, C, alphas, errorCache);
-        if (step(i0, i1, error0, dataset, C, threshold, alphas, K, errorCache)) {
+        auto tryStep = [&](unsigned i1) {
+            const bool changed = step(i0, i1, error0, dataset, C,
+                    threshold, alphas, K, errorCache, stats);
+            stats.step(changed);
+            return changed;
+        };
+
+        const unsigned i1 =
+            choosePair(i0, error0, C, alphas, errorCache, workers, stats);
+        if (tryStep(i1)) {
             return true;
         }
         // trying all non-bound alphas starting at random position
-        unsigned rnd = random(N);
+        const unsigned rnd = gen.below(N);
         for (unsigned j = 0; j < N; ++j) {
             unsigned i = (j + rnd) % N;
-            if (i != i1 && !nonBound(alphas[i], C) &&
-                    step(i0, i, error0, dataset, C, threshold, alphas, K, errorCache)) {
+            if (i != i1 && !nonBound(alphas[i], C) && tryStep(i)) {
                 return true;
             }
         }
         // trying all bound alphas
         for (unsigned j = 0; j < N; ++j) {
             unsigned i = (j + rnd) % N;
-            if (i != i1 && nonBound(alphas[i], C) &&
-                    step(i0, i, error0, dataset, C, threshold, alphas, K, errorCache)) {
+            if (i != i1 && nonBound(alphas[i], C) && tryStep(i)) {
                 return true;
             }
         }
@@ -247,27 +424,82 @@ bool examine(
 
 } // namespace
 
-//! Implementation of Sequential Minimal Optimization (SMO) algorithm
+//! Dual variables (alphas) and threshold of SVM
+typedef std::pair<std::vector<double>, double> Solution;
+
+//! Solution for regularization parameter oldC turned into a feasible
+//! starting point for newC. Alphas are scaled down if C decreases; if C
+//! grows the solution is feasible already and scaling it up would move it
+//! away from the optimum when most of alphas are below the bound.
+inline Solution rescale(Solution solution, double oldC, double newC) {
+    const double ratio = std::min(1.0, newC / oldC);
+    for (double& alpha: solution.first) {
+        alpha *= ratio;
+    }
+    solution.second *= ratio;
+    return solution;
+}
+
+namespace {
+
+//! SMO iterations starting from given alphas and threshold
 template <typename Dataset, typename Kernel>
-std::pair<std::vector<double>, double>
-solve(const Dataset& dataset, const double C, const Kernel& K) {
+Solution optimize(
+        const Dataset& dataset,
+        const double C,
+        Kernel& K,
+        Workers& workers,
+        const Params& params,
+        Stats& stats,
+        Solution initial) {
     const uint64_t N = size(dataset);
-    std::vector<double> alphas(N, 0.0);
-    double threshold = 0.0;
-
-    ErrorCache errorCache(size(dataset));
-    for (unsigned i = 0; i < size(dataset); ++i) {
-        errorCache.set(i, -label(i, dataset));
+    std::vector<double> alphas = std::move(initial.first);
+    double threshold = initial.second;
+    REQUIRE(alphas.size() == N, "Initial alphas don't match dataset size");
+    for (double& alpha: alphas) {
+        alpha = clip(alpha, 0.0, C);
     }
 
+    ErrorCache<Dataset, Kernel> errorCache(
+            dataset, C, alphas, threshold, K, workers,
+            params.sparseErrorCache);
+    const bool coldStart = std::none_of(alphas.begin(), alphas.end(),
+            [] (double alpha) { return alpha > 0.0; });
+    workers.reduce(N, stats, 0,
+        [&](Stats& stats, uint64_t begin, uint64_t end) {
+            if (coldStart) {
+                for (uint64_t i = begin; i < end; ++i) {
+                    errorCache.set(i, threshold - label(i, dataset));
+                }
+                return 0;
+            }
+            auto threadK = [&K, &stats](unsigned i, unsigned j) {
+                return K.lookup(i, j, stats);
+            };
+            for (uint64_t i = begin; i < end; ++i) {
+                errorCache.set(i, learnedFunction(
+                            i, threshold, dataset, alphas, threadK) -
+                        label(i, dataset));
+            }
+            return 0;
+        },
+        std::plus<int>());
+
+    Philox gen(params.seed);
     bool examineAll = true;
 
     while (true) {
+        stats.beginSweep();
         const unsigned numChanged = boost::count_if(
             boost::irange<unsigned>(0, N),
             [&] (unsigned i) {
                 return (examineAll || nonBound(alphas[i], C)) &&
-                    examine(i, dataset, C, threshold, alphas, K, errorCache);
+                    examine(i, dataset, C, threshold, alphas, K,
+                            errorCache, workers, gen, stats);
+            });
+        stats.endSweep([&alphas, C] {
+                return boost::count_if(alphas,
+                        [C] (double alpha) { return nonBound(alpha, C); });
             });
 
         if (examineAll) {
@@ -279,21 +511,103 @@ solve(const Dataset& dataset, const double C, const Kernel& K) {
             break;
     }
 
-    double b_minus = -1e7;
-    double b_plus = 1e7;
-    for (unsigned i = 0; i < alphas.size(); ++i) {
-        const double f = learnedFunction(i, 0.0, dataset, alphas, K);
-        if (label(i, dataset) == 1) {
-            b_plus = std::min(b_plus, f);
-        } else {
-            b_minus = std::max(b_minus, f);
-        }
-    }
-    threshold = - (b_minus + b_plus) / 2.0;
+    typedef std::pair<double, double> Bounds;
+    const Bounds bounds = workers.reduce(N, stats, Bounds(-1e7, 1e7),
+        [&](Stats& stats, uint64_t begin, uint64_t end) {
+            auto threadK = [&K, &stats](unsigned i, unsigned j) {
+                return K.lookup(i, j, stats);
+            };
+            double b_minus = -1e7;
+            double b_plus = 1e7;
+            for (uint64_t i = begin; i < end; ++i) {
+                const double f =
+                    learnedFunction(i, 0.0, dataset, alphas, threadK);
+                if (label(i, dataset) == 1) {
+                    b_plus = std::min(b_plus, f);
+                } else {
+                    b_minus = std::max(b_minus, f);
+                }
+            }
+            return Bounds(b_minus, b_plus);
+        },
+        [](const Bounds& a, const Bounds& b) {
+            return Bounds(std::max(a.first, b.first),
+                          std::min(a.second, b.second));
+        });
+    threshold = - (bounds.first + bounds.second) / 2.0;
     return {alphas, threshold};
 }
 
+} // namespace
+
+//! Implementation of Sequential Minimal Optimization (SMO) algorithm
+//! warm started from initial solution, e.g. one found for different C and
+//! rescaled with smo::rescale. Alphas outside [0, C] are clipped.
+//!
+//! Solver costs are accumulated in stats if ML_SMO_STATS is defined
+template <typename Dataset, typename Kernel>
+Solution
+solve(const Dataset& dataset, const double C, const Kernel& kernel,
+      const Params& params, Stats& stats, Solution initial) {
+    KernelCache<Kernel> K(kernel, size(dataset), params.kernelCacheBytes, stats);
+    Workers workers(size(dataset), params);
+    return optimize(
+            dataset, C, K, workers, params, stats, std::move(initial));
+}
+
+//! Implementation of Sequential Minimal Optimization (SMO) algorithm
+//!
+//! Solver costs are accumulated in stats if ML_SMO_STATS is defined
+template <typename Dataset, typename Kernel>
+Solution
+solve(const Dataset& dataset, const double C, const Kernel& kernel,
+      const Params& params, Stats& stats) {
+    return solve(dataset, C, kernel, params, stats,
+            Solution(std::vector<double>(size(dataset), 0.0), 0.0));
+}
+
+template <typename Dataset, typename Kernel>
+Solution
+solve(const Dataset& dataset, const double C, const Kernel& K,
+      Stats& stats) {
+    return solve(dataset, C, K, Params(), stats);
+}
+
+template <typename Dataset, typename Kernel>
+Solution
+solve(const Dataset& dataset, const double C, const Kernel& K) {
+    Stats stats;
+    return solve(dataset, C, K, Params(), stats);
+}
+
+//! Solves SVM for every regularization parameter value in order. Each run
+//! is warm started from rescaled solution of the previous one and reuses
+//! its kernel cache, so sweeping increasing values of C costs a fraction
+//! of independent runs.
+//!
+//! \param stats Costs of each run
+template <typename Dataset, typename Kernel>
+std::vector<Solution>
+solvePath(const Dataset& dataset, const std::vector<double>& Cs,
+          const Kernel& kernel, const Params& params,
+          std::vector<Stats>& stats) {
+    const uint64_t N = size(dataset);
+    stats.assign(Cs.size(), Stats());
+    std::vector<Solution> result;
+    result.reserve(Cs.size());
+    Stats cacheStats;
+    KernelCache<Kernel> K(kernel, N, params.kernelCacheBytes, cacheStats);
+    Workers workers(N, params);
+    for (unsigned i = 0; i < Cs.size(); ++i) {
+        K.attach(stats[i]);
+        result.push_back(optimize(dataset, Cs[i], K, workers, params,
+                    stats[i], i == 0 ?
+                    Solution(std::vector<double>(N, 0.0), 0.0) :
+                    rescale(result.back(), Cs[i - 1], Cs[i])));
+    }
+    return result;
+}
+
 } // namespace smo
 } // namespace svm
 } // namespace ml
-
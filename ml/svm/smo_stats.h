@@ -0,0 +1,128 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+
+namespace ml {
+namespace svm {
+namespace smo {
+
+#ifdef ML_SMO_STATS
+
+//! Cost counters of SMO solver. Collected only if ML_SMO_STATS is defined,
+//! otherwise Stats is an empty struct with no-op members.
+struct Stats {
+    typedef std::chrono::steady_clock Clock;
+
+    uint64_t kernelEvals = 0;
+    uint64_t errorCacheHits = 0;
+    uint64_t errorCacheMisses = 0;
+    uint64_t errorCacheUpdates = 0;
+    uint64_t kernelCacheHits = 0;
+    uint64_t successfulSteps = 0;
+    uint64_t failedSteps = 0;
+    uint64_t sweeps = 0;
+    //! Sum of active set (non-bound examples) sizes after every sweep, so
+    //! activeSetSizes / sweeps is the mean active set size, also of stats
+    //! aggregated over several solver runs
+    uint64_t activeSetSizes = 0;
+    uint64_t maxActiveSetSize = 0;
+    double sweepTime = 0.0;
+    double maxSweepTime = 0.0;
+    Clock::time_point sweepStart;
+
+    void kernelEval(uint64_t count = 1) { kernelEvals += count; }
+    void errorCacheHit() { ++errorCacheHits; }
+    void errorCacheMiss() { ++errorCacheMisses; }
+    void errorCacheUpdate() { ++errorCacheUpdates; }
+    void kernelCacheHit() { ++kernelCacheHits; }
+
+    void step(bool successful) {
+        ++(successful ? successfulSteps : failedSteps);
+    }
+
+    void beginSweep() {
+        sweepStart = Clock::now();
+    }
+
+    //! countNonBound is called only when statistics are collected
+    template <typename CountNonBound>
+    void endSweep(CountNonBound countNonBound) {
+        const std::chrono::duration<double> elapsed =
+            Clock::now() - sweepStart;
+        const uint64_t numNonBound = countNonBound();
+        ++sweeps;
+        sweepTime += elapsed.count();
+        maxSweepTime = std::max(maxSweepTime, elapsed.count());
+        activeSetSizes += numNonBound;
+        maxActiveSetSize = std::max(maxActiveSetSize, numNonBound);
+    }
+
+    //! Aggregates stats of another run: counters and times are summed,
+    //! maxima are kept
+    Stats& operator+= (const Stats& other) {
+        kernelEvals += other.kernelEvals;
+        errorCacheHits += other.errorCacheHits;
+        errorCacheMisses += other.errorCacheMisses;
+        errorCacheUpdates += other.errorCacheUpdates;
+        kernelCacheHits += other.kernelCacheHits;
+        successfulSteps += other.successfulSteps;
+        failedSteps += other.failedSteps;
+        sweeps += other.sweeps;
+        activeSetSizes += other.activeSetSizes;
+        maxActiveSetSize = std::max(maxActiveSetSize, other.maxActiveSetSize);
+        sweepTime += other.sweepTime;
+        maxSweepTime = std::max(maxSweepTime, other.maxSweepTime);
+        return *this;
+    }
+};
+
+inline std::ostream& operator<< (std::ostream& o, const Stats& stats) {
+    return o << "kernel evals: " << stats.kernelEvals
+             << ", error cache hits: " << stats.errorCacheHits
+             << ", error cache misses: " << stats.errorCacheMisses
+             << ", error cache updates: " << stats.errorCacheUpdates
+             << ", kernel cache hits: " << stats.kernelCacheHits
+             << ", steps: " << stats.successfulSteps
+             << " (failed: " << stats.failedSteps << ")"
+             << ", sweeps: " << stats.sweeps
+             << ", time per sweep: "
+             << (stats.sweeps ? stats.sweepTime / stats.sweeps : 0.0)
+             << " (max: " << stats.maxSweepTime << ")"
+             << ", mean active set: "
+             << (stats.sweeps ?
+                     static_cast<double>(stats.activeSetSizes) / stats.sweeps :
+                     0.0)
+             << " (max: " << stats.maxActiveSetSize << ")";
+}
+
+#else
+
+struct Stats {
+    void kernelEval(uint64_t = 1) {}
+    void errorCacheHit() {}
+    void errorCacheMiss() {}
+    void errorCacheUpdate() {}
+    void kernelCacheHit() {}
+    void step(bool) {}
+    void beginSweep() {}
+
+    template <typename CountNonBound>
+    void endSweep(CountNonBound) {}
+
+    Stats& operator+= (const Stats&) {
+        return *this;
+    }
+};
+
+inline std::ostream& operator<< (std::ostream& o, const Stats&) {
+    return o << "n/a (compiled without ML_SMO_STATS)";
+}
+
+#endif
+
+} // namespace smo
+} // namespace svm
+} // namespace ml
@@ -1,20 +1,49 @@
 #pragma once
 
 #include <ml/dataset/dataset.h>
+#include <ml/dataset/dataset_traits.h>
+#include <ml/dataset/serialization.h>
+#include <ml/kernels.h>
 #include <ml/sign.h>
+#include <ml/svm/linear.h>
+#include <ml/svm/shared_kernel_cache.h>
 #include <ml/svm/smo.h>
 
 #include <algorithm>
 #include <cmath>
+#include <istream>
+#include <limits>
+#include <numeric>
+#include <ostream>
+#include <type_traits>
 #include <vector>
 
+#include <Eigen/Dense>
+
 namespace ml {
 namespace svm {
 namespace c12n {
 
 namespace detail {
 
+//! Rows of examples of dataset as a dense matrix
+template <typename Dataset>
+Eigen::MatrixXd exampleMatrix(const Dataset& dataset) {
+    if (size(dataset) == 0) {
+        return Eigen::MatrixXd();
+    }
+    Eigen::MatrixXd result(size(dataset), example(0, dataset).size());
+    for (uint64_t i = 0; i < size(dataset); ++i) {
+        result.row(i) = example(i, dataset);
+    }
+    return result;
+}
+
 template <typename KernelFn, typename Dataset>
+using HasDenseBlock = std::integral_constant<bool,
+      IsDense<example_t<Dataset>>::value && HasBlock<KernelFn>::value>;
+
+template <typename KernelFn, typename Dataset, typename = void>
 class WrappedKernel {
 public:
     WrappedKernel(WrappedKernel&&) = default;
@@ -32,13 +61,66 @@ private:
 
 };
 
+//! Dense examples are copied into a matrix, so that kernel rows cached by
+//! SMO are computed by a single matrix-vector product. The copy is made by
+//! the first row() call, so solver runs without kernel cache never make it.
+//! Rows are filled by KernelCache::row only, which solvers never call from
+//! parallel scans.
+template <typename KernelFn, typename Dataset>
+class WrappedKernel<KernelFn, Dataset,
+      std::enable_if_t<HasDenseBlock<KernelFn, Dataset>::value>> {
+public:
+    WrappedKernel(WrappedKernel&&) = default;
+
+    WrappedKernel(KernelFn kernelFn, const Dataset& dataset)
+        : kernelFn_(kernelFn)
+        , dataset_(dataset) {}
+
+    double operator()(unsigned i, unsigned j) const {
+        return kernelFn_(example(i, dataset_), example(j, dataset_));
+    }
+
+    //! Fills values with kernel matrix row i
+    void row(unsigned i, double* values) const {
+        if (examples_.rows() != static_cast<Eigen::Index>(size(dataset_))) {
+            examples_ = exampleMatrix(dataset_);
+            norms_ = examples_.rowwise().squaredNorm();
+        }
+        Eigen::Map<Eigen::RowVectorXd>(values, examples_.rows()) =
+            kernelFn_.block(examples_.row(i), examples_,
+                    norms_.segment(i, 1), norms_);
+    }
+
+private:
+    KernelFn kernelFn_;
+    const Dataset& dataset_;
+    mutable Eigen::MatrixXd examples_;
+    mutable Eigen::VectorXd norms_;
+
+};
+
 template <typename KernelFn, typename Dataset>
 WrappedKernel<KernelFn, Dataset>
 wrapKernel(KernelFn kernelFn, const Dataset& dataset) {
     return WrappedKernel<KernelFn, Dataset>(kernelFn, dataset);
 }
 
-//! Binary SVM classifier
+//! Dense examples of dataset as a matrix, nothing for other examples
+template <typename Dataset>
+Eigen::MatrixXd denseExamples(const Dataset& dataset, std::true_type) {
+    return exampleMatrix(dataset);
+}
+
+template <typename Dataset>
+Eigen::MatrixXd denseExamples(const Dataset&, std::false_type) {
+    return Eigen::MatrixXd();
+}
+
+//! Binary SVM classifier. Summation over support vectors stops as soon as
+//! the remaining ones can't flip the sign of the decision value, which
+//! happens early when support vectors are ordered by decreasing |alpha|
+//! and the kernel is bounded (see kernelBound). Dense support vectors are
+//! also kept as a matrix with their squared norms for decisions().
 template <typename Dataset, typename Kernel>
 class SVMClassifier {
 public:
@@ -47,67 +129,398 @@ public:
             Dataset dataset,
             std::vector<double> alphas,
             double threshold,
-            Kernel kernel)
+            Kernel kernel,
+            smo::Stats stats = smo::Stats())
         : dataset_(std::move(dataset))
         , alphas_(std::move(alphas))
         , threshold_(threshold)
-        , kernel_(kernel) {}
+        , kernel_(kernel)
+        , stats_(stats)
+        , remainingMass_(alphas_.size() + 1, 0.0)
+        , supportVectorMatrix_(detail::denseExamples(
+                    dataset_, IsDense<example_t<Dataset>>()))
+        , supportVectorNorms_(
+                supportVectorMatrix_.rowwise().squaredNorm()) {
+        for (uint64_t i = alphas_.size(); i > 0; --i) {
+            remainingMass_[i - 1] =
+                remainingMass_[i] + std::abs(alphas_[i - 1]);
+        }
+    }
 
     SVMClassifier& operator= (SVMClassifier&&) = default;
 
     template <typename RowVector>
     int operator() (const RowVector& row) const {
+        const double bound = kernelBound(kernel_, row);
         double sum = threshold_;
         for (uint64_t i = 0; i < alphas_.size(); ++i) {
+            if (std::abs(sum) > bound * remainingMass_[i]) {
+                break;
+            }
             sum += alphas_[i] * kernel_(row, example(i, dataset_));
         }
         return sign(sum);
     }
 
+    //! Decision values of dense examples given by rows, computed as a
+    //! kernel block with support vectors (a single GEMM for kernels with
+    //! block member) times alphas
+    template <typename Derived>
+    Eigen::VectorXd decisions(const Eigen::MatrixBase<Derived>& rows) const {
+        if (alphas_.empty()) {
+            return Eigen::VectorXd::Constant(rows.rows(), threshold_);
+        }
+        const Eigen::Map<const Eigen::VectorXd> alphas(
+                alphas_.data(), alphas_.size());
+        return (kernelBlock(kernel_, rows, supportVectorMatrix_,
+                    supportVectorNorms_) * alphas).array() + threshold_;
+    }
+
+    //! Labels of dense examples given by rows
+    template <typename Derived>
+    Eigen::VectorXi classify(const Eigen::MatrixBase<Derived>& rows) const {
+        return decisions(rows).unaryExpr([](double d) { return sign(d); });
+    }
+
+    //! Costs of the solver run which produced this classifier
+    const smo::Stats& stats() const {
+        return stats_;
+    }
+
+    //! Support vectors ordered by decreasing |alpha|
+    const Dataset& supportVectors() const {
+        return dataset_;
+    }
+
+    //! Coefficients (alpha times label) of support vectors
+    const std::vector<double>& alphas() const {
+        return alphas_;
+    }
+
+    double threshold() const {
+        return threshold_;
+    }
+
+    const Kernel& kernel() const {
+        return kernel_;
+    }
+
+    //! Writes classifier in a binary format readable by load() on machines
+    //! of the same endianness. Kernel is written as bytes, so it has to be
+    //! trivially copyable. Solver stats are not written.
+    void save(std::ostream& o) const {
+        writeDataset(o, dataset_);
+        const uint64_t N = alphas_.size();
+        writeValue(o, N);
+        for (double alpha: alphas_) {
+            writeValue(o, alpha);
+        }
+        writeValue(o, threshold_);
+        writeValue(o, kernel_);
+    }
+
+    //! Reads classifier written by save(), callers should check the stream
+    //! state afterwards. Stream fails if there isn't an alpha for every
+    //! support vector.
+    static SVMClassifier load(std::istream& in) {
+        Dataset dataset = readDataset<Dataset>(in);
+        const uint64_t N = readValue<uint64_t>(in);
+        if (N != size(dataset)) {
+            in.setstate(std::ios::failbit);
+        }
+        std::vector<double> alphas(in ? N : 0);
+        for (double& alpha: alphas) {
+            alpha = readValue<double>(in);
+        }
+        const double threshold = readValue<double>(in);
+        return SVMClassifier(std::move(dataset), std::move(alphas),
+                threshold, readValue<Kernel>(in));
+    }
+
 private:
     Dataset dataset_;
     std::vector<double> alphas_;
     double threshold_;
     Kernel kernel_;
+    smo::Stats stats_;
+    //! Sums of |alpha| of support vectors starting from each position
+    std::vector<double> remainingMass_;
+    Eigen::MatrixXd supportVectorMatrix_;
+    Eigen::VectorXd supportVectorNorms_;
 
 };
 
+//! Dataset of examples at given positions of dataset
+template <typename Dataset>
+storage_t<Dataset> subset(
+        const Dataset& dataset, const std::vector<uint64_t>& positions) {
+    storage_t<Dataset> result(positions.size());
+    for (uint64_t i = 0; i < positions.size(); ++i) {
+        const uint64_t position = positions[i];
+        set(i, example(position, dataset), label(position, dataset), result);
+    }
+    return result;
+}
+
+//! Kernel values of the first numRows examples of dataset with every one
+template <typename Kernel, typename Dataset>
+Eigen::MatrixXd kernelRows(const Kernel& kernel, const Dataset& dataset,
+        uint64_t numRows, std::true_type /* dense */) {
+    const Eigen::MatrixXd examples = exampleMatrix(dataset);
+    return kernelBlock(kernel, examples.topRows(numRows), examples);
+}
+
+template <typename Kernel, typename Dataset>
+Eigen::MatrixXd kernelRows(const Kernel& kernel, const Dataset& dataset,
+        uint64_t numRows, std::false_type /* dense */) {
+    Eigen::MatrixXd result(numRows, size(dataset));
+    for (uint64_t i = 0; i < numRows; ++i) {
+        for (uint64_t j = 0; j < size(dataset); ++j) {
+            result(i, j) = j < i && j < numRows ? result(j, i) :
+                kernel(example(i, dataset), example(j, dataset));
+        }
+    }
+    return result;
+}
+
 } // namespace detail
 
-//! Train soft margin SVM binary classifier
+//! Reduced-set compression of a trained classifier to at most budget
+//! support vectors, bounding the number of kernel evaluations per
+//! classification. Support vectors whose removal increases the error of
+//! approximation of the weight vector least are dropped in rounds; after
+//! every round coefficients of the kept ones are recomputed by projecting
+//! the original weight vector onto their span in feature space, i.e. by
+//! solving the kernel system of the kept ones with LDLT. Threshold is
+//! kept, since decision values on support vectors themselves are biased by
+//! their own dropped terms. Only 4 * budget support vectors with the
+//! largest |alpha| are candidates, so the cost is O(budget * N) kernel
+//! evaluations.
 //!
-//! \param trainingSet Labelled training dataset
-//! \param C Regularization parameter
-//! \param kernel Kernel function
-//! \return Binary classifier
+//! \param classifier Trained classifier
+//! \param budget Maximum number of support vectors, 0 keeps all of them
+//! \return Classifier with at most budget support vectors
 template <typename Dataset, typename Kernel>
-detail::SVMClassifier<Dataset, Kernel>
-train(const Dataset& trainingSet, const double C, Kernel kernel) {
-    std::vector<double> alphas;
-    double threshold;
-    std::tie(alphas, threshold) =
-        smo::solve(trainingSet, C, detail::wrapKernel(kernel, trainingSet));
+detail::SVMClassifier<Dataset, Kernel> reduce(
+        detail::SVMClassifier<Dataset, Kernel> classifier, uint64_t budget) {
+    const Dataset& supportVectors = classifier.supportVectors();
+    const uint64_t N = size(supportVectors);
+    if (budget == 0 || N <= budget) {
+        return classifier;
+    }
+    const uint64_t numCandidates = std::min(N, 4 * budget);
+    const Eigen::MatrixXd K = detail::kernelRows(classifier.kernel(),
+            supportVectors, numCandidates, IsDense<example_t<Dataset>>());
+    const Eigen::Map<const Eigen::VectorXd> alphas(
+            classifier.alphas().data(), N);
+    // Projections of the original weight vector onto candidates
+    const Eigen::VectorXd decisions = K * alphas;
+    const double ridge = 1e-10 * K.leftCols(numCandidates).trace();
 
-    std::vector<double> nonzeroAlphas;
+    std::vector<uint64_t> kept(numCandidates);
+    std::iota(kept.begin(), kept.end(), 0);
+    Eigen::VectorXd betas;
+    while (true) {
+        const uint64_t n = kept.size();
+        Eigen::MatrixXd keptKernel(n, n);
+        Eigen::VectorXd projection(n);
+        for (uint64_t i = 0; i < n; ++i) {
+            for (uint64_t j = 0; j < n; ++j) {
+                keptKernel(i, j) = K(kept[i], kept[j]);
+            }
+            keptKernel(i, i) += ridge;
+            projection(i) = decisions(kept[i]);
+        }
+        const auto ldlt = keptKernel.ldlt();
+        betas = ldlt.solve(projection);
+        if (n <= budget) {
+            break;
+        }
+        // Up to a quarter of the kept ones are dropped one by one per
+        // round. Dropping j increases the squared approximation error by
+        // beta_j^2 / (K^-1)_jj, after which betas and K^-1 of the rest are
+        // updated in O(n^2). Near duplicates of kept ones are cheap to drop
+        // even if their coefficients are large, and the last of them is not.
+        const uint64_t numDropped =
+            std::min(n - budget, std::max<uint64_t>(1, n / 4));
+        Eigen::MatrixXd inverse = ldlt.solve(Eigen::MatrixXd::Identity(n, n));
+        Eigen::VectorXd remaining = betas;
+        std::vector<bool> dropped(n, false);
+        for (uint64_t d = 0; d < numDropped; ++d) {
+            uint64_t cheapest = n;
+            double minCost = std::numeric_limits<double>::infinity();
+            for (uint64_t i = 0; i < n; ++i) {
+                const double cost =
+                    remaining(i) * remaining(i) / inverse(i, i);
+                if (!dropped[i] && cost < minCost) {
+                    cheapest = i;
+                    minCost = cost;
+                }
+            }
+            dropped[cheapest] = true;
+            const Eigen::VectorXd column = inverse.col(cheapest);
+            remaining -= column * (remaining(cheapest) / column(cheapest));
+            inverse -= column * column.transpose() / column(cheapest);
+        }
+        uint64_t numKept = 0;
+        for (uint64_t i = 0; i < n; ++i) {
+            if (!dropped[i]) {
+                kept[numKept++] = kept[i];
+            }
+        }
+        kept.resize(numKept);
+    }
+
+    // Keep decreasing |coefficient| order expected by SVMClassifier
+    std::vector<uint64_t> order(kept.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](uint64_t a, uint64_t b) {
+        return std::abs(betas(a)) > std::abs(betas(b));
+    });
+    std::vector<uint64_t> positions;
+    std::vector<double> coefficients;
+    for (uint64_t i: order) {
+        positions.push_back(kept[i]);
+        coefficients.push_back(betas(i));
+    }
+    return detail::SVMClassifier<Dataset, Kernel>(
+            detail::subset(supportVectors, positions),
+            std::move(coefficients),
+            classifier.threshold(),
+            classifier.kernel(),
+            classifier.stats());
+}
+
+namespace detail {
+
+//! Classifier keeping examples of trainingSet with nonzero alphas, ordered
+//! by decreasing alpha, reduced to at most maxSupportVectors of them
+//! unless it's 0
+template <typename Dataset, typename Kernel>
+SVMClassifier<storage_t<Dataset>, Kernel> makeClassifier(
+        const Dataset& trainingSet,
+        const std::vector<double>& alphas,
+        double threshold,
+        Kernel kernel,
+        const smo::Stats& stats,
+        uint64_t maxSupportVectors = 0) {
     std::vector<uint64_t> nonzeroPositions;
     for (uint64_t i = 0; i < alphas.size(); ++i) {
         if (alphas[i] > 0.0) {
             nonzeroPositions.push_back(i);
-            nonzeroAlphas.push_back(alphas[i] * label(i, trainingSet));
         }
     }
+    std::stable_sort(nonzeroPositions.begin(), nonzeroPositions.end(),
+            [&](uint64_t a, uint64_t b) { return alphas[a] > alphas[b]; });
+    std::vector<double> nonzeroAlphas;
+    nonzeroAlphas.reserve(nonzeroPositions.size());
+    for (uint64_t i: nonzeroPositions) {
+        nonzeroAlphas.push_back(alphas[i] * label(i, trainingSet));
+    }
+
+    return reduce(SVMClassifier<storage_t<Dataset>, Kernel>(
+                subset(trainingSet, nonzeroPositions),
+                std::move(nonzeroAlphas),
+                threshold,
+                kernel,
+                stats),
+            maxSupportVectors);
+}
+
+} // namespace detail
+
+//! Train soft margin SVM binary classifier warm started from a solution of
+//! the same training set, e.g. one found for different C and rescaled with
+//! smo::rescale
+//!
+//! \param trainingSet Labelled training dataset
+//! \param C Regularization parameter
+//! \param kernel Kernel function
+//! \param params SMO solver options
+//! \param initial Alphas and threshold SMO starts from
+//! \return Binary classifier
+template <typename Dataset, typename Kernel>
+detail::SVMClassifier<storage_t<Dataset>, Kernel>
+train(const Dataset& trainingSet, const double C, Kernel kernel,
+      const smo::Params& params, smo::Solution initial) {
+    std::vector<double> alphas;
+    double threshold;
+    smo::Stats stats;
+    std::tie(alphas, threshold) = smo::solve(
+            trainingSet, C, detail::wrapKernel(kernel, trainingSet),
+            params, stats, std::move(initial));
+    return detail::makeClassifier(trainingSet, alphas, threshold, kernel,
+            stats, params.maxSupportVectors);
+}
+
+//! Train soft margin SVM binary classifier
+//!
+//! \param trainingSet Labelled training dataset
+//! \param C Regularization parameter
+//! \param kernel Kernel function
+//! \param params SMO solver options
+//! \return Binary classifier
+template <typename Dataset, typename Kernel>
+detail::SVMClassifier<storage_t<Dataset>, Kernel>
+train(const Dataset& trainingSet, const double C, Kernel kernel,
+      const smo::Params& params = smo::Params()) {
+    return train(trainingSet, C, kernel, params, smo::Solution(
+                std::vector<double>(size(trainingSet), 0.0), 0.0));
+}
 
-    Dataset supportSubset(nonzeroPositions.size());
-    for (uint64_t i = 0; i < nonzeroPositions.size(); ++i) {
-        uint64_t position = nonzeroPositions[i];
-        set(i, example(position, trainingSet),
-                label(position, trainingSet), supportSubset);
+//! Train soft margin SVM binary classifier of a subproblem of a larger
+//! training set, sharing kernel values with other subproblems through cache
+//!
+//! \param trainingSet Labelled training dataset
+//! \param C Regularization parameter
+//! \param kernel Kernel function
+//! \param params SMO solver options
+//! \param cache Kernel values keyed by indices of the larger training set
+//! \param keys Index in the larger training set of each example
+//! \return Binary classifier
+template <typename Dataset, typename Kernel>
+detail::SVMClassifier<storage_t<Dataset>, Kernel>
+train(const Dataset& trainingSet, const double C, Kernel kernel,
+      const smo::Params& params,
+      smo::SharedKernelCache& cache,
+      const std::vector<unsigned>& keys) {
+    std::vector<double> alphas;
+    double threshold;
+    smo::Stats stats;
+    std::tie(alphas, threshold) = smo::solve(
+            trainingSet, C,
+            smo::SharedCachedKernel<
+                detail::WrappedKernel<Kernel, Dataset>>(
+                    detail::wrapKernel(kernel, trainingSet), cache, keys),
+            params, stats);
+    return detail::makeClassifier(trainingSet, alphas, threshold, kernel,
+            stats, params.maxSupportVectors);
+}
+
+//! Train soft margin SVM binary classifiers for a sequence of
+//! regularization parameter values. Each run is warm started from the
+//! previous one, so values should be given in increasing order.
+//!
+//! \param trainingSet Labelled training dataset
+//! \param Cs Regularization parameter values
+//! \param kernel Kernel function
+//! \param params SMO solver options
+//! \return Binary classifier for each value of C
+template <typename Dataset, typename Kernel>
+std::vector<detail::SVMClassifier<storage_t<Dataset>, Kernel>>
+trainPath(const Dataset& trainingSet, const std::vector<double>& Cs,
+          Kernel kernel, const smo::Params& params = smo::Params()) {
+    std::vector<smo::Stats> stats;
+    const auto solutions = smo::solvePath(trainingSet, Cs,
+            detail::wrapKernel(kernel, trainingSet), params, stats);
+    std::vector<detail::SVMClassifier<storage_t<Dataset>, Kernel>> result;
+    result.reserve(solutions.size());
+    for (unsigned i = 0; i < solutions.size(); ++i) {
+        result.push_back(detail::makeClassifier(trainingSet,
+                    solutions[i].first, solutions[i].second, kernel,
+                    stats[i], params.maxSupportVectors));
     }
-    return detail::SVMClassifier<Dataset, Kernel>(
-            std::move(supportSubset),
-            std::move(nonzeroAlphas),
-            threshold,
-            kernel);
+    return result;
 }
 
 } // namespace c12n
@@ -0,0 +1,154 @@
+#pragma once
+
+#include <ml/dataset/index_view.h>
+#include <ml/exception.h>
+#include <ml/parallel.h>
+#include <ml/random.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <numeric>
+#include <utility>
+#include <vector>
+
+namespace ml {
+namespace validation {
+
+//! Training and test parts of a dataset
+template <typename Dataset>
+struct Fold {
+    IndexView<Dataset> training;
+    IndexView<Dataset> test;
+};
+
+//! Splits shuffled dataset into numFolds nearly equal test parts, each one
+//! paired with the rest of the dataset as training part. Folds are views,
+//! examples are not copied.
+template <typename Dataset>
+std::vector<Fold<Dataset>> kFolds(
+        const Dataset& dataset, unsigned numFolds, unsigned seed = 0) {
+    const uint64_t N = size(dataset);
+    REQUIRE(numFolds >= 2 && numFolds <= N,
+            "Can't split " << N << " examples into " << numFolds << " folds");
+    std::vector<uint64_t> shuffled(N);
+    std::iota(shuffled.begin(), shuffled.end(), 0);
+    Philox gen(seed);
+    std::shuffle(shuffled.begin(), shuffled.end(), gen);
+
+    std::vector<Fold<Dataset>> result;
+    result.reserve(numFolds);
+    for (unsigned fold = 0; fold < numFolds; ++fold) {
+        const uint64_t begin = N * fold / numFolds;
+        const uint64_t end = N * (fold + 1) / numFolds;
+        std::vector<uint64_t> test(
+                shuffled.begin() + begin, shuffled.begin() + end);
+        std::vector<uint64_t> training(shuffled.begin(), shuffled.begin() + begin);
+        training.insert(training.end(), shuffled.begin() + end, shuffled.end());
+        std::sort(test.begin(), test.end());
+        std::sort(training.begin(), training.end());
+        result.push_back({IndexView<Dataset>(dataset, std::move(training)),
+                          IndexView<Dataset>(dataset, std::move(test))});
+    }
+    return result;
+}
+
+//! Grid search options
+struct Params {
+    unsigned numFolds = 5;
+    //! Threads running (fold, configuration) jobs concurrently
+    unsigned numThreads = defaultNumThreads();
+    //! Seed of dataset shuffling before splitting into folds
+    unsigned seed = 0;
+};
+
+//! Cross-validation result of a configuration
+template <typename Config>
+struct Result {
+    Config config;
+    //! Mean accuracy over folds
+    double accuracy;
+    std::vector<double> foldAccuracies;
+    //! Training and test time summed over folds, in seconds
+    double trainSeconds;
+    double testSeconds;
+};
+
+namespace detail {
+
+typedef std::chrono::steady_clock Clock;
+
+inline double seconds(Clock::time_point start, Clock::time_point end) {
+    return std::chrono::duration<double>(end - start).count();
+}
+
+} // namespace detail
+
+//! k-fold cross-validation of every configuration. Each (fold,
+//! configuration) pair is an independent job run on a work-stealing pool,
+//! so a few expensive configurations don't leave threads idle.
+//!
+//! \param dataset Labelled dataset
+//! \param configs Configurations, e.g. tuples of hyperparameter values
+//! \param train Callable train(trainingFold, config) returning a classifier
+//!        (e.g. wrapping dag::train or max_wins::train), trainingFold is an
+//!        IndexView<Dataset>
+//! \param params Grid search options
+//! \return Results in order of configs
+template <typename Dataset, typename Config, typename Train>
+std::vector<Result<Config>> gridSearch(
+        const Dataset& dataset,
+        const std::vector<Config>& configs,
+        Train train,
+        const Params& params = Params()) {
+    const auto folds = kFolds(dataset, params.numFolds, params.seed);
+    const uint64_t numJobs = folds.size() * configs.size();
+    std::vector<double> accuracies(numJobs);
+    std::vector<double> trainSeconds(numJobs);
+    std::vector<double> testSeconds(numJobs);
+    parallelJobs(numJobs, params.numThreads, [&](uint64_t job) {
+        const auto& fold = folds[job % folds.size()];
+        const auto& config = configs[job / folds.size()];
+        const auto trainStart = detail::Clock::now();
+        const auto classifier = train(fold.training, config);
+        const auto testStart = detail::Clock::now();
+        uint64_t correct = 0;
+        for (uint64_t i = 0; i < size(fold.test); ++i) {
+            correct += classifier(example(i, fold.test)) == label(i, fold.test);
+        }
+        const auto testEnd = detail::Clock::now();
+        accuracies[job] = static_cast<double>(correct) / size(fold.test);
+        trainSeconds[job] = detail::seconds(trainStart, testStart);
+        testSeconds[job] = detail::seconds(testStart, testEnd);
+    });
+
+    std::vector<Result<Config>> result;
+    result.reserve(configs.size());
+    for (uint64_t c = 0; c < configs.size(); ++c) {
+        const uint64_t begin = c * folds.size();
+        const uint64_t end = begin + folds.size();
+        result.push_back({configs[c],
+            std::accumulate(accuracies.begin() + begin,
+                            accuracies.begin() + end, 0.0) / folds.size(),
+            std::vector<double>(accuracies.begin() + begin,
+                                accuracies.begin() + end),
+            std::accumulate(trainSeconds.begin() + begin,
+                            trainSeconds.begin() + end, 0.0),
+            std::accumulate(testSeconds.begin() + begin,
+                            testSeconds.begin() + end, 0.0)});
+    }
+    return result;
+}
+
+//! Result with the highest mean accuracy
+template <typename Config>
+const Result<Config>& best(const std::vector<Result<Config>>& results) {
+    REQUIRE(!results.empty(), "No results to choose from");
+    return *std::max_element(results.begin(), results.end(),
+            [](const Result<Config>& a, const Result<Config>& b) {
+                return a.accuracy < b.accuracy;
+            });
+}
+
+} // namespace validation
+} // namespace ml
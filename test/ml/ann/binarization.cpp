@@ -0,0 +1,109 @@
+#include <meta/logic.h>
+#include <meta/params.h>
+#include <meta/tuple.h>
+#include <ml/ann.h>
+#include <ml/ann/binarization.h>
+#include <ml/ann/stop_criterion.h>
+#include <ml/bit_vec.h>
+
+#include <cstdint>
+#include <random>
+#include <tuple>
+
+#include <Eigen/Dense>
+
+#define BOOST_TEST_MODULE ml_ann_binarization
+#include <boost/test/included/unit_test.hpp>
+
+namespace {
+
+struct Dataset {
+    Eigen::MatrixXd examples;
+    Eigen::MatrixXd labels;
+};
+
+uint64_t size(const Dataset& ds) {
+    return ds.examples.cols();
+}
+
+//! Noisy copies of +-1 prototypes labelled by the prototypes
+Dataset patterns(
+        const Eigen::MatrixXd& prototypes, unsigned N, std::mt19937& gen) {
+    std::bernoulli_distribution flip(0.05);
+    const unsigned dim = prototypes.rows();
+    Dataset result{Eigen::MatrixXd(dim, N), Eigen::MatrixXd(dim, N)};
+    for (unsigned col = 0; col < N; ++col) {
+        result.labels.col(col) = prototypes.col(col % 4);
+        for (unsigned row = 0; row < dim; ++row) {
+            result.examples(row, col) =
+                flip(gen) ? -prototypes(row, col % 4) : prototypes(row, col % 4);
+        }
+    }
+    return result;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE ( xnor_matches_forward_pass ) {
+    typedef ml::ann::NetworkConf<
+        ml::ann::Input<70>,
+        ml::ann::BinaryFullyConnected<33>,
+        ml::ann::BinaryFullyConnected<10>> NetConf;
+    NetConf::Connections connections;
+    meta::tup_each([](auto& conn) { conn.init(); }, connections);
+    const ml::ann::ANNClassifier<NetConf> classifier(connections);
+    const auto xnor = ml::ann::binarize(classifier);
+
+    const Eigen::MatrixXd inputs = Eigen::MatrixXd::Random(70, 20);
+    const Eigen::MatrixXd expected = classifier(inputs);
+    const Eigen::MatrixXd outputs = xnor(inputs);
+    BOOST_REQUIRE_EQUAL(outputs.rows(), 10);
+    BOOST_REQUIRE_EQUAL(outputs.cols(), 20);
+    BOOST_CHECK_SMALL((outputs - expected).cwiseAbs().maxCoeff(), 1e-9);
+
+    ml::BitVec<70> bits;
+    for (unsigned pos = 0; pos < 70; ++pos) {
+        if (inputs(pos, 3) >= 0.0) {
+            bits.set(pos);
+        }
+    }
+    BOOST_CHECK_SMALL((xnor(bits) - expected.col(3)).cwiseAbs().maxCoeff(),
+                      1e-9);
+    BOOST_CHECK_LT(xnor.bytes() * 16, 8 * (70 * 33 + 33 * 10));
+}
+
+BOOST_AUTO_TEST_CASE ( straight_through_training ) {
+    typedef ml::ann::NetworkConf<
+        ml::ann::Input<64>,
+        ml::ann::BinaryFullyConnected<64>,
+        ml::ann::BinaryFullyConnected<64>> NetConf;
+    std::mt19937 gen(0);
+    std::bernoulli_distribution coin(0.5);
+    Eigen::MatrixXd prototypes(64, 4);
+    for (unsigned i = 0; i < prototypes.size(); ++i) {
+        prototypes(i) = coin(gen) ? 1.0 : -1.0;
+    }
+    const auto trainingSet = patterns(prototypes, 512, gen);
+    const auto validationSet = patterns(prototypes, 128, gen);
+
+    NetConf::Connections initial;
+    meta::tup_each([](auto& conn) { conn.init(); }, initial);
+    const double initialLoss = NetConf::lossFn(
+            ml::ann::ANNClassifier<NetConf>(initial)(validationSet.examples),
+            validationSet.labels);
+
+    ml::ann::EarlyStopping<Dataset, NetConf> earlyStopping(validationSet, 1);
+    ml::ann::EpochsNumber epochsNumber(20);
+    auto optimizationParams = std::make_tuple(
+            meta::param<ml::batchSizeP>(16),
+            meta::param<ml::regularizationP>(ml::ann::L2Regularization(0.0)),
+            meta::param<ml::stopCriterionP>(
+                meta::any(earlyStopping.ref(), epochsNumber)),
+            meta::param<ml::optimizationMonitorP>(earlyStopping.ref()));
+    const auto classifier =
+        ml::ann::train(trainingSet, optimizationParams, NetConf{});
+    const double loss = NetConf::lossFn(
+            ml::ann::binarize(classifier)(validationSet.examples),
+            validationSet.labels);
+    BOOST_CHECK_LT(loss, 0.1 * initialLoss);
+}
@@ -98,3 +98,45 @@ BOOST_AUTO_TEST_CASE ( full_feed_fwd ) {
     BOOST_CHECK_CLOSE(act2(4), shouldBe2(4), tolerance);
 }
 
+
+BOOST_AUTO_TEST_CASE ( fixed_feed_fwd ) {
+    typedef ml::ann::NetworkConf<
+        ml::ann::Input<4>,
+        ml::ann::FullyConnected<3>,
+        ml::ann::FullyConnected<2, ml::ann::Linear>> NetConf;
+    static_assert(ml::ann::detail::FitsFixedSize<NetConf::Layers, 2>::value,
+            "Small network should use fixed-size path");
+    static_assert(!ml::ann::detail::FitsFixedSize<
+                NetConf::Layers, Eigen::Dynamic>::value,
+            "Dynamic batches should use dynamic path");
+    typedef ml::ann::NetworkConf<
+        ml::ann::Input<784>,
+        ml::ann::FullyConnected<200>,
+        ml::ann::FullyConnected<10>> WideNetConf;
+    static_assert(!ml::ann::detail::FitsFixedSize<
+                WideNetConf::Layers, 1>::value,
+            "Networks with dynamic weights should use dynamic path");
+    NetConf::Connections connections;
+    meta::tup_each([](auto& conn) { conn.init(); }, connections);
+
+    Eigen::Matrix<double, 4, 2> input;
+    input << 1, -1,
+             0.5, 2,
+             -3, 0,
+             0.25, 1;
+    Eigen::Matrix<double, 2, 2> fixed = ml::ann::detail::feedForwardFixed(
+            input, connections, NetConf::Layers{});
+    Eigen::MatrixXd dynamic = ml::ann::detail::feedForward(
+            Eigen::MatrixXd(input), connections, NetConf::Layers{});
+    ml::ann::ANNClassifier<NetConf> classifier(connections);
+    auto classified = classifier(input);
+
+    const double tolerance = 1e-7;
+    for (unsigned row = 0; row < 2; ++row) {
+        for (unsigned col = 0; col < 2; ++col) {
+            BOOST_CHECK_CLOSE(fixed(row, col), dynamic(row, col), tolerance);
+            BOOST_CHECK_CLOSE(
+                    classified(row, col), dynamic(row, col), tolerance);
+        }
+    }
+}
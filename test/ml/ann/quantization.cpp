@@ -0,0 +1,71 @@
+#include <meta/tuple.h>
+#include <ml/ann.h>
+#include <ml/ann/quantization.h>
+
+#include <Eigen/Dense>
+
+#define BOOST_TEST_MODULE ml_ann_quantization
+#include <boost/test/included/unit_test.hpp>
+
+struct Dataset {
+    Eigen::MatrixXd examples;
+    Eigen::MatrixXd labels;
+};
+
+uint64_t size(const Dataset& ds) {
+    return ds.examples.cols();
+}
+
+BOOST_AUTO_TEST_CASE ( int8_dot ) {
+    int8_t a[37];
+    int8_t b[37];
+    int32_t shouldBe = 0;
+    for (int i = 0; i < 37; ++i) {
+        a[i] = static_cast<int8_t>(127 - 7 * i);
+        b[i] = static_cast<int8_t>(-127 + 5 * i);
+        shouldBe += a[i] * b[i];
+    }
+    BOOST_CHECK_EQUAL(ml::ann::detail::dotInt8(a, b, 37), shouldBe);
+}
+
+BOOST_AUTO_TEST_CASE ( int8_dot_simd ) {
+#ifdef ML_ANN_AVX2_DISPATCH
+    if (!ml::ann::detail::hasAvx2Int8()) {
+        BOOST_TEST_MESSAGE("AVX2 is not supported, SIMD kernel is not tested");
+        return;
+    }
+    int8_t a[101];
+    int8_t b[101];
+    for (int i = 0; i < 101; ++i) {
+        a[i] = static_cast<int8_t>((i * 97 + 13) % 256 - 128);
+        b[i] = static_cast<int8_t>((i * 61 + 200) % 256 - 128);
+    }
+    // Whole 32 value blocks, 16 value steps and scalar tails
+    for (unsigned n = 0; n <= 101; ++n) {
+        BOOST_CHECK_EQUAL(ml::ann::detail::dotInt8Avx2(a, b, n),
+                          ml::ann::detail::dotInt8Scalar(a, b, n));
+    }
+    // Unaligned operands
+    BOOST_CHECK_EQUAL(ml::ann::detail::dotInt8Avx2(a + 1, b + 3, 97),
+                      ml::ann::detail::dotInt8Scalar(a + 1, b + 3, 97));
+#endif
+}
+
+BOOST_AUTO_TEST_CASE ( quantized_classifier ) {
+    typedef ml::ann::NetworkConf<
+        ml::ann::Input<16>,
+        ml::ann::FullyConnected<8>,
+        ml::ann::FullyConnected<4, ml::ann::Linear>> NetConf;
+    NetConf::Connections connections;
+    meta::tup_each([](auto& conn) { conn.init(); }, connections);
+    ml::ann::ANNClassifier<NetConf> classifier(connections);
+
+    Dataset dataset{Eigen::MatrixXd::Random(16, 50),
+                    Eigen::MatrixXd::Zero(4, 50)};
+    auto quantized = ml::ann::quantize(classifier, dataset);
+    auto report = ml::ann::compare(classifier, quantized, dataset, 16);
+
+    BOOST_CHECK_LT(report.maxAbsError, 0.1);
+    BOOST_CHECK_LT(report.meanAbsError, 0.02);
+    BOOST_CHECK_LT(quantized.bytes(), (16 * 8 + 8 * 4) * sizeof(double));
+}
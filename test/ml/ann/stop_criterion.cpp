@@ -0,0 +1,88 @@
+#include <meta/tuple.h>
+#include <ml/ann.h>
+#include <ml/ann/feed_forward.h>
+#include <ml/ann/stop_criterion.h>
+
+#include <Eigen/Dense>
+
+#define BOOST_TEST_MODULE ml_ann_stop_criterion
+#include <boost/test/included/unit_test.hpp>
+
+namespace {
+
+struct Dataset {
+    Eigen::MatrixXd examples;
+    Eigen::MatrixXd labels;
+};
+
+uint64_t size(const Dataset& ds) {
+    return ds.examples.cols();
+}
+
+typedef ml::ann::NetworkConf<
+    ml::ann::Input<6>,
+    ml::ann::FullyConnected<5>,
+    ml::ann::FullyConnected<3, ml::ann::Linear>> NetConf;
+
+typedef ml::ann::EarlyStopping<Dataset, NetConf> EarlyStopping;
+
+Dataset dataset(unsigned numExamples) {
+    Dataset result{Eigen::MatrixXd(6, numExamples),
+                   Eigen::MatrixXd(3, numExamples)};
+    for (unsigned i = 0; i < result.examples.size(); ++i) {
+        result.examples(i) = ((i * 37) % 23) / 11.0 - 1.0;
+    }
+    for (unsigned i = 0; i < result.labels.size(); ++i) {
+        result.labels(i) = ((i * 11) % 7) / 3.0 - 1.0;
+    }
+    return result;
+}
+
+NetConf::Connections connections() {
+    ml::seedRandom(0);
+    NetConf::Connections result;
+    meta::tup_each([](auto& conn) { conn.init(); }, result);
+    return result;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE ( chunked_loss ) {
+    const auto validationSet = dataset(103);
+    const auto conns = connections();
+    const double serialLoss = NetConf::lossFn(
+            ml::ann::detail::feedForward(
+                validationSet.examples, conns, NetConf::Layers{}),
+            validationSet.labels);
+    const double tolerance = 1e-9;
+    // Neither chunks nor threads divide 103 examples evenly
+    for (unsigned chunkSize: {1u, 7u, 10u, 103u, 1024u}) {
+        for (unsigned numThreads: {1u, 3u, 4u}) {
+            EarlyStopping earlyStopping(
+                    validationSet, 1, chunkSize, numThreads);
+            BOOST_CHECK_CLOSE(earlyStopping.loss(conns), serialLoss,
+                              tolerance);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE ( subsample ) {
+    const auto validationSet = dataset(103);
+    const auto conns = connections();
+    EarlyStopping whole(validationSet, 1);
+    EarlyStopping first(validationSet, 1, 7, 3);
+    EarlyStopping second(validationSet, 1, 10, 1);
+    EarlyStopping otherSeed(validationSet, 1, 10, 1);
+    first.subsample(40, 5);
+    second.subsample(40, 5);
+    otherSeed.subsample(40, 6);
+    // Same seed selects the same examples regardless of chunks and threads
+    BOOST_CHECK_CLOSE(first.loss(conns), second.loss(conns), 1e-9);
+    BOOST_CHECK_NE(first.loss(conns), otherSeed.loss(conns));
+    BOOST_CHECK_LT(first.loss(conns), whole.loss(conns));
+
+    // Subsample of the whole set size validates on everything
+    EarlyStopping all(validationSet, 1);
+    all.subsample(103);
+    BOOST_CHECK_CLOSE(all.loss(conns), whole.loss(conns), 1e-9);
+}
@@ -0,0 +1,191 @@
+#include <meta/logic.h>
+#include <meta/params.h>
+#include <meta/tuple.h>
+#include <ml/ann.h>
+#include <ml/ann/stop_criterion.h>
+#include <ml/ann/telemetry.h>
+
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <tuple>
+
+#include <Eigen/Dense>
+
+#define BOOST_TEST_MODULE ml_ann_telemetry
+#include <boost/test/included/unit_test.hpp>
+
+ML_DEFINE_ALLOCATION_COUNTER
+
+namespace {
+
+struct Dataset {
+    Eigen::MatrixXd examples;
+    Eigen::MatrixXd labels;
+};
+
+uint64_t size(const Dataset& ds) {
+    return ds.examples.cols();
+}
+
+//! Keeps allocations from being optimized out
+void* volatile sink;
+
+ml::ann::BatchEvent batchEvent(unsigned batch) {
+    return ml::ann::BatchEvent{
+        1, batch, 16, 0.5, 1.0, 2.0, 0.25, 3.5, batch};
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE ( ring_buffer ) {
+    ml::ann::RingBuffer<int> buffer(3);
+    BOOST_CHECK_EQUAL(buffer.size(), 0u);
+    buffer.push(1);
+    buffer.push(2);
+    BOOST_CHECK_EQUAL(buffer.size(), 2u);
+    BOOST_CHECK_EQUAL(buffer[0], 1);
+    BOOST_CHECK_EQUAL(buffer[1], 2);
+    // The oldest events are overwritten
+    for (int i = 3; i <= 7; ++i) {
+        buffer.push(i);
+    }
+    BOOST_CHECK_EQUAL(buffer.size(), 3u);
+    BOOST_CHECK_EQUAL(buffer[0], 5);
+    BOOST_CHECK_EQUAL(buffer[1], 6);
+    BOOST_CHECK_EQUAL(buffer[2], 7);
+
+    ml::ann::RingBuffer<int> single(0);
+    single.push(1);
+    single.push(2);
+    BOOST_CHECK_EQUAL(single.size(), 1u);
+    BOOST_CHECK_EQUAL(single[0], 2);
+}
+
+BOOST_AUTO_TEST_CASE ( observes_training ) {
+    typedef ml::ann::NetworkConf<
+        ml::ann::Input<4>,
+        ml::ann::FullyConnected<2, ml::ann::Linear>> NetConf;
+    typedef ml::ann::EarlyStopping<Dataset, NetConf>::Ref Monitor;
+    static_assert(!ml::ann::detail::ObservesTraining<Monitor>::value,
+            "Plain monitors don't observe training events");
+    static_assert(ml::ann::detail::ObservesTraining<
+                ml::ann::TelemetryMonitor<Monitor>>::value,
+            "Telemetry monitors observe training events");
+    static_assert(ml::ann::detail::ObservesTraining<
+                ml::ann::TelemetryRecorder>::value,
+            "Recorder observes training events");
+}
+
+BOOST_AUTO_TEST_CASE ( training_events ) {
+    typedef ml::ann::NetworkConf<
+        ml::ann::Input<4>,
+        ml::ann::FullyConnected<3>,
+        ml::ann::FullyConnected<2, ml::ann::Linear>> NetConf;
+    Dataset dataset{Eigen::MatrixXd::Random(4, 64),
+                    Eigen::MatrixXd::Random(2, 64)};
+    ml::ann::EarlyStopping<Dataset, NetConf> earlyStopping(dataset, 1);
+    ml::ann::EpochsNumber epochsNumber(3);
+    ml::ann::TelemetryRecorder recorder;
+    auto optimizationParams = std::make_tuple(
+            meta::param<ml::batchSizeP>(16),
+            meta::param<ml::regularizationP>(ml::ann::L2Regularization(0.0)),
+            meta::param<ml::stopCriterionP>(
+                meta::any(earlyStopping.ref(), epochsNumber)),
+            meta::param<ml::optimizationMonitorP>(
+                ml::ann::withTelemetry(earlyStopping.ref(), recorder)));
+    ml::ann::train(dataset, optimizationParams, NetConf{});
+
+    // Epochs 0 to 3 of 4 batches each
+    BOOST_REQUIRE_EQUAL(recorder.epochs().size(), 4u);
+    BOOST_REQUIRE_EQUAL(recorder.batches().size(), 16u);
+    for (unsigned i = 0; i < 16; ++i) {
+        const auto& batch = recorder.batches()[i];
+        BOOST_CHECK_EQUAL(batch.epoch, i / 4);
+        BOOST_CHECK_EQUAL(batch.batch, i % 4);
+        BOOST_CHECK_EQUAL(batch.examples, 16u);
+        BOOST_CHECK_GE(batch.forwardTime, 0.0);
+        BOOST_CHECK_GT(batch.loss, 0.0);
+    }
+    for (unsigned i = 0; i < 4; ++i) {
+        const auto& epoch = recorder.epochs()[i];
+        BOOST_CHECK_EQUAL(epoch.epoch, i);
+        BOOST_CHECK_EQUAL(epoch.examples, 64u);
+        BOOST_CHECK_GT(epoch.trainTime, 0.0);
+        BOOST_CHECK_GT(epoch.examplesPerSec, 0.0);
+        // Epoch loss is the mean loss per example of its batches
+        double loss = 0.0;
+        for (unsigned batch = 0; batch < 4; ++batch) {
+            loss += recorder.batches()[4 * i + batch].loss;
+        }
+        BOOST_CHECK_CLOSE(epoch.loss, loss / 64.0, 1e-9);
+    }
+}
+
+BOOST_AUTO_TEST_CASE ( csv_json ) {
+    ml::ann::TelemetryRecorder recorder(2, 2);
+    for (unsigned batch = 0; batch < 3; ++batch) {
+        recorder.observe(batchEvent(batch));
+    }
+    recorder.observe(ml::ann::EpochEvent{1, 48, 2.0, 0.5, 24.0, 0.125, 7});
+
+    std::ostringstream batches;
+    ml::ann::writeCsv(batches, recorder.batches());
+    BOOST_CHECK_EQUAL(batches.str(),
+        "epoch,batch,examples,load,forward,backward,update,loss,allocations\n"
+        "1,1,16,0.5,1,2,0.25,3.5,1\n"
+        "1,2,16,0.5,1,2,0.25,3.5,2\n");
+
+    std::ostringstream epochs;
+    ml::ann::writeCsv(epochs, recorder.epochs());
+    BOOST_CHECK_EQUAL(epochs.str(),
+        "epoch,examples,train,validation,examples_per_sec,loss,allocations\n"
+        "1,48,2,0.5,24,0.125,7\n");
+
+    std::ostringstream json;
+    ml::ann::writeJson(json, recorder);
+    BOOST_CHECK_EQUAL(json.str(),
+        "{\"epochs\": [\n"
+        "  {\"epoch\": 1, \"examples\": 48, \"train\": 2, \"validation\": 0.5, "
+        "\"examples_per_sec\": 24, \"loss\": 0.125, \"allocations\": 7}],\n"
+        " \"batches\": [\n"
+        "  {\"epoch\": 1, \"batch\": 1, \"examples\": 16, \"load\": 0.5, "
+        "\"forward\": 1, \"backward\": 2, \"update\": 0.25, \"loss\": 3.5, "
+        "\"allocations\": 1},\n"
+        "  {\"epoch\": 1, \"batch\": 2, \"examples\": 16, \"load\": 0.5, "
+        "\"forward\": 1, \"backward\": 2, \"update\": 0.25, \"loss\": 3.5, "
+        "\"allocations\": 2}]}\n");
+}
+
+BOOST_AUTO_TEST_CASE ( allocation_counter ) {
+    using ml::ann::detail::allocationCount;
+    uint64_t before = allocationCount();
+    int* value = new int(1);
+    sink = value;
+    BOOST_CHECK_EQUAL(allocationCount() - before, 1u);
+    delete value;
+
+    before = allocationCount();
+    Eigen::MatrixXd matrix(16, 16);
+    sink = matrix.data();
+    BOOST_CHECK_EQUAL(allocationCount() - before, 1u);
+
+#ifdef __GLIBC__
+    before = allocationCount();
+    void* ptr = std::malloc(32);
+    sink = ptr;
+    ptr = std::realloc(ptr, 4096);
+    sink = ptr;
+    std::free(ptr);
+    ptr = std::calloc(4, 8);
+    sink = ptr;
+    std::free(ptr);
+    ptr = aligned_alloc(64, 128);
+    sink = ptr;
+    std::free(ptr);
+    BOOST_REQUIRE_EQUAL(posix_memalign(&ptr, 64, 128), 0);
+    sink = ptr;
+    std::free(ptr);
+    BOOST_CHECK_EQUAL(allocationCount() - before, 5u);
+#endif
+}
@@ -0,0 +1,106 @@
+#include <ml/bit_vec.h>
+#include <ml/dataset/bit_matrix.h>
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#define BOOST_TEST_MODULE ml_dataset_bit_matrix
+#include <boost/test/included/unit_test.hpp>
+
+namespace {
+
+//! Every distances kernel supported by the CPU against BitVec distance
+template <unsigned SIZE>
+void checkKernels() {
+    std::mt19937 gen(SIZE);
+    std::bernoulli_distribution bit(0.5);
+    ml::BitMatrix<SIZE> matrix(37);
+    ml::BitVec<SIZE> x;
+    for (uint64_t i = 0; i <= size(matrix); ++i) {
+        ml::BitVec<SIZE> row;
+        for (unsigned pos = 0; pos < SIZE; ++pos) {
+            if (bit(gen)) {
+                row.set(pos);
+            }
+        }
+        if (i < size(matrix)) {
+            set(i, row, 0, matrix);
+        } else {
+            x = row;
+        }
+    }
+    typename ml::BitMatrix<SIZE>::Row padded;
+    padded.bits = x;
+    std::vector<unsigned> expected(size(matrix));
+    for (uint64_t i = 0; i < size(matrix); ++i) {
+        expected[i] = distance(x, example(i, matrix));
+    }
+    std::vector<unsigned> result(size(matrix));
+    ml::detail::distancesScalar(padded.bits.data(), matrix, result.data());
+    BOOST_CHECK(result == expected);
+#ifdef ML_BIT_MATRIX_POPCOUNT_DISPATCH
+    if (ml::detail::hasPopcnt()) {
+        result.assign(size(matrix), 0);
+        ml::detail::distancesPopcnt(
+                padded.bits.data(), matrix, result.data());
+        BOOST_CHECK(result == expected);
+    }
+    if (ml::detail::hasAvx512Popcount()) {
+        result.assign(size(matrix), 0);
+        ml::detail::distancesAvx512(
+                padded.bits.data(), matrix, result.data());
+        BOOST_CHECK(result == expected);
+    }
+#endif
+    BOOST_CHECK(distances(x, matrix) == expected);
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE ( layout ) {
+    typedef ml::BitMatrix<784> Matrix;
+    BOOST_CHECK_EQUAL(Matrix::ROW_PACKS, 16u);
+    BOOST_CHECK_EQUAL(ml::BitMatrix<512>::ROW_PACKS, 8u);
+    Matrix matrix(5);
+    for (uint64_t i = 0; i < size(matrix); ++i) {
+        BOOST_CHECK_EQUAL(reinterpret_cast<uintptr_t>(matrix.row(i)) % 64, 0u);
+        // Padding words are zero
+        for (unsigned w = ml::BitVec<784>::numPacks(); w < Matrix::ROW_PACKS;
+                ++w) {
+            BOOST_CHECK_EQUAL(matrix.row(i)[w], 0u);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE ( dataset_interface ) {
+    std::vector<ml::BitVec<100>> examples(3);
+    examples[1].set(3);
+    examples[2].set(3);
+    examples[2].set(99);
+    const std::vector<unsigned> labels = {0, 1, 2};
+    ml::BitMatrix<100> matrix(examples, labels);
+    BOOST_REQUIRE_EQUAL(size(matrix), 3u);
+    for (uint64_t i = 0; i < 3; ++i) {
+        BOOST_CHECK_EQUAL(distance(example(i, matrix), examples[i]), 0u);
+        BOOST_CHECK_EQUAL(label(i, matrix), static_cast<int8_t>(i));
+    }
+    set(0, examples[2], -1, matrix);
+    BOOST_CHECK_EQUAL(label(0, matrix), -1);
+    BOOST_CHECK(example(0, matrix)(99));
+
+    const auto result = distances(examples[1], matrix);
+    BOOST_REQUIRE_EQUAL(result.size(), 3u);
+    BOOST_CHECK_EQUAL(result[0], 1u);
+    BOOST_CHECK_EQUAL(result[1], 0u);
+    BOOST_CHECK_EQUAL(result[2], 1u);
+}
+
+BOOST_AUTO_TEST_CASE ( popcount_kernels ) {
+    checkKernels<1>();
+    checkKernels<64>();
+    checkKernels<100>();
+    checkKernels<512>();
+    checkKernels<784>();
+    checkKernels<1100>();
+}
@@ -0,0 +1,165 @@
+#include <meta/tuple.h>
+#include <ml/ann.h>
+#include <ml/ann/embedding.h>
+#include <ml/hnsw.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <Eigen/Dense>
+
+#define BOOST_TEST_MODULE ml_hnsw
+#include <boost/test/included/unit_test.hpp>
+
+namespace {
+
+//! Points scattered around 20 random centres
+Eigen::MatrixXd clustered(unsigned dim, unsigned N, unsigned seed) {
+    std::mt19937 gen(seed);
+    std::normal_distribution<> normal;
+    Eigen::MatrixXd centres(dim, 20);
+    for (unsigned i = 0; i < centres.size(); ++i) {
+        centres(i) = 4.0 * normal(gen);
+    }
+    Eigen::MatrixXd result(dim, N);
+    for (unsigned col = 0; col < N; ++col) {
+        for (unsigned row = 0; row < dim; ++row) {
+            result(row, col) = centres(row, col % 20) + normal(gen);
+        }
+    }
+    return result;
+}
+
+std::vector<uint64_t> bruteForce(
+        const Eigen::MatrixXd& points, const Eigen::VectorXd& query, unsigned k) {
+    std::vector<std::pair<double, uint64_t>> all(points.cols());
+    for (uint64_t i = 0; i < all.size(); ++i) {
+        all[i] = {(points.col(i) - query).squaredNorm(), i};
+    }
+    std::partial_sort(all.begin(), all.begin() + k, all.end());
+    std::vector<uint64_t> result;
+    for (unsigned i = 0; i < k; ++i) {
+        result.push_back(all[i].second);
+    }
+    return result;
+}
+
+double recall(const ml::hnsw::Index& index, const Eigen::MatrixXd& points,
+        const Eigen::MatrixXd& queries, unsigned k) {
+    uint64_t found = 0;
+    for (unsigned q = 0; q < queries.cols(); ++q) {
+        auto expected = bruteForce(points, queries.col(q), k);
+        std::sort(expected.begin(), expected.end());
+        for (const auto& neighbour: index.search(queries.col(q), k)) {
+            found += std::binary_search(
+                    expected.begin(), expected.end(), neighbour.second);
+        }
+    }
+    return static_cast<double>(found) / (queries.cols() * k);
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE ( search ) {
+    const auto points = clustered(16, 3000, 0);
+    const auto queries = clustered(16, 100, 1);
+    ml::hnsw::Params params;
+    params.numThreads = 1;
+    const ml::hnsw::Index index(points, params);
+    BOOST_CHECK_EQUAL(index.size(), 3000u);
+    BOOST_CHECK_GT(recall(index, points, queries, 10), 0.95);
+
+    const auto result = index.search(points.col(42), 5);
+    BOOST_REQUIRE_EQUAL(result.size(), 5u);
+    BOOST_CHECK_EQUAL(result[0].second, 42u);
+    BOOST_CHECK_EQUAL(result[0].first, 0.0f);
+    for (unsigned i = 1; i < result.size(); ++i) {
+        BOOST_CHECK_LE(result[i - 1].first, result[i].first);
+    }
+
+    params.numThreads = 4;
+    const ml::hnsw::Index parallel(points, params);
+    BOOST_CHECK_GT(recall(parallel, points, queries, 10), 0.95);
+}
+
+BOOST_AUTO_TEST_CASE ( save_load ) {
+    const auto points = clustered(8, 500, 2);
+    const ml::hnsw::Index index(points);
+    std::stringstream stream;
+    index.save(stream);
+    const auto loaded = ml::hnsw::Index::load(stream);
+    BOOST_CHECK_EQUAL(loaded.size(), index.size());
+    BOOST_CHECK_EQUAL(loaded.dimension(), index.dimension());
+    for (unsigned i = 0; i < 20; ++i) {
+        const auto expected = index.search(points.col(i), 5);
+        const auto found = loaded.search(points.col(i), 5);
+        BOOST_CHECK(found == expected);
+    }
+
+    std::stringstream truncated(stream.str().substr(0, 100));
+    BOOST_CHECK_THROW(ml::hnsw::Index::load(truncated), ml::RuntimeException);
+}
+
+BOOST_AUTO_TEST_CASE ( load_corrupt ) {
+    const auto points = clustered(8, 100, 3);
+    ml::hnsw::Params params;
+    params.numThreads = 1;
+    std::stringstream stream;
+    ml::hnsw::Index(points, params).save(stream);
+    const std::string saved = stream.str();
+
+    // Replaces header field (entry point is 7, top level 8, size 3)
+    auto withField = [&](unsigned field, uint64_t value) {
+        std::string result = saved;
+        std::memcpy(&result[field * sizeof(uint64_t)], &value, sizeof(value));
+        return result;
+    };
+    for (const auto& corrupt: {
+            withField(7, 1ull << 30),
+            withField(8, 40),
+            withField(3, 1ull << 40),
+            withField(2, 1ull << 40)}) {
+        std::stringstream in(corrupt);
+        BOOST_CHECK_THROW(ml::hnsw::Index::load(in), ml::RuntimeException);
+    }
+
+    // Bottom layer link count and first link of node 0 follow the header
+    // and node levels
+    const uint64_t links0 = 9 * sizeof(uint64_t) + points.cols();
+    std::string tooMany = saved;
+    const uint32_t count = 1000;
+    std::memcpy(&tooMany[links0], &count, sizeof(count));
+    std::string outside = saved;
+    const uint32_t target = 1000;
+    std::memcpy(&outside[links0 + sizeof(uint32_t)], &target, sizeof(target));
+    for (const auto& corrupt: {tooMany, outside}) {
+        std::stringstream in(corrupt);
+        BOOST_CHECK_THROW(ml::hnsw::Index::load(in), ml::RuntimeException);
+    }
+}
+
+BOOST_AUTO_TEST_CASE ( encode ) {
+    typedef ml::ann::NetworkConf<
+        ml::ann::Input<4>,
+        ml::ann::FullyConnected<3>,
+        ml::ann::FullyConnected<4>> NetConf;
+    NetConf::Connections connections;
+    meta::tup_each([](auto& conn) { conn.init(); }, connections);
+    const auto classifier = ml::ann::ANNClassifier<NetConf>(connections);
+    const Eigen::MatrixXd inputs = Eigen::MatrixXd::Random(4, 10);
+    const Eigen::MatrixXf codes = ml::ann::encode(classifier, inputs, 3, 2);
+    BOOST_REQUIRE_EQUAL(codes.rows(), 3);
+    BOOST_REQUIRE_EQUAL(codes.cols(), 10);
+    const auto& first = std::get<0>(connections);
+    const Eigen::MatrixXd expected = ((first.weights() * inputs).colwise() +
+            first.bias()).array().tanh().matrix();
+    BOOST_CHECK_SMALL((codes.cast<double>() - expected).cwiseAbs().maxCoeff(),
+                      1e-6);
+    BOOST_CHECK_THROW(ml::ann::encode(classifier, inputs, 0),
+                      ml::RuntimeException);
+}
@@ -0,0 +1,52 @@
+#include <ml/kernels.h>
+
+#include <Eigen/Dense>
+
+#define BOOST_TEST_MODULE ml_kernels
+#include <boost/test/included/unit_test.hpp>
+
+namespace {
+
+template <typename Kernel>
+void checkBlock(const Kernel& kernel) {
+    const Eigen::MatrixXd x = Eigen::MatrixXd::Random(5, 7);
+    const Eigen::MatrixXd y = Eigen::MatrixXd::Random(4, 7);
+    const Eigen::MatrixXd block = ml::kernelBlock(kernel, x, y);
+    BOOST_REQUIRE_EQUAL(block.rows(), 5);
+    BOOST_REQUIRE_EQUAL(block.cols(), 4);
+    for (unsigned i = 0; i < 5; ++i) {
+        for (unsigned j = 0; j < 4; ++j) {
+            const Eigen::RowVectorXd xi = x.row(i);
+            const Eigen::RowVectorXd yj = y.row(j);
+            BOOST_CHECK_CLOSE(block(i, j), kernel(xi, yj), 1e-9);
+        }
+    }
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE ( kernel_block ) {
+    BOOST_CHECK(ml::HasBlock<ml::RBFKernel>::value);
+    checkBlock(ml::RBFKernel(2.0));
+    checkBlock(ml::PolynomialKernel<3>());
+    checkBlock(ml::LinearKernel());
+
+    // Kernels without block member are evaluated pair by pair
+    struct Kernel {
+        double operator()(
+                const Eigen::RowVectorXd& x, const Eigen::RowVectorXd& y) const {
+            return x.dot(y) * 2.0;
+        }
+    };
+    BOOST_CHECK(!ml::HasBlock<Kernel>::value);
+    checkBlock(Kernel());
+}
+
+BOOST_AUTO_TEST_CASE ( gram ) {
+    const Eigen::MatrixXd x = Eigen::MatrixXd::Random(6, 3);
+    const Eigen::MatrixXd gram = ml::gram(ml::RBFKernel(1.0), x);
+    for (unsigned i = 0; i < 6; ++i) {
+        BOOST_CHECK_CLOSE(gram(i, i), 1.0, 1e-9);
+    }
+    BOOST_CHECK_SMALL((gram - gram.transpose()).norm(), 1e-12);
+}
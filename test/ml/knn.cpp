@@ -0,0 +1,101 @@
+#include <ml/bit_vec.h>
+#include <ml/dataset/dataset.h>
+#include <ml/knn.h>
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#define BOOST_TEST_MODULE ml_knn
+#include <boost/test/included/unit_test.hpp>
+
+namespace {
+
+typedef ml::VecDataset<ml::BitVec<128>, int> Dataset;
+
+ml::BitVec<128> noisy(const ml::BitVec<128>& x, double noise, std::mt19937& gen) {
+    std::bernoulli_distribution flip(noise);
+    ml::BitVec<128> result;
+    for (unsigned pos = 0; pos < 128; ++pos) {
+        if (x(pos) != flip(gen)) {
+            result.set(pos);
+        }
+    }
+    return result;
+}
+
+//! Noisy copies of 4 random prototypes labelled by prototype
+Dataset dataset(std::vector<ml::BitVec<128>>& prototypes, std::mt19937& gen) {
+    prototypes.resize(4);
+    for (auto& prototype: prototypes) {
+        prototype = noisy(ml::BitVec<128>(), 0.5, gen);
+    }
+    Dataset result(2000);
+    for (unsigned i = 0; i < size(result); ++i) {
+        set(i, noisy(prototypes[i % 4], 0.05, gen),
+            static_cast<int>(i % 4), result);
+    }
+    return result;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE ( multi_index_hashing_is_exact ) {
+    std::mt19937 gen(0);
+    std::vector<ml::BitVec<128>> prototypes;
+    const auto ds = dataset(prototypes, gen);
+    ml::knn::Params params;
+    params.maxLookupsRatio = 1e9;
+    ml::knn::MultiIndexHash<128> index(ds, params);
+    params.bruteForce = true;
+    ml::knn::MultiIndexHash<128> bruteForce(ds, params);
+    for (unsigned i = 0; i < 50; ++i) {
+        const auto query = noisy(prototypes[i % 4], 0.1, gen);
+        const auto expected = bruteForce.search(query, 7);
+        const auto found = index.search(query, 7);
+        BOOST_REQUIRE_EQUAL(found.size(), 7u);
+        for (unsigned j = 0; j < found.size(); ++j) {
+            BOOST_CHECK_EQUAL(found[j].first, expected[j].first);
+            BOOST_CHECK_EQUAL(found[j].second, expected[j].second);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE ( scan_fallback_is_exact ) {
+    // Default lookup budget, random codes make most searches give up on
+    // tables after some lookups and scan the dataset
+    std::mt19937 gen(2);
+    Dataset ds(1000);
+    for (unsigned i = 0; i < size(ds); ++i) {
+        set(i, noisy(ml::BitVec<128>(), 0.5, gen), 0, ds);
+    }
+    ml::knn::MultiIndexHash<128> index(ds);
+    ml::knn::Params params;
+    params.bruteForce = true;
+    ml::knn::MultiIndexHash<128> bruteForce(ds, params);
+    for (unsigned i = 0; i < 200; ++i) {
+        const auto expected = bruteForce.search(example(i, ds), 7);
+        const auto found = index.search(example(i, ds), 7);
+        BOOST_REQUIRE_EQUAL(found.size(), 7u);
+        for (unsigned j = 0; j < found.size(); ++j) {
+            BOOST_CHECK_EQUAL(found[j].first, expected[j].first);
+            BOOST_CHECK_EQUAL(found[j].second, expected[j].second);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE ( classifier ) {
+    std::mt19937 gen(1);
+    std::vector<ml::BitVec<128>> prototypes;
+    const auto ds = dataset(prototypes, gen);
+    const auto classifier = ml::knn::train(ds, 5);
+    for (unsigned i = 0; i < 20; ++i) {
+        BOOST_CHECK_EQUAL(classifier(noisy(prototypes[i % 4], 0.1, gen)),
+                          static_cast<int>(i % 4));
+    }
+    // Single neighbour is the example itself
+    const auto nearest = ml::knn::train(ds, 1);
+    for (unsigned i = 0; i < 20; ++i) {
+        BOOST_CHECK_EQUAL(nearest(example(i, ds)), label(i, ds));
+    }
+}
@@ -0,0 +1,190 @@
+#include <ml/bit_vec.h>
+#include <ml/dag_muticlass.h>
+#include <ml/dataset/dataset.h>
+#include <ml/kernels.h>
+#include <ml/pair_classifier_cache.h>
+#include <ml/svm/svc.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <dirent.h>
+#include <unistd.h>
+
+#define BOOST_TEST_MODULE ml_pair_classifier_cache
+#include <boost/test/included/unit_test.hpp>
+
+namespace {
+
+typedef ml::VecDataset<ml::BitVec<32>, int> Dataset;
+
+//! Examples of class c have bits of their own quarter set
+Dataset dataset(unsigned numClasses) {
+    Dataset result(numClasses * 12);
+    for (unsigned i = 0; i < size(result); ++i) {
+        const unsigned cls = i % numClasses;
+        ml::BitVec<32> x;
+        for (unsigned pos = 0; pos < 32; ++pos) {
+            const bool own = pos / 8 == cls;
+            if ((pos * 7 + i * 13) % 5 < (own ? 4u : 1u)) {
+                x.set(pos);
+            }
+        }
+        set(i, x, static_cast<int>(cls), result);
+    }
+    return result;
+}
+
+//! Temporary directory removed with its files
+class TmpDir {
+public:
+    TmpDir() {
+        char path[] = "/tmp/pair_cache_XXXXXX";
+        BOOST_REQUIRE(mkdtemp(path));
+        path_ = path;
+    }
+
+    ~TmpDir() {
+        if (DIR* dir = opendir(path_.c_str())) {
+            while (dirent* entry = readdir(dir)) {
+                const std::string name = entry->d_name;
+                if (name != "." && name != "..") {
+                    std::remove((path_ + "/" + name).c_str());
+                }
+            }
+            closedir(dir);
+        }
+        rmdir(path_.c_str());
+    }
+
+    const std::string& path() const {
+        return path_;
+    }
+
+private:
+    std::string path_;
+};
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE ( save_load ) {
+    const auto trainingSet = dataset(2);
+    Dataset binary(size(trainingSet));
+    for (unsigned i = 0; i < size(trainingSet); ++i) {
+        set(i, example(i, trainingSet), label(i, trainingSet) ? 1 : -1,
+                binary);
+    }
+    const auto classifier =
+        ml::svc::train(binary, 1.0, ml::RBFKernel(4.0));
+    std::stringstream stream;
+    classifier.save(stream);
+    const auto loaded = decltype(classifier)::load(stream);
+    BOOST_REQUIRE(stream);
+    BOOST_CHECK_EQUAL(loaded.alphas().size(), classifier.alphas().size());
+    BOOST_CHECK_EQUAL(loaded.threshold(), classifier.threshold());
+    BOOST_CHECK_EQUAL(loaded.kernel().sigma2(), classifier.kernel().sigma2());
+    for (unsigned i = 0; i < size(binary); ++i) {
+        BOOST_CHECK_EQUAL(loaded(example(i, binary)),
+                          classifier(example(i, binary)));
+    }
+}
+
+BOOST_AUTO_TEST_CASE ( retrain_changed_pairs ) {
+    TmpDir dir;
+    auto trainingSet = dataset(4);
+    unsigned numTrained = 0;
+    auto model = [&numTrained](const Dataset& ds) {
+        ++numTrained;
+        return ml::svc::train(ds, 1.0, ml::RBFKernel(4.0));
+    };
+
+    ml::c12n::composite::PairClassifierCache cache(dir.path(), "rbf 4 C 1");
+    auto first = ml::dag::train(trainingSet, model, cache);
+    BOOST_CHECK_EQUAL(numTrained, 6u);
+    BOOST_CHECK_EQUAL(cache.misses(), 6u);
+
+    // Nothing changed, every pair is loaded
+    auto second = ml::dag::train(trainingSet, model, cache);
+    BOOST_CHECK_EQUAL(numTrained, 6u);
+    BOOST_CHECK_EQUAL(cache.hits(), 6u);
+    for (unsigned i = 0; i < size(trainingSet); ++i) {
+        BOOST_CHECK_EQUAL(second(example(i, trainingSet)),
+                          first(example(i, trainingSet)));
+        BOOST_CHECK_EQUAL(second(example(i, trainingSet)),
+                          label(i, trainingSet));
+    }
+
+    // An example of class 2 changed, pairs of the other classes are loaded
+    ml::BitVec<32> x = example(2, trainingSet);
+    x.set(31);
+    set(2, x, 2, trainingSet);
+    ml::dag::train(trainingSet, model, cache);
+    BOOST_CHECK_EQUAL(numTrained, 9u);
+    BOOST_CHECK_EQUAL(cache.hits(), 9u);
+
+    // Different model key doesn't load classifiers of other models
+    ml::c12n::composite::PairClassifierCache other(dir.path(), "rbf 8 C 1");
+    ml::dag::train(trainingSet, model, other);
+    BOOST_CHECK_EQUAL(other.hits(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE ( load_checks_sizes ) {
+    typedef ml::svc::detail::SVMClassifier<Dataset, ml::RBFKernel> Classifier;
+
+    // Alpha of every support vector is required
+    std::stringstream missingAlphas;
+    Classifier(dataset(2), std::vector<double>(3, 1.0), 0.0,
+            ml::RBFKernel(4.0)).save(missingAlphas);
+    Classifier::load(missingAlphas);
+    BOOST_CHECK(!missingAlphas);
+
+    // Number of examples the stream can't hold isn't allocated
+    std::stringstream hugeDataset;
+    ml::writeValue(hugeDataset, uint64_t(1) << 60);
+    Classifier::load(hugeDataset);
+    BOOST_CHECK(!hugeDataset);
+}
+
+BOOST_AUTO_TEST_CASE ( corrupt_files_are_retrained ) {
+    TmpDir dir;
+    const auto trainingSet = dataset(2);
+    Dataset binary(size(trainingSet));
+    for (unsigned i = 0; i < size(trainingSet); ++i) {
+        set(i, example(i, trainingSet), label(i, trainingSet) ? 1 : -1,
+                binary);
+    }
+    typedef decltype(ml::svc::train(binary, 1.0, ml::RBFKernel(4.0)))
+        Classifier;
+    unsigned numTrained = 0;
+    auto train = [&] {
+        ++numTrained;
+        return ml::svc::train(binary, 1.0, ml::RBFKernel(4.0));
+    };
+
+    ml::c12n::composite::PairClassifierCache cache(dir.path(), "rbf 4 C 1");
+    cache.get<Classifier>(1, train);
+    BOOST_CHECK_EQUAL(cache.misses(), 1u);
+
+    // Number of support vectors following the header is corrupted
+    {
+        std::fstream file(dir.path() + "/0000000000000001.pair",
+                std::ios::binary | std::ios::in | std::ios::out);
+        file.seekp(3 * sizeof(uint64_t));
+        ml::writeValue(file, uint64_t(1) << 60);
+        BOOST_REQUIRE(file);
+    }
+    const auto retrained = cache.get<Classifier>(1, train);
+    BOOST_CHECK_EQUAL(numTrained, 2u);
+    BOOST_CHECK_EQUAL(cache.misses(), 2u);
+    BOOST_CHECK_EQUAL(cache.hits(), 0u);
+
+    // Corrupt file was replaced
+    const auto loaded = cache.get<Classifier>(1, train);
+    BOOST_CHECK_EQUAL(numTrained, 2u);
+    BOOST_CHECK_EQUAL(cache.hits(), 1u);
+    BOOST_CHECK_EQUAL(loaded.alphas().size(), retrained.alphas().size());
+}
@@ -0,0 +1,74 @@
+#include <ml/random.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include <Eigen/Dense>
+
+#define BOOST_TEST_MODULE ml_random
+#include <boost/test/included/unit_test.hpp>
+
+BOOST_AUTO_TEST_CASE ( known_answers ) {
+    // Philox4x32-10 test vectors of Random123
+    const auto zero = ml::Philox(0, 0).block(0);
+    BOOST_CHECK_EQUAL(zero[0], 0x6627e8d5u);
+    BOOST_CHECK_EQUAL(zero[1], 0xe169c58du);
+    BOOST_CHECK_EQUAL(zero[2], 0xbc57ac4cu);
+    BOOST_CHECK_EQUAL(zero[3], 0x9b00dbd8u);
+
+    const auto ones = ml::Philox(~0ull, ~0ull).block(~0ull);
+    BOOST_CHECK_EQUAL(ones[0], 0x408f276du);
+    BOOST_CHECK_EQUAL(ones[1], 0x41c83b0eu);
+    BOOST_CHECK_EQUAL(ones[2], 0xa20bc7c6u);
+    BOOST_CHECK_EQUAL(ones[3], 0x6d5451fdu);
+
+    const auto pi = ml::Philox(0x299f31d0a4093822ull, 0x0370734413198a2eull)
+        .block(0x85a308d3243f6a88ull);
+    BOOST_CHECK_EQUAL(pi[0], 0xd16cfe09u);
+    BOOST_CHECK_EQUAL(pi[1], 0x94fdccebu);
+    BOOST_CHECK_EQUAL(pi[2], 0x5001e420u);
+    BOOST_CHECK_EQUAL(pi[3], 0x24126ea1u);
+}
+
+BOOST_AUTO_TEST_CASE ( bulk_fill ) {
+    // Bulk fill continues the sequence of single draws
+    ml::Philox single(42, 3);
+    ml::Philox bulk(42, 3);
+    std::vector<uint32_t> expected(203);
+    for (auto& word: expected) {
+        word = single();
+    }
+    std::vector<uint32_t> words(203);
+    words[0] = bulk();
+    bulk.fill(words.data() + 1, 150);
+    bulk.fill(words.data() + 151, 52);
+    BOOST_CHECK(words == expected);
+
+    BOOST_CHECK(ml::Philox(42).stream(3)() == ml::Philox(42, 3)());
+    BOOST_CHECK(ml::Philox(42, 3)() != ml::Philox(42, 4)());
+}
+
+BOOST_AUTO_TEST_CASE ( distributions ) {
+    ml::Philox gen(7);
+    std::vector<unsigned> counts(10, 0);
+    for (unsigned i = 0; i < 10000; ++i) {
+        const uint32_t x = gen.below(10);
+        BOOST_REQUIRE_LT(x, 10u);
+        ++counts[x];
+    }
+    BOOST_CHECK_GT(*std::min_element(counts.begin(), counts.end()), 850u);
+
+    Eigen::MatrixXd m(30, 40);
+    gen.fillUniform(m, -1.0, 1.0);
+    BOOST_CHECK_GE(m.minCoeff(), -1.0);
+    BOOST_CHECK_LT(m.maxCoeff(), 1.0);
+    BOOST_CHECK_SMALL(m.mean(), 0.1);
+
+    ml::seedRandom(5);
+    const auto first = ml::randomStream()();
+    const auto second = ml::randomStream()();
+    BOOST_CHECK_NE(first, second);
+    ml::seedRandom(5);
+    BOOST_CHECK_EQUAL(ml::randomStream()(), first);
+}
@@ -0,0 +1,50 @@
+#include <ml/kernels.h>
+#include <ml/svm/cascade.h>
+#include <ml/svm/smo.h>
+#include <ml/svm/svc.h>
+#include <test/ml/svm/datasets.h>
+
+#include <cstdint>
+#include <vector>
+
+#define BOOST_TEST_MODULE ml_svm_cascade
+#include <boost/test/included/unit_test.hpp>
+
+BOOST_AUTO_TEST_CASE ( cascade ) {
+    const auto trainingSet = test::dataset();
+    ml::svm::cascade::Params params;
+    params.numPartitions = 5;
+    params.numThreads = 2;
+    auto classifier = ml::svc::trainCascade(
+            trainingSet, 1.0, ml::RBFKernel(4.0), params);
+    for (unsigned i = 0; i < size(trainingSet); ++i) {
+        BOOST_CHECK_EQUAL(classifier(example(i, trainingSet)),
+                          label(i, trainingSet));
+    }
+}
+
+BOOST_AUTO_TEST_CASE ( cascade_solution ) {
+    const auto trainingSet = test::distinctDataset(200);
+    const auto kernel =
+        ml::svc::detail::wrapKernel(ml::RBFKernel(4.0), trainingSet);
+    ml::svm::smo::Stats stats;
+    const auto full = ml::svm::smo::solve(
+            trainingSet, 1.0, kernel, ml::svm::smo::Params(), stats);
+    for (unsigned numPartitions : {2u, 5u}) {
+        ml::svm::cascade::Params params;
+        params.numPartitions = numPartitions;
+        params.maxPasses = 10;
+        const auto cascade = ml::svm::cascade::solve(
+                trainingSet, 1.0, ml::RBFKernel(4.0), params, stats);
+        // Examples left out of the final subproblem have zero alphas
+        std::vector<double> alphas(size(trainingSet), 0.0);
+        for (uint64_t i = 0; i < cascade.positions.size(); ++i) {
+            alphas[cascade.positions[i]] = cascade.alphas[i];
+        }
+        for (unsigned i = 0; i < size(trainingSet); ++i) {
+            BOOST_CHECK_EQUAL(alphas[i] > 0.0, full.first[i] > 0.0);
+        }
+        BOOST_CHECK_SMALL(test::maxDifference(alphas, full.first), 1e-2);
+        BOOST_CHECK_SMALL(cascade.threshold - full.second, 1e-2);
+    }
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <ml/bit_vec.h>
+#include <ml/dataset/dataset.h>
+#include <ml/random.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+namespace test {
+
+//! Binary classification dataset of 80 examples with repeats
+inline ml::VecDataset<ml::BitVec<32>, int> dataset() {
+    ml::VecDataset<ml::BitVec<32>, int> result(80);
+    for (unsigned i = 0; i < 80; ++i) {
+        ml::BitVec<32> x;
+        const int y = (i % 2) ? 1 : -1;
+        for (unsigned pos = 0; pos < 32; ++pos) {
+            // Positive examples mostly have low bits set
+            const bool low = pos < 16;
+            if ((pos * 7 + i * 13) % 5 < ((low == (y > 0)) ? 3u : 1u)) {
+                x.set(pos);
+            }
+        }
+        set(i, x, y, result);
+    }
+    return result;
+}
+
+//! Random examples of two classes, positive ones have each of the low 16
+//! bits set with probability match / 10 and each of the high ones with
+//! probability mismatch / 10, negative ones the other way round
+inline ml::VecDataset<ml::BitVec<32>, int> randomDataset(
+        unsigned numExamples, uint64_t seed,
+        unsigned match, unsigned mismatch) {
+    ml::VecDataset<ml::BitVec<32>, int> result(numExamples);
+    ml::Philox gen(seed);
+    for (unsigned i = 0; i < numExamples; ++i) {
+        ml::BitVec<32> x;
+        const int y = (i % 2) ? 1 : -1;
+        for (unsigned pos = 0; pos < 32; ++pos) {
+            const bool low = pos < 16;
+            if (gen.below(10) < ((low == (y > 0)) ? match : mismatch)) {
+                x.set(pos);
+            }
+        }
+        set(i, x, y, result);
+    }
+    return result;
+}
+
+//! Random examples, unlike dataset() without repeats, so the solution is unique
+inline ml::VecDataset<ml::BitVec<32>, int> distinctDataset(
+        unsigned numExamples) {
+    return randomDataset(numExamples, 7, 6, 3);
+}
+
+//! Random examples of well separated classes, most of which aren't
+//! support vectors
+inline ml::VecDataset<ml::BitVec<32>, int> separableDataset(
+        unsigned numExamples) {
+    return randomDataset(numExamples, 11, 9, 1);
+}
+
+//! Largest absolute difference of elements of a and b
+inline double maxDifference(
+        const std::vector<double>& a, const std::vector<double>& b) {
+    double result = 0.0;
+    for (uint64_t i = 0; i < a.size(); ++i) {
+        result = std::max(result, std::abs(a[i] - b[i]));
+    }
+    return result;
+}
+
+} // namespace test
@@ -0,0 +1,50 @@
+#include <ml/bit_vec.h>
+#include <ml/dataset/dataset.h>
+#include <ml/kernels.h>
+#include <ml/svm/feature_maps.h>
+
+#include <cmath>
+
+#include <Eigen/Dense>
+
+#define BOOST_TEST_MODULE ml_svm_feature_maps
+#include <boost/test/included/unit_test.hpp>
+
+BOOST_AUTO_TEST_CASE ( random_fourier_features ) {
+    const ml::RBFKernel kernel(4.0);
+    const ml::svm::RandomFourierFeatures features(kernel, 16, 4096);
+    ml::BitVec<16> x;
+    ml::BitVec<16> y;
+    x.set(0);
+    x.set(3);
+    y.set(3);
+    y.set(5);
+    y.set(7);
+    BOOST_CHECK_EQUAL(features(x).size(), 4096);
+    BOOST_CHECK_SMALL(features(x).dot(features(y)) - kernel(x, y), 0.05);
+    BOOST_CHECK_SMALL(features(x).dot(features(x)) - 1.0, 0.05);
+    // Dense and binary representations are mapped the same way
+    BOOST_CHECK_SMALL(
+        (features(ml::svm::detail::toDense(x)) - features(x)).norm(), 1e-9);
+}
+
+BOOST_AUTO_TEST_CASE ( nystrom_features_and_linear_svm ) {
+    ml::VecDataset<Eigen::RowVectorXd, int> dataset(40);
+    for (unsigned i = 0; i < 40; ++i) {
+        const double angle = i * 0.5;
+        const double radius = (i % 2) ? 1.0 : 3.0;
+        Eigen::RowVectorXd x(2);
+        x << radius * std::cos(angle), radius * std::sin(angle);
+        set(i, x, (i % 2) ? 1 : -1, dataset);
+    }
+    // Circles are not linearly separable, but are in gaussian feature space
+    auto features = ml::svm::nystrom(ml::RBFKernel(1.0), dataset, 40);
+    // Landmark kernel values are reproduced exactly
+    BOOST_CHECK_SMALL(
+        features(example(0, dataset)).dot(features(example(1, dataset))) -
+        ml::RBFKernel(1.0)(example(0, dataset), example(1, dataset)), 1e-6);
+    auto classifier = ml::svc::trainWithFeatureMap(dataset, 10.0, features);
+    for (unsigned i = 0; i < 40; ++i) {
+        BOOST_CHECK_EQUAL(classifier(example(i, dataset)), label(i, dataset));
+    }
+}
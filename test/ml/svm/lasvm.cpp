@@ -0,0 +1,79 @@
+#include <ml/bit_vec.h>
+#include <ml/kernels.h>
+#include <ml/svm/lasvm.h>
+#include <ml/svm/svc.h>
+#include <test/ml/svm/datasets.h>
+
+#include <cstdint>
+
+#define BOOST_TEST_MODULE ml_svm_lasvm
+#include <boost/test/included/unit_test.hpp>
+
+BOOST_AUTO_TEST_CASE ( online ) {
+    const auto trainingSet = test::dataset();
+    ml::svm::lasvm::Params params;
+    params.cleanInterval = 8;
+    ml::svm::lasvm::Solver<ml::BitVec<32>, ml::RBFKernel> solver(
+            1.0, ml::RBFKernel(4.0), params);
+    for (unsigned i = 0; i < 40; ++i) {
+        solver.add(example(i, trainingSet), label(i, trainingSet));
+    }
+    solver.finish();
+    BOOST_CHECK_LE(solver.numExamples(), 40u);
+
+    // New examples are absorbed by the solver state of the first half
+    for (unsigned i = 40; i < size(trainingSet); ++i) {
+        solver.add(example(i, trainingSet), label(i, trainingSet));
+    }
+    solver.finish();
+    BOOST_CHECK_LT(solver.numExamples(), size(trainingSet));
+    auto online = solver.classifier();
+    auto batch = ml::svc::train(trainingSet, 1.0, ml::RBFKernel(4.0));
+    BOOST_CHECK_SMALL(online.threshold() - batch.threshold(), 1e-2);
+    for (unsigned i = 0; i < size(trainingSet); ++i) {
+        BOOST_CHECK_EQUAL(online(example(i, trainingSet)),
+                          label(i, trainingSet));
+    }
+
+    auto trained = ml::svc::trainOnline(trainingSet, 1.0, ml::RBFKernel(4.0));
+    BOOST_CHECK_EQUAL(size(trained.supportVectors()),
+                      solver.numSupportVectors());
+}
+
+BOOST_AUTO_TEST_CASE ( refresh ) {
+    const auto trainingSet = test::separableDataset(200);
+    ml::svm::lasvm::Params params;
+    // Non-support examples are only dropped by explicit clean()
+    params.cleanInterval = 1000;
+    ml::svm::lasvm::Solver<ml::BitVec<32>, ml::RBFKernel> solver(
+            1.0, ml::RBFKernel(4.0), params);
+    for (unsigned i = 0; i < 100; ++i) {
+        solver.add(example(i, trainingSet), label(i, trainingSet));
+    }
+    solver.finish();
+    const uint64_t finished = solver.numExamples();
+
+    for (unsigned i = 100; i < size(trainingSet); ++i) {
+        solver.add(example(i, trainingSet), label(i, trainingSet));
+    }
+    BOOST_REQUIRE_EQUAL(solver.numExamples(), finished + 100);
+    auto before = solver.classifier();
+    solver.clean();
+    BOOST_CHECK_LT(solver.numExamples(), finished + 100);
+    BOOST_CHECK_GE(solver.numExamples(), solver.numSupportVectors());
+    auto after = solver.classifier();
+    BOOST_CHECK_EQUAL(size(after.supportVectors()),
+                      size(before.supportVectors()));
+    BOOST_CHECK_SMALL(after.threshold() - before.threshold(), 1e-12);
+    for (unsigned i = 0; i < size(trainingSet); ++i) {
+        BOOST_CHECK_EQUAL(after(example(i, trainingSet)),
+                          before(example(i, trainingSet)));
+    }
+
+    solver.finish();
+    auto refreshed = solver.classifier();
+    for (unsigned i = 0; i < size(trainingSet); ++i) {
+        BOOST_CHECK_EQUAL(refreshed(example(i, trainingSet)),
+                          label(i, trainingSet));
+    }
+}
@@ -0,0 +1,38 @@
+#include <ml/bit_vec.h>
+#include <ml/dataset/dataset.h>
+#include <ml/kernels.h>
+#include <ml/svm/svc.h>
+
+#include <Eigen/Dense>
+
+#define BOOST_TEST_MODULE ml_svm_linear
+#include <boost/test/included/unit_test.hpp>
+
+BOOST_AUTO_TEST_CASE ( dense_and_binary_examples ) {
+    ml::VecDataset<ml::BitVec<70>, int> binary(60);
+    ml::VecDataset<Eigen::RowVectorXd, int> dense(60);
+    for (unsigned i = 0; i < 60; ++i) {
+        ml::BitVec<70> x;
+        Eigen::RowVectorXd row = Eigen::RowVectorXd::Zero(70);
+        const int y = (i % 2) ? 1 : -1;
+        // Bit 65 marks positive examples, the rest is shared noise
+        for (unsigned pos: {i % 7, 10 + i % 13, (y > 0) ? 65u : 66u}) {
+            x.set(pos);
+            row(pos) = 1.0;
+        }
+        set(i, x, y, binary);
+        set(i, row, y, dense);
+    }
+
+    auto solution = ml::svm::linear::solve(binary, 1.0, 1e-6);
+    auto denseSolution = ml::svm::linear::solve(dense, 1.0, 1e-6);
+    BOOST_CHECK_SMALL((solution.first - denseSolution.first).norm(), 1e-9);
+    BOOST_CHECK_SMALL(solution.second - denseSolution.second, 1e-9);
+
+    auto classifier = ml::svc::train(binary, 1.0, ml::LinearKernel());
+    for (unsigned i = 0; i < 60; ++i) {
+        BOOST_CHECK_EQUAL(classifier(example(i, binary)), label(i, binary));
+        BOOST_CHECK_CLOSE(classifier.decision(example(i, binary)),
+                          classifier.decision(example(i, dense)), 1e-6);
+    }
+}
@@ -0,0 +1,298 @@
+#include <ml/bit_vec.h>
+#include <ml/dataset/dataset.h>
+#include <ml/kernels.h>
+#include <ml/dag_muticlass.h>
+#include <ml/svm/shared_kernel_cache.h>
+#include <ml/svm/smo.h>
+#include <ml/svm/svc.h>
+#include <test/ml/svm/datasets.h>
+
+#include <cstdint>
+#include <vector>
+
+#include <Eigen/Dense>
+
+#define BOOST_TEST_MODULE ml_svm_smo
+#include <boost/test/included/unit_test.hpp>
+
+namespace {
+
+//! Gaussian kernel of examples given by positions, counting evaluations
+template <typename Dataset>
+struct CountedKernel {
+    double operator()(unsigned i, unsigned j) const {
+        ++*evals;
+        return ml::RBFKernel(4.0)(example(i, dataset), example(j, dataset));
+    }
+
+    const Dataset& dataset;
+    uint64_t* evals;
+};
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE ( solver_params ) {
+    const auto trainingSet = test::dataset();
+    for (unsigned mode = 0; mode < 8; ++mode) {
+        ml::svm::smo::Params params;
+        params.sparseErrorCache = mode & 1;
+        params.kernelCacheBytes = (mode & 2) ? (1 << 20) : 0;
+        params.numThreads = (mode & 4) ? 3 : 1;
+        params.parallelThreshold = 0;
+        auto classifier = ml::svc::train(
+                trainingSet, 1.0, ml::RBFKernel(4.0), params);
+        for (unsigned i = 0; i < size(trainingSet); ++i) {
+            BOOST_CHECK_EQUAL(classifier(example(i, trainingSet)),
+                              label(i, trainingSet));
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE ( sparse_error_cache ) {
+    const auto trainingSet = test::distinctDataset(200);
+    ml::svm::smo::Params params;
+    ml::svm::smo::Stats stats;
+    uint64_t denseEvals = 0;
+    const auto dense = ml::svm::smo::solve(trainingSet, 1.0,
+            CountedKernel<decltype(trainingSet)>{trainingSet, &denseEvals},
+            params, stats);
+    params.sparseErrorCache = true;
+    uint64_t sparseEvals = 0;
+    const auto sparse = ml::svm::smo::solve(trainingSet, 1.0,
+            CountedKernel<decltype(trainingSet)>{trainingSet, &sparseEvals},
+            params, stats);
+    // Same optimum within solver tolerance, for fewer kernel evaluations.
+    // Solving takes several times N steps, so the log of updates replayed
+    // by the sparse error cache is compacted along the way.
+    BOOST_CHECK_SMALL(test::maxDifference(sparse.first, dense.first), 1e-2);
+    BOOST_CHECK_SMALL(sparse.second - dense.second, 1e-2);
+    BOOST_CHECK_LT(sparseEvals, denseEvals);
+}
+
+BOOST_AUTO_TEST_CASE ( threads ) {
+    const auto trainingSet = test::distinctDataset(200);
+    const auto kernel =
+        ml::svc::detail::wrapKernel(ml::RBFKernel(4.0), trainingSet);
+    // Cache of 20 rows is partially filled while threads scan examples
+    const uint64_t cacheBytes[] = {0, 20 * 200 * sizeof(double)};
+    for (uint64_t bytes : cacheBytes) {
+        for (bool sparse : {false, true}) {
+            ml::svm::smo::Params params;
+            params.sparseErrorCache = sparse;
+            params.kernelCacheBytes = bytes;
+            params.seed = 3;
+            params.parallelThreshold = 0;
+            ml::svm::smo::Stats stats;
+            const auto serial = ml::svm::smo::solve(
+                    trainingSet, 1.0, kernel, params, stats);
+            params.numThreads = 4;
+            const auto parallel = ml::svm::smo::solve(
+                    trainingSet, 1.0, kernel, params, stats);
+            // Results of ranges of examples are combined in order, so
+            // threads take the same steps
+            BOOST_CHECK(parallel.first == serial.first);
+            BOOST_CHECK_EQUAL(parallel.second, serial.second);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE ( regularization_path ) {
+    const auto trainingSet = test::dataset();
+    const std::vector<double> Cs = {0.1, 1.0, 10.0};
+    auto classifiers =
+        ml::svc::trainPath(trainingSet, Cs, ml::RBFKernel(4.0));
+    BOOST_REQUIRE_EQUAL(classifiers.size(), Cs.size());
+    for (unsigned i = 0; i < size(trainingSet); ++i) {
+        BOOST_CHECK_EQUAL(classifiers.back()(example(i, trainingSet)),
+                          label(i, trainingSet));
+    }
+
+    auto kernel = ml::svc::detail::wrapKernel(ml::RBFKernel(4.0), trainingSet);
+    ml::svm::smo::Stats stats;
+    const auto solution = ml::svm::smo::solve(
+            trainingSet, 1.0, kernel, ml::svm::smo::Params(), stats);
+    const auto rescaled = ml::svm::smo::rescale(solution, 1.0, 0.5);
+    for (unsigned i = 0; i < size(trainingSet); ++i) {
+        BOOST_CHECK_CLOSE(rescaled.first[i] * 2.0, solution.first[i], 1e-9);
+    }
+    // Solution is optimal already, warm start stays close to it
+    ml::svm::smo::Stats warmStats;
+    const auto warm = ml::svm::smo::solve(trainingSet, 1.0, kernel,
+            ml::svm::smo::Params(), warmStats, solution);
+    BOOST_CHECK_SMALL(warm.second - solution.second, 1e-2);
+    for (unsigned i = 0; i < size(trainingSet); ++i) {
+        BOOST_CHECK_SMALL(warm.first[i] - solution.first[i], 5e-2);
+    }
+}
+
+BOOST_AUTO_TEST_CASE ( warm_start ) {
+    const auto trainingSet = test::distinctDataset(200);
+    const ml::RBFKernel kernel(4.0);
+    ml::svm::smo::Stats stats;
+    const auto previous = ml::svm::smo::solve(trainingSet, 2.0,
+            ml::svc::detail::wrapKernel(kernel, trainingSet), stats);
+    auto cold = ml::svc::train(trainingSet, 1.0, kernel);
+    auto warm = ml::svc::train(trainingSet, 1.0, kernel,
+            ml::svm::smo::Params(),
+            ml::svm::smo::rescale(previous, 2.0, 1.0));
+    BOOST_CHECK_EQUAL(size(warm.supportVectors()),
+                      size(cold.supportVectors()));
+    BOOST_CHECK_SMALL(warm.threshold() - cold.threshold(), 1e-2);
+    for (unsigned i = 0; i < size(trainingSet); ++i) {
+        BOOST_CHECK_EQUAL(warm(example(i, trainingSet)),
+                          cold(example(i, trainingSet)));
+    }
+}
+
+BOOST_AUTO_TEST_CASE ( kernel_cache ) {
+    struct Kernel {
+        double operator()(unsigned i, unsigned j) const {
+            ++evals;
+            return i * 10.0 + j;
+        }
+        mutable unsigned evals = 0;
+    } kernel;
+    ml::svm::smo::Stats stats;
+    ml::svm::smo::KernelCache<Kernel> cache(
+            kernel, 4, 2 * 4 * sizeof(double), stats);
+    const auto row = cache.row(1);
+    BOOST_CHECK_EQUAL(row(2), 12.0);
+    BOOST_CHECK_EQUAL(row(2), 12.0);
+    BOOST_CHECK_EQUAL(kernel.evals, 1u);
+    // Symmetric lookup in cached row
+    BOOST_CHECK_EQUAL(cache(2, 1), 12.0);
+    BOOST_CHECK_EQUAL(kernel.evals, 1u);
+    cache.row(2);
+    cache.row(3);
+    // Row 1 is evicted
+    BOOST_CHECK_EQUAL(cache(1, 0), 10.0);
+    BOOST_CHECK_EQUAL(kernel.evals, 2u);
+}
+
+BOOST_AUTO_TEST_CASE ( early_exit ) {
+    // Same kernel without known bound, so every support vector is summed
+    struct UnboundedKernel {
+        double operator()(
+                const ml::BitVec<32>& x, const ml::BitVec<32>& y) const {
+            return ml::RBFKernel(4.0)(x, y);
+        }
+    };
+    const auto trainingSet = test::dataset();
+    ml::svm::smo::Stats stats;
+    const auto solution = ml::svm::smo::solve(trainingSet, 1.0,
+            ml::svc::detail::wrapKernel(ml::RBFKernel(4.0), trainingSet),
+            ml::svm::smo::Params(), stats);
+    const auto bounded = ml::svc::detail::makeClassifier(trainingSet,
+            solution.first, solution.second, ml::RBFKernel(4.0), stats);
+    const auto unbounded = ml::svc::detail::makeClassifier(trainingSet,
+            solution.first, solution.second, UnboundedKernel(), stats);
+    for (unsigned i = 0; i < 256; ++i) {
+        ml::BitVec<32> x;
+        for (unsigned pos = 0; pos < 32; ++pos) {
+            if ((i * 2654435761u >> (pos % 24)) & 1) {
+                x.set(pos);
+            }
+        }
+        BOOST_CHECK_EQUAL(bounded(x), unbounded(x));
+    }
+}
+
+BOOST_AUTO_TEST_CASE ( shared_kernel_cache ) {
+    ml::svm::smo::SharedKernelCache cache(1 << 20, 4);
+    unsigned evals = 0;
+    auto compute = [&] { ++evals; return 3.0; };
+    BOOST_CHECK_EQUAL(cache(5, 7, compute), 3.0);
+    BOOST_CHECK_EQUAL(cache(7, 5, compute), 3.0);
+    BOOST_CHECK_EQUAL(evals, 1u);
+    BOOST_CHECK_EQUAL(cache.hits(), 1u);
+    BOOST_CHECK_EQUAL(cache.misses(), 1u);
+
+    // Pair classifiers of 4 classes share kernel values of the same class
+    typedef ml::VecDataset<ml::BitVec<32>, int> Dataset;
+    auto binary = test::dataset();
+    Dataset multiclass(size(binary));
+    for (unsigned i = 0; i < size(binary); ++i) {
+        set(i, example(i, binary), static_cast<int>(i % 4), multiclass);
+    }
+    ml::svm::smo::SharedKernelCache pairsCache(1 << 20);
+    auto classifier = ml::dag::train(multiclass,
+        [&](const Dataset& ds, const std::vector<unsigned>& indices) {
+            BOOST_CHECK_EQUAL(indices.size(), size(ds));
+            for (unsigned i = 0; i < size(ds); ++i) {
+                BOOST_CHECK_EQUAL(distance(example(i, ds),
+                            example(indices[i], multiclass)), 0u);
+            }
+            return ml::svc::train(ds, 1.0, ml::RBFKernel(4.0),
+                    ml::svm::smo::Params(), pairsCache, indices);
+        });
+    BOOST_CHECK_GT(pairsCache.hits(), 0u);
+    classifier(example(0, multiclass));
+}
+
+BOOST_AUTO_TEST_CASE ( dense_examples ) {
+    typedef ml::VecDataset<Eigen::RowVectorXd, int> Dataset;
+    const auto binary = test::dataset();
+    Dataset trainingSet(size(binary));
+    for (unsigned i = 0; i < size(binary); ++i) {
+        Eigen::RowVectorXd x(32);
+        for (unsigned pos = 0; pos < 32; ++pos) {
+            x(pos) = example(i, binary)(pos) ? 1.0 : 0.0;
+        }
+        set(i, x, label(i, binary), trainingSet);
+    }
+    // Kernel rows are computed by matrix products
+    ml::svm::smo::Params params;
+    params.kernelCacheBytes = 1 << 20;
+    auto classifier = ml::svc::train(
+            trainingSet, 1.0, ml::RBFKernel(4.0), params);
+    Eigen::MatrixXd rows(size(trainingSet), 32);
+    for (unsigned i = 0; i < size(trainingSet); ++i) {
+        rows.row(i) = example(i, trainingSet);
+    }
+    const Eigen::VectorXi labels = classifier.classify(rows);
+    const Eigen::VectorXd decisions = classifier.decisions(rows);
+    for (unsigned i = 0; i < size(trainingSet); ++i) {
+        BOOST_CHECK_EQUAL(labels(i), label(i, trainingSet));
+        BOOST_CHECK_EQUAL(classifier(example(i, trainingSet)),
+                          label(i, trainingSet));
+        double expected = classifier.threshold();
+        for (unsigned j = 0; j < classifier.alphas().size(); ++j) {
+            expected += classifier.alphas()[j] * classifier.kernel()(
+                    rows.row(i), example(j, classifier.supportVectors()));
+        }
+        BOOST_CHECK_SMALL(decisions(i) - expected, 1e-9);
+    }
+
+    // Without kernel cache kernel values are computed pair by pair
+    params.kernelCacheBytes = 0;
+    auto uncached = ml::svc::train(
+            trainingSet, 1.0, ml::RBFKernel(4.0), params);
+    BOOST_CHECK_SMALL(
+            (uncached.decisions(rows) - decisions).cwiseAbs().maxCoeff(),
+            1e-6);
+}
+
+BOOST_AUTO_TEST_CASE ( reduced_set ) {
+    const auto trainingSet = test::dataset();
+    // Solution and so the reduced set depend on the seed of SMO scans
+    ml::svm::smo::Params params;
+    params.seed = 5;
+    auto classifier =
+        ml::svc::train(trainingSet, 1.0, ml::RBFKernel(4.0), params);
+    const uint64_t numSupportVectors = size(classifier.supportVectors());
+    BOOST_REQUIRE_GT(numSupportVectors, 20u);
+
+    params.maxSupportVectors = 20;
+    auto reduced = ml::svc::train(
+            trainingSet, 1.0, ml::RBFKernel(4.0), params);
+    BOOST_CHECK_EQUAL(size(reduced.supportVectors()), 20u);
+    unsigned errors = 0;
+    for (unsigned i = 0; i < size(trainingSet); ++i) {
+        errors += reduced(example(i, trainingSet)) != label(i, trainingSet);
+    }
+    BOOST_CHECK_LE(errors, 4u);
+
+    // Budget covering all support vectors keeps the classifier unchanged
+    auto same = ml::svc::reduce(std::move(classifier), numSupportVectors);
+    BOOST_CHECK_EQUAL(size(same.supportVectors()), numSupportVectors);
+}
@@ -0,0 +1,94 @@
+// Counters are collected only with ML_SMO_STATS, whatever the build option
+#ifndef ML_SMO_STATS
+#define ML_SMO_STATS
+#endif
+
+#include <ml/bit_vec.h>
+#include <ml/dag_muticlass.h>
+#include <ml/dataset/dataset.h>
+#include <ml/kernels.h>
+#include <ml/svm/smo_stats.h>
+#include <ml/svm/svc.h>
+
+#include <algorithm>
+#include <sstream>
+#include <vector>
+
+#define BOOST_TEST_MODULE ml_svm_smo_stats
+#include <boost/test/included/unit_test.hpp>
+
+namespace {
+
+typedef ml::VecDataset<ml::BitVec<32>, int> Dataset;
+
+//! Examples of class c mostly have bits of their own quarter set
+Dataset dataset(unsigned numClasses) {
+    Dataset result(numClasses * 20);
+    for (unsigned i = 0; i < size(result); ++i) {
+        const unsigned cls = i % numClasses;
+        ml::BitVec<32> x;
+        for (unsigned pos = 0; pos < 32; ++pos) {
+            const bool own = pos / 8 == cls;
+            if ((pos * 7 + i * 13) % 5 < (own ? 3u : 1u)) {
+                x.set(pos);
+            }
+        }
+        set(i, x, numClasses == 2 ? (cls ? 1 : -1) : static_cast<int>(cls),
+            result);
+    }
+    return result;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE ( counters ) {
+    const auto classifier =
+        ml::svc::train(dataset(2), 1.0, ml::RBFKernel(4.0));
+    const auto& stats = classifier.stats();
+    BOOST_CHECK_GT(stats.kernelEvals, 0u);
+    BOOST_CHECK_GT(stats.errorCacheHits + stats.errorCacheMisses, 0u);
+    BOOST_CHECK_GT(stats.successfulSteps, 0u);
+    BOOST_CHECK_GT(stats.failedSteps, 0u);
+    BOOST_CHECK_GT(stats.sweeps, 0u);
+    BOOST_CHECK_GT(stats.maxActiveSetSize, 0u);
+    BOOST_CHECK_LE(stats.activeSetSizes,
+                   stats.maxActiveSetSize * stats.sweeps);
+    BOOST_CHECK_GE(stats.maxSweepTime, 0.0);
+    BOOST_CHECK_LE(stats.maxSweepTime, stats.sweepTime);
+
+    std::ostringstream oss;
+    oss << stats;
+    BOOST_CHECK(oss.str().find("mean active set: ") != std::string::npos);
+}
+
+BOOST_AUTO_TEST_CASE ( composite_sum ) {
+    std::vector<ml::svm::smo::Stats> pairStats;
+    const auto classifier = ml::dag::train(dataset(4),
+        [&pairStats](const Dataset& ds) {
+            auto pair = ml::svc::train(ds, 1.0, ml::RBFKernel(4.0));
+            pairStats.push_back(pair.stats());
+            return pair;
+        });
+    BOOST_REQUIRE_EQUAL(pairStats.size(), 6u);
+
+    ml::svm::smo::Stats sum;
+    uint64_t maxActiveSetSize = 0;
+    for (const auto& stats: pairStats) {
+        BOOST_CHECK_GT(stats.kernelEvals, 0u);
+        BOOST_CHECK_GT(stats.sweeps, 0u);
+        sum.kernelEvals += stats.kernelEvals;
+        sum.successfulSteps += stats.successfulSteps;
+        sum.failedSteps += stats.failedSteps;
+        sum.sweeps += stats.sweeps;
+        sum.activeSetSizes += stats.activeSetSizes;
+        maxActiveSetSize = std::max(maxActiveSetSize, stats.maxActiveSetSize);
+    }
+    const auto& total = classifier.stats();
+    BOOST_CHECK_EQUAL(total.kernelEvals, sum.kernelEvals);
+    BOOST_CHECK_EQUAL(total.successfulSteps, sum.successfulSteps);
+    BOOST_CHECK_EQUAL(total.failedSteps, sum.failedSteps);
+    BOOST_CHECK_EQUAL(total.sweeps, sum.sweeps);
+    BOOST_CHECK_EQUAL(total.activeSetSizes, sum.activeSetSizes);
+    // Maxima are not summed
+    BOOST_CHECK_EQUAL(total.maxActiveSetSize, maxActiveSetSize);
+}
@@ -0,0 +1,78 @@
+#include <ml/dataset/dataset.h>
+#include <ml/parallel.h>
+#include <ml/validation.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#define BOOST_TEST_MODULE ml_validation
+#include <boost/test/included/unit_test.hpp>
+
+namespace {
+
+typedef ml::VecDataset<double, int> Dataset;
+
+Dataset dataset() {
+    Dataset result(23);
+    for (unsigned i = 0; i < 23; ++i) {
+        set(i, static_cast<double>(i), i < 10 ? -1 : 1, result);
+    }
+    return result;
+}
+
+//! Classifies by comparing example with threshold
+struct ThresholdClassifier {
+    int operator() (double x) const {
+        return x < threshold ? -1 : 1;
+    }
+
+    double threshold;
+};
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE ( parallel_jobs ) {
+    std::vector<std::atomic<unsigned>> calls(100);
+    ml::parallelJobs(calls.size(), 4, [&](uint64_t job) {
+        ++calls[job];
+    });
+    for (const auto& count: calls) {
+        BOOST_CHECK_EQUAL(count, 1u);
+    }
+}
+
+BOOST_AUTO_TEST_CASE ( k_folds ) {
+    const auto ds = dataset();
+    const auto folds = ml::validation::kFolds(ds, 4);
+    BOOST_REQUIRE_EQUAL(folds.size(), 4u);
+    std::vector<unsigned> tested(size(ds), 0);
+    for (const auto& fold: folds) {
+        BOOST_CHECK_EQUAL(size(fold.training) + size(fold.test), size(ds));
+        for (uint64_t i = 0; i < size(fold.test); ++i) {
+            ++tested[fold.test.positions()[i]];
+            BOOST_CHECK_EQUAL(example(i, fold.test),
+                              example(fold.test.positions()[i], ds));
+        }
+    }
+    BOOST_CHECK(std::all_of(tested.begin(), tested.end(),
+                [](unsigned count) { return count == 1; }));
+}
+
+BOOST_AUTO_TEST_CASE ( grid_search ) {
+    const auto ds = dataset();
+    const std::vector<double> thresholds = {0.0, 9.5, 15.0};
+    ml::validation::Params params;
+    params.numFolds = 5;
+    params.numThreads = 3;
+    const auto results = ml::validation::gridSearch(ds, thresholds,
+        [](const ml::IndexView<Dataset>&, double threshold) {
+            return ThresholdClassifier{threshold};
+        }, params);
+    BOOST_REQUIRE_EQUAL(results.size(), thresholds.size());
+    BOOST_CHECK_EQUAL(results[1].accuracy, 1.0);
+    BOOST_CHECK_EQUAL(results[1].foldAccuracies.size(), 5u);
+    BOOST_CHECK_CLOSE(results[0].accuracy, 13.0 / 23.0, 10.0);
+    BOOST_CHECK_EQUAL(ml::validation::best(results).config, 9.5);
+}